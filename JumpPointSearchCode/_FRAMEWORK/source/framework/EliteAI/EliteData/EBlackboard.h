@@ -3,37 +3,81 @@
 // Authors: Matthieu Delaere
 /*=============================================================================*/
 // EBlackboard.h: Blackboard implementation
+// Every name is registered once as a BlackboardKey, which gives it a dense id shared by all blackboards. A blackboard
+// keeps its values in a flat slot array indexed by that id, with a type tag per slot instead of RTTI. Lookups with a
+// key are an array index and a pointer compare. The string overloads still work, but do a name lookup every call:
+// keep them out of code that runs every frame.
 /*=============================================================================*/
 #ifndef ELITE_BLACKBOARD
 #define ELITE_BLACKBOARD
 
 //Includes
 #include <unordered_map>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <type_traits>
 
 namespace Elite
 {
 	//-----------------------------------------------------------------
-	// BLACKBOARD TYPES (BASE)
+	// BLACKBOARD KEY
 	//-----------------------------------------------------------------
-	class IBlackBoardField
+	//Make them once (e.g. a const at namespace scope), the same name always gets the same id
+	class BlackboardKey final
 	{
 	public:
-		IBlackBoardField() = default;
-		virtual ~IBlackBoardField() = default;
+		static const int InvalidId = -1;
+
+		explicit BlackboardKey(const std::string& name) : m_Id(Register(name))
+		{}
+		int GetId() const { return m_Id; }
+		const char* GetName() const { return GetNames()[m_Id]->c_str(); }
+
+		//Id of a name that was registered, InvalidId if it never was (doesn't register it)
+		static int Find(const std::string& name)
+		{
+			const auto it = GetIds().find(name);
+			return it != GetIds().end() ? it->second : InvalidId;
+		}
+		static int GetNrOfKeys() { return int(GetNames().size()); }
+
+	private:
+		int m_Id;
+
+		static int Register(const std::string& name)
+		{
+			const auto result = GetIds().insert({ name, GetNrOfKeys() });
+			if (result.second)
+				GetNames().push_back(&result.first->first);
+			return result.first->second;
+		}
+
+		//Function statics, so keys can be made during static initialization
+		static std::unordered_map<std::string, int>& GetIds() { static std::unordered_map<std::string, int> ids{}; return ids; }
+		static std::vector<const std::string*>& GetNames() { static std::vector<const std::string*> names{}; return names; }
 	};
 
-	//BlackboardField does not take ownership of pointers whatsoever!
+	//-----------------------------------------------------------------
+	// BLACKBOARD TYPES (BASE)
+	//-----------------------------------------------------------------
+	//Unique address per type, used as the type tag of a slot. Not const, so the linker can't fold the tags of different types
 	template<typename T>
-	class BlackboardField : public IBlackBoardField
+	const void* GetBlackboardTypeId()
 	{
-	public:
-		explicit BlackboardField(T data) : m_Data(data)
-		{}
-		T GetData() { return m_Data; };
-		void SetData(T data) { m_Data = data; }
+		static char typeId{};
+		return &typeId;
+	}
 
-	private:
-		T m_Data;
+	//A slot does not take ownership of pointers whatsoever!
+	struct BlackboardSlot
+	{
+		static const size_t MaxDataSize = 16;
+
+		const void* pType = nullptr; //nullptr when there's no data in the slot
+		unsigned int version = 0; //Goes up every time the data changes
+		alignas(8) unsigned char data[MaxDataSize];
 	};
 
 	//-----------------------------------------------------------------
@@ -43,12 +87,7 @@ namespace Elite
 	{
 	public:
 		Blackboard() = default;
-		~Blackboard()
-		{
-			for (auto el : m_BlackboardData)
-				SAFE_DELETE(el.second);
-			m_BlackboardData.clear();
-		}
+		~Blackboard() = default;
 
 		Blackboard(const Blackboard& other) = delete;
 		Blackboard& operator=(const Blackboard& other) = delete;
@@ -56,50 +95,118 @@ namespace Elite
 		Blackboard& operator=(Blackboard&& other) = delete;
 
 		//Add data to the blackboard
-		template<typename T> bool AddData(const std::string& name, T data)
+		template<typename T> bool AddData(const BlackboardKey& key, T data)
 		{
-			auto it = m_BlackboardData.find(name);
-			if (it == m_BlackboardData.end())
+			CheckType<T>();
+			if (key.GetId() >= int(m_Slots.size()))
+				m_Slots.resize(key.GetId() + 1);
+
+			BlackboardSlot& slot = m_Slots[key.GetId()];
+			if (slot.pType == nullptr)
 			{
-				m_BlackboardData[name] = new BlackboardField<T>(data);
+				slot.pType = GetBlackboardTypeId<T>();
+				memcpy(slot.data, &data, sizeof(T));
 				return true;
 			}
-			printf("WARNING: Data '%s' of type '%s' already in Blackboard \n", name.c_str(), typeid(T).name());
+			printf("WARNING: Data '%s' already in Blackboard \n", key.GetName());
 			return false;
 		}
 
 		//Change the data of the blackboard
+		template<typename T> bool ChangeData(const BlackboardKey& key, T data)
+		{
+			return ChangeData(key.GetId(), key.GetName(), data);
+		}
+
+		//Get the data from the blackboard
+		template<typename T> bool GetData(const BlackboardKey& key, T& data) const
+		{
+			return GetData(key.GetId(), key.GetName(), data);
+		}
+
+		//Changes every time the data changes (ChangeData with another value), to find out without comparing the data
+		unsigned int GetVersion(const BlackboardKey& key) const
+		{
+			const int id = key.GetId();
+			return id < int(m_Slots.size()) ? m_Slots[id].version : 0;
+		}
+
+		//By name, AddData registers the name when it's new
+		template<typename T> bool AddData(const std::string& name, T data)
+		{
+			return AddData(BlackboardKey{ name }, data);
+		}
+
 		template<typename T> bool ChangeData(const std::string& name, T data)
 		{
-			auto it = m_BlackboardData.find(name);
-			if (it != m_BlackboardData.end())
+			return ChangeData(BlackboardKey::Find(name), name.c_str(), data);
+		}
+
+		template<typename T> bool GetData(const std::string& name, T& data) const
+		{
+			return GetData(BlackboardKey::Find(name), name.c_str(), data);
+		}
+
+	private:
+		std::vector<BlackboardSlot> m_Slots;
+
+		//Values are copied bytewise into the slots
+		template<typename T> static void CheckType()
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Blackboard data has to be trivially copyable, store a pointer instead");
+			static_assert(sizeof(T) <= BlackboardSlot::MaxDataSize && alignof(T) <= 8, "Blackboard data too big for a slot, store a pointer instead");
+		}
+
+		//nullptr if there's no data with that id or it has another type
+		template<typename T> BlackboardSlot* FindSlot(int id)
+		{
+			CheckType<T>();
+			if (id < 0 || id >= int(m_Slots.size()) || m_Slots[id].pType != GetBlackboardTypeId<T>())
+				return nullptr;
+			return &m_Slots[id];
+		}
+
+		template<typename T> const BlackboardSlot* FindSlot(int id) const
+		{
+			return const_cast<Blackboard*>(this)->FindSlot<T>(id);
+		}
+
+		//Only the name, the type tags carry no type names
+		void PrintMissingData(int id, const char* name) const
+		{
+			if (id >= 0 && id < int(m_Slots.size()) && m_Slots[id].pType != nullptr)
+				printf("WARNING: Data '%s' in Blackboard has another type \n", name);
+			else
+				printf("WARNING: Data '%s' not found in Blackboard \n", name);
+		}
+
+		template<typename T> bool ChangeData(int id, const char* name, T data)
+		{
+			BlackboardSlot* pSlot = FindSlot<T>(id);
+			if (pSlot)
 			{
-				BlackboardField<T>* p = dynamic_cast<BlackboardField<T>*>(m_BlackboardData[name]);
-				if (p)
+				if (memcmp(pSlot->data, &data, sizeof(T)) != 0)
 				{
-					p->SetData(data);
-					return true;
+					memcpy(pSlot->data, &data, sizeof(T));
+					++pSlot->version;
 				}
+				return true;
 			}
-			printf("WARNING: Data '%s' of type '%s' not found in Blackboard \n", name.c_str(), typeid(T).name());
+			PrintMissingData(id, name);
 			return false;
 		}
 
-		//Get the data from the blackboard
-		template<typename T> bool GetData(const std::string& name, T& data)
+		template<typename T> bool GetData(int id, const char* name, T& data) const
 		{
-			BlackboardField<T>* p = dynamic_cast<BlackboardField<T>*>(m_BlackboardData[name]);
-			if (p != nullptr)
+			const BlackboardSlot* pSlot = FindSlot<T>(id);
+			if (pSlot)
 			{
-				data = p->GetData();
+				memcpy(&data, pSlot->data, sizeof(T));
 				return true;
 			}
-			printf("WARNING: Data '%s' of type '%s' not found in Blackboard \n", name.c_str(), typeid(T).name());
+			PrintMissingData(id, name);
 			return false;
 		}
-
-	private:
-		std::unordered_map<std::string, IBlackBoardField*> m_BlackboardData;
 	};
 }
-#endif
\ No newline at end of file
+#endif
@@ -31,6 +31,10 @@ namespace Elite
 #include "framework/EliteAI/EliteDecisionMaking/EliteFiniteStateMachine/EFiniteStateMachine.h"
 #include "framework/EliteAI/EliteDecisionMaking/EliteBehaviorTree/EBehaviorTree.h"
 
+/* --- Scheduling --- */
+//Level of detail for the update of many agents
+#include "framework/EliteAI/EliteDecisionMaking/EUpdateScheduler.h"
+
 
 #endif
 
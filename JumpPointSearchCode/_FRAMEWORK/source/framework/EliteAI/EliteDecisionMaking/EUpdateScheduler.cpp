@@ -0,0 +1,132 @@
+#include "stdafx.h"
+#include "EUpdateScheduler.h"
+
+using namespace Elite;
+
+void UpdateScheduler::AddBucket(float maxDistance, float decisionInterval, float steeringInterval)
+{
+	Bucket bucket{};
+	bucket.maxDistance = maxDistance;
+	bucket.decisionInterval = decisionInterval;
+	bucket.steeringInterval = steeringInterval;
+
+	const auto it = std::upper_bound(m_Buckets.begin(), m_Buckets.end(), bucket,
+		[](const Bucket& lhs, const Bucket& rhs) { return lhs.maxDistance < rhs.maxDistance; });
+	m_Buckets.insert(it, bucket);
+}
+
+void UpdateScheduler::SetNrOfAgents(int nrOfAgents)
+{
+	const int oldNrOfAgents = GetNrOfAgents();
+	m_BucketIds.resize(nrOfAgents, 0);
+	m_IsImportant.resize(nrOfAgents, false);
+	m_DecisionTimers.resize(nrOfAgents);
+	m_SteeringTimers.resize(nrOfAgents);
+
+	//Agents added together would all tick in the same frames, spread them over the longest interval (golden ratio sequence)
+	const float maxDecisionInterval = GetMaxInterval(&Bucket::decisionInterval);
+	const float maxSteeringInterval = GetMaxInterval(&Bucket::steeringInterval);
+	for (int i = oldNrOfAgents; i < nrOfAgents; ++i)
+	{
+		const float phase = fmodf(i * 0.618034f, 1.f);
+		m_DecisionTimers[i] = Timer{ 0.f, phase * maxDecisionInterval };
+		m_SteeringTimers[i] = Timer{ 0.f, phase * maxSteeringInterval };
+	}
+
+	if (m_DecisionCursor >= nrOfAgents)
+		m_DecisionCursor = 0;
+	if (m_SteeringCursor >= nrOfAgents)
+		m_SteeringCursor = 0;
+}
+
+void UpdateScheduler::RemoveAgent(int agent)
+{
+	m_BucketIds.erase(m_BucketIds.begin() + agent);
+	m_IsImportant.erase(m_IsImportant.begin() + agent);
+	m_DecisionTimers.erase(m_DecisionTimers.begin() + agent);
+	m_SteeringTimers.erase(m_SteeringTimers.begin() + agent);
+
+	//The cursors keep pointing at the same agent
+	if (m_DecisionCursor > agent)
+		--m_DecisionCursor;
+	if (m_SteeringCursor > agent)
+		--m_SteeringCursor;
+	SetNrOfAgents(GetNrOfAgents());
+}
+
+void UpdateScheduler::Schedule(float deltaT, const Vector2* pPositions, int nrOfAgents, const Vector2* pFocusPoints, int nrOfFocusPoints)
+{
+	if (nrOfAgents != GetNrOfAgents())
+		SetNrOfAgents(nrOfAgents);
+
+	const int lastBucket = max(int(m_Buckets.size()) - 1, 0);
+	for (int i = 0; i < nrOfAgents; ++i)
+	{
+		m_DecisionTimers[i].elapsed += deltaT;
+		m_SteeringTimers[i].elapsed += deltaT;
+
+		if (m_IsImportant[i])
+		{
+			m_BucketIds[i] = 0;
+			continue;
+		}
+
+		float distanceSquared = FLT_MAX;
+		for (int f = 0; f < nrOfFocusPoints; ++f)
+			distanceSquared = min(distanceSquared, DistanceSquared(pPositions[i], pFocusPoints[f]));
+
+		int bucket = 0;
+		while (bucket < lastBucket && distanceSquared > m_Buckets[bucket].maxDistance * m_Buckets[bucket].maxDistance)
+			++bucket;
+		m_BucketIds[i] = bucket;
+	}
+
+	ScheduleTicks(m_DecisionTimers, &Bucket::decisionInterval, nullptr, m_MaxDecisionsPerFrame, m_DecisionCursor, m_DecisionTicks);
+
+	//The agents that decided steer right away, outside of the steering budget
+	m_IsSteering.assign(nrOfAgents, false);
+	for (const Tick& tick : m_DecisionTicks)
+		m_IsSteering[tick.agent] = true;
+
+	ScheduleTicks(m_SteeringTimers, &Bucket::steeringInterval, m_IsSteering.data(), m_MaxSteeringPerFrame, m_SteeringCursor, m_SteeringTicks);
+	for (const Tick& tick : m_DecisionTicks)
+	{
+		Timer& timer = m_SteeringTimers[tick.agent];
+		m_SteeringTicks.push_back(Tick{ tick.agent, timer.elapsed });
+		timer = Timer{};
+	}
+}
+
+void UpdateScheduler::ScheduleTicks(std::vector<Timer>& timers, float Bucket::* pInterval, const char* pSkip, int maxTicks, int& cursor, std::vector<Tick>& ticks)
+{
+	ticks.clear();
+	const int nrOfAgents = GetNrOfAgents();
+	for (int k = 0; k < nrOfAgents; ++k)
+	{
+		const int i = (cursor + k) % nrOfAgents;
+		if (pSkip && pSkip[i])
+			continue;
+
+		Timer& timer = timers[i];
+		const float interval = m_Buckets.empty() ? 0.f : m_Buckets[m_BucketIds[i]].*pInterval;
+		if (timer.elapsed + timer.stagger < interval)
+			continue;
+
+		if (maxTicks > 0 && int(ticks.size()) >= maxTicks)
+		{
+			cursor = i;
+			return;
+		}
+
+		ticks.push_back(Tick{ i, timer.elapsed });
+		timer = Timer{};
+	}
+}
+
+float UpdateScheduler::GetMaxInterval(float Bucket::* pInterval) const
+{
+	float maxInterval = 0.f;
+	for (const Bucket& bucket : m_Buckets)
+		maxInterval = max(maxInterval, bucket.*pInterval);
+	return maxInterval;
+}
@@ -0,0 +1,79 @@
+#pragma once
+// EUpdateScheduler.h: level of detail for the update of many agents. Every agent is put in a bucket by its distance to the
+// closest focus point (e.g. the player), or in the first bucket when it's marked important. A bucket sets how often its
+// agents decide (FSM/BT update) and steer. Due agents are served round-robin with an optional budget per frame, so the AI
+// cost of a frame is bounded no matter how many agents there are: an agent over the budget is served first next frame.
+// Every tick gets the time since the last tick of that kind, so timers in the decision making stay correct.
+#include <vector>
+
+namespace Elite
+{
+	class UpdateScheduler final
+	{
+	public:
+		struct Tick
+		{
+			int agent = 0;
+			float deltaT = 0.f; //Since the last tick of the agent
+		};
+
+		UpdateScheduler() = default;
+
+		//Buckets are kept sorted by distance, agents beyond the last one are in the last one. An interval of 0 is every frame
+		void AddBucket(float maxDistance, float decisionInterval, float steeringInterval);
+		void ClearBuckets() { m_Buckets.clear(); }
+		//At most this many ticks per frame, 0 is no limit
+		void SetMaxDecisionsPerFrame(int maxDecisions) { m_MaxDecisionsPerFrame = maxDecisions; }
+		void SetMaxSteeringPerFrame(int maxSteering) { m_MaxSteeringPerFrame = maxSteering; }
+
+		//Agents are indices, keep them in sync with the container of the agents
+		void SetNrOfAgents(int nrOfAgents);
+		void RemoveAgent(int agent);
+		//Important agents are always in the first bucket
+		void SetImportant(int agent, bool isImportant) { m_IsImportant[agent] = isImportant; }
+
+		//Picks the agents that decide/steer this frame, pPositions has nrOfAgents elements (resizes when it changed)
+		//Without focus points every agent that isn't important is in the last bucket
+		void Schedule(float deltaT, const Vector2* pPositions, int nrOfAgents, const Vector2* pFocusPoints, int nrOfFocusPoints);
+
+		//An agent that decides also steers in the same frame
+		const std::vector<Tick>& GetDecisionTicks() const { return m_DecisionTicks; }
+		const std::vector<Tick>& GetSteeringTicks() const { return m_SteeringTicks; }
+		int GetBucket(int agent) const { return m_BucketIds[agent]; }
+		int GetNrOfAgents() const { return int(m_BucketIds.size()); }
+
+	private:
+		struct Bucket
+		{
+			float maxDistance;
+			float decisionInterval;
+			float steeringInterval;
+		};
+
+		//Per agent time since the last tick and an offset that spreads the first ticks of agents added together
+		struct Timer
+		{
+			float elapsed = 0.f;
+			float stagger = 0.f;
+		};
+
+		std::vector<Bucket> m_Buckets{};
+		int m_MaxDecisionsPerFrame = 0;
+		int m_MaxSteeringPerFrame = 0;
+
+		std::vector<int> m_BucketIds{};
+		std::vector<char> m_IsImportant{};
+		std::vector<Timer> m_DecisionTimers{};
+		std::vector<Timer> m_SteeringTimers{};
+		int m_DecisionCursor = 0;
+		int m_SteeringCursor = 0;
+
+		std::vector<Tick> m_DecisionTicks{};
+		std::vector<Tick> m_SteeringTicks{};
+		std::vector<char> m_IsSteering{};
+
+		//Round-robin from the cursor over the due agents that aren't skipped, the cursor stops at the first one over the budget
+		void ScheduleTicks(std::vector<Timer>& timers, float Bucket::* pInterval, const char* pSkip, int maxTicks, int& cursor, std::vector<Tick>& ticks);
+		float GetMaxInterval(float Bucket::* pInterval) const;
+	};
+}
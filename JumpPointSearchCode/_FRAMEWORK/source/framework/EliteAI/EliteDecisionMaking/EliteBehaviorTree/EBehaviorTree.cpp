@@ -1,7 +1,45 @@
 //=== General Includes ===
 #include "stdafx.h"
+#include <memory>
 using namespace Elite;
 
+namespace
+{
+	//Working memory of CompiledBehaviorTree::UpdateBatch, per thread so trees can be updated in parallel
+	struct BehaviorBatchScratch
+	{
+		std::vector<int> nodes{}; //Per agent the leaf it's at
+		std::vector<BehaviorState> results{};
+		std::vector<int> pending{}; //Agents with a leaf to run
+		std::vector<int> nextPending{};
+
+		std::vector<int> nodeStarts{}; //Pending agents grouped per node: the agents of node n are order[nodeStarts[n], nodeStarts[n + 1])
+		std::vector<int> order{};
+		std::vector<Blackboard*> blackboards{};
+		std::vector<int> agents{};
+		std::vector<BehaviorState> batchResults{};
+	};
+
+	BehaviorBatchScratch& GetBehaviorBatchScratch()
+	{
+		static thread_local BehaviorBatchScratch scratch{};
+		return scratch;
+	}
+
+	//Results of the batch conditionals, std::vector<bool> has no bool*
+	bool* GetConditionResults(int count)
+	{
+		static thread_local std::unique_ptr<bool[]> pResults{};
+		static thread_local int capacity{ 0 };
+		if (count > capacity)
+		{
+			capacity = count;
+			pResults.reset(new bool[capacity]);
+		}
+		return pResults.get();
+	}
+}
+
 //-----------------------------------------------------------------
 // BEHAVIOR TREE COMPOSITES (IBehavior)
 //-----------------------------------------------------------------
@@ -69,6 +107,21 @@ BehaviorState BehaviorPartialSequence::Execute(Blackboard* pBlackBoard)
 	m_CurrentBehaviorIndex = 0;
 	return m_CurrentState = Success;
 }
+
+void BehaviorSelector::Compile(CompiledBehaviorTree& tree, int node) const
+{
+	tree.CompileComposite(node, CompiledBehaviorTree::NodeType::Selector, m_ChildrenBehaviors);
+}
+
+void BehaviorSequence::Compile(CompiledBehaviorTree& tree, int node) const
+{
+	tree.CompileComposite(node, CompiledBehaviorTree::NodeType::Sequence, m_ChildrenBehaviors);
+}
+
+void BehaviorPartialSequence::Compile(CompiledBehaviorTree& tree, int node) const
+{
+	tree.CompileComposite(node, CompiledBehaviorTree::NodeType::PartialSequence, m_ChildrenBehaviors);
+}
 #pragma endregion
 //-----------------------------------------------------------------
 // BEHAVIOR TREE CONDITIONAL (IBehavior)
@@ -87,6 +140,11 @@ BehaviorState BehaviorConditional::Execute(Blackboard* pBlackBoard)
 	}
 	return m_CurrentState = Failure;
 }
+
+void BehaviorConditional::Compile(CompiledBehaviorTree& tree, int node) const
+{
+	tree.CompileConditional(node, m_fpConditional, m_fpBatchConditional);
+}
 //-----------------------------------------------------------------
 // BEHAVIOR TREE ACTION (IBehavior)
 //-----------------------------------------------------------------
@@ -96,4 +154,273 @@ BehaviorState BehaviorAction::Execute(Blackboard* pBlackBoard)
 		return Failure;
 
 	return m_CurrentState = m_fpAction(pBlackBoard);
-}
\ No newline at end of file
+}
+
+void BehaviorAction::Compile(CompiledBehaviorTree& tree, int node) const
+{
+	tree.CompileAction(node, m_fpAction);
+}
+//-----------------------------------------------------------------
+// COMPILED BEHAVIOR TREE
+//-----------------------------------------------------------------
+CompiledBehaviorTree::CompiledBehaviorTree(const IBehavior* pRoot)
+{
+	if (pRoot == nullptr)
+		return;
+
+	AllocateNodes(1, InvalidNode);
+	pRoot->Compile(*this, 0);
+}
+
+int CompiledBehaviorTree::AllocateNodes(int count, int parent)
+{
+	const int first = int(m_Nodes.size());
+	m_Nodes.resize(first + count);
+	for (int i = first; i < first + count; ++i)
+		m_Nodes[i].parent = parent;
+	return first;
+}
+
+void CompiledBehaviorTree::CompileComposite(int node, NodeType type, const std::vector<IBehavior*>& childrenBehaviors)
+{
+	//All children first, so they're next to each other, then their subtrees
+	const int nrOfChildren = int(childrenBehaviors.size());
+	const int firstChild = AllocateNodes(nrOfChildren, node);
+	m_Nodes[node].type = type;
+	m_Nodes[node].firstChild = firstChild;
+	m_Nodes[node].nrOfChildren = nrOfChildren;
+	if (type == NodeType::PartialSequence)
+		m_Nodes[node].data = m_NrOfCursors++;
+
+	for (int i = 0; i < nrOfChildren; ++i)
+		childrenBehaviors[i]->Compile(*this, firstChild + i);
+}
+
+void CompiledBehaviorTree::CompileConditional(int node, const std::function<bool(Blackboard*)>& fpConditional,
+	const std::function<void(const BehaviorBatch&, bool*)>& fpBatchConditional)
+{
+	m_Nodes[node].type = NodeType::Conditional;
+	m_Nodes[node].data = int(m_Conditionals.size());
+	m_Conditionals.push_back(fpConditional);
+	m_BatchConditionals.push_back(fpBatchConditional);
+}
+
+void CompiledBehaviorTree::CompileAction(int node, const std::function<BehaviorState(Blackboard*)>& fpAction)
+{
+	m_Nodes[node].type = NodeType::Action;
+	m_Nodes[node].data = int(m_Actions.size());
+	m_Actions.push_back(fpAction);
+}
+
+BehaviorState CompiledBehaviorTree::Update(BehaviorTreeState& state, Blackboard* pBlackBoard) const
+{
+	if (m_Nodes.empty())
+		return state.currentState = Failure;
+	if (int(state.cursors.size()) != m_NrOfCursors)
+		state.cursors.assign(m_NrOfCursors, 0);
+
+	int node = Descend(state.runningNode != InvalidNode ? state.runningNode : 0, state);
+	state.runningNode = InvalidNode;
+	BehaviorState result = Run(node, pBlackBoard);
+	while (Ascend(node, result, state))
+		result = Run(node, pBlackBoard);
+
+	return state.currentState;
+}
+
+void CompiledBehaviorTree::UpdateBatch(BehaviorTreeInstance* const* ppInstances, const int* pAgents, int nrOfAgents) const
+{
+	BehaviorBatchScratch& scratch = GetBehaviorBatchScratch();
+	scratch.nodes.resize(nrOfAgents);
+	scratch.results.resize(nrOfAgents);
+	scratch.pending.clear();
+	for (int i = 0; i < nrOfAgents; ++i)
+	{
+		BehaviorTreeState& state = ppInstances[i]->m_State;
+		if (m_Nodes.empty())
+		{
+			state.currentState = Failure;
+			continue;
+		}
+		if (int(state.cursors.size()) != m_NrOfCursors)
+			state.cursors.assign(m_NrOfCursors, 0);
+
+		scratch.nodes[i] = Descend(state.runningNode != InvalidNode ? state.runningNode : 0, state);
+		state.runningNode = InvalidNode;
+		scratch.pending.push_back(i);
+	}
+
+	const int nrOfNodes = int(m_Nodes.size());
+	while (!scratch.pending.empty())
+	{
+		//Group the pending agents per leaf (counting sort on the node)
+		scratch.nodeStarts.assign(nrOfNodes + 1, 0);
+		for (int agent : scratch.pending)
+			++scratch.nodeStarts[scratch.nodes[agent] + 1];
+		for (int n = 0; n < nrOfNodes; ++n)
+			scratch.nodeStarts[n + 1] += scratch.nodeStarts[n];
+
+		scratch.order.resize(scratch.pending.size());
+		for (int agent : scratch.pending)
+			scratch.order[scratch.nodeStarts[scratch.nodes[agent]]++] = agent;
+		//The fill moved every start to the start of the next node, shift them back
+		for (int n = nrOfNodes; n > 0; --n)
+			scratch.nodeStarts[n] = scratch.nodeStarts[n - 1];
+		scratch.nodeStarts[0] = 0;
+
+		//Every leaf once for all its agents
+		for (int n = 0; n < nrOfNodes; ++n)
+		{
+			const int first = scratch.nodeStarts[n];
+			const int count = scratch.nodeStarts[n + 1] - first;
+			if (count == 0)
+				continue;
+
+			scratch.blackboards.resize(count);
+			scratch.agents.resize(count);
+			scratch.batchResults.resize(count);
+			for (int i = 0; i < count; ++i)
+			{
+				const int agent = scratch.order[first + i];
+				scratch.blackboards[i] = ppInstances[agent]->m_pBlackBoard;
+				scratch.agents[i] = pAgents ? pAgents[agent] : agent;
+			}
+
+			BehaviorBatch batch{};
+			batch.ppBlackBoards = scratch.blackboards.data();
+			batch.pAgents = scratch.agents.data();
+			batch.nrOfAgents = count;
+			RunBatch(n, batch, scratch.batchResults.data());
+
+			for (int i = 0; i < count; ++i)
+				scratch.results[scratch.order[first + i]] = scratch.batchResults[i];
+		}
+
+		//Each agent on to its next leaf, the ones that are done drop out
+		scratch.nextPending.clear();
+		for (int agent : scratch.pending)
+		{
+			if (Ascend(scratch.nodes[agent], scratch.results[agent], ppInstances[agent]->m_State))
+				scratch.nextPending.push_back(agent);
+		}
+		scratch.pending.swap(scratch.nextPending);
+	}
+}
+
+bool CompiledBehaviorTree::Ascend(int& node, BehaviorState& result, BehaviorTreeState& state) const
+{
+	//Up through the parents, until one of them continues with a next child or the root is done
+	while (true)
+	{
+		if (result == Running)
+		{
+			state.runningNode = node;
+			state.currentState = Running;
+			return false;
+		}
+
+		const int parent = m_Nodes[node].parent;
+		if (parent == InvalidNode)
+		{
+			state.currentState = result;
+			return false;
+		}
+
+		const Node& parentNode = m_Nodes[parent];
+		const int nextChild = node + 1;
+		const bool hasNextChild = nextChild < parentNode.firstChild + parentNode.nrOfChildren;
+		switch (parentNode.type)
+		{
+		case NodeType::Selector:
+			if (result == Failure && hasNextChild)
+			{
+				node = Descend(nextChild, state);
+				return true;
+			}
+			break;
+		case NodeType::Sequence:
+			if (result == Success && hasNextChild)
+			{
+				node = Descend(nextChild, state);
+				return true;
+			}
+			break;
+		case NodeType::PartialSequence:
+			//A child that succeeds ends the update, the next one resumes at the next child. Like the interpreted
+			//sequence, that holds for the last child too: the sequence only reports Success on the update after it
+			if (result == Success)
+			{
+				state.cursors[parentNode.data] = nextChild - parentNode.firstChild;
+				result = Running;
+			}
+			else
+			{
+				state.cursors[parentNode.data] = 0;
+			}
+			break;
+		default:
+			break;
+		}
+		node = parent;
+	}
+}
+
+int CompiledBehaviorTree::Descend(int node, BehaviorTreeState& state) const
+{
+	while (m_Nodes[node].type < NodeType::Conditional && m_Nodes[node].nrOfChildren > 0)
+	{
+		const Node& composite = m_Nodes[node];
+		if (composite.type == NodeType::PartialSequence)
+		{
+			//Past its last child: all of them succeeded, the sequence itself is the node to run (and succeeds)
+			int& cursor = state.cursors[composite.data];
+			if (cursor == composite.nrOfChildren)
+			{
+				cursor = 0;
+				return node;
+			}
+			node = composite.firstChild + cursor;
+		}
+		else
+		{
+			node = composite.firstChild;
+		}
+	}
+	return node;
+}
+
+BehaviorState CompiledBehaviorTree::Run(int node, Blackboard* pBlackBoard) const
+{
+	const Node& leaf = m_Nodes[node];
+	switch (leaf.type)
+	{
+	case NodeType::Conditional:
+		if (m_Conditionals[leaf.data] == nullptr)
+			return Failure;
+		return m_Conditionals[leaf.data](pBlackBoard) ? Success : Failure;
+	case NodeType::Action:
+		if (m_Actions[leaf.data] == nullptr)
+			return Failure;
+		return m_Actions[leaf.data](pBlackBoard);
+	case NodeType::Selector:
+		return Failure; //Without children
+	default:
+		return Success; //Sequence without children, or partial sequence past its last child
+	}
+}
+
+void CompiledBehaviorTree::RunBatch(int node, const BehaviorBatch& batch, BehaviorState* pResults) const
+{
+	const Node& leaf = m_Nodes[node];
+	if (leaf.type == NodeType::Conditional && m_BatchConditionals[leaf.data] != nullptr)
+	{
+		bool* pConditions = GetConditionResults(batch.nrOfAgents);
+		m_BatchConditionals[leaf.data](batch, pConditions);
+		for (int i = 0; i < batch.nrOfAgents; ++i)
+			pResults[i] = pConditions[i] ? Success : Failure;
+		return;
+	}
+
+	for (int i = 0; i < batch.nrOfAgents; ++i)
+		pResults[i] = Run(node, batch.ppBlackBoards[i]);
+}
@@ -22,6 +22,17 @@ namespace Elite
 		Running
 	};
 
+	//The agents a batched conditional runs for at once (see CompiledBehaviorTree::UpdateBatch)
+	struct BehaviorBatch
+	{
+		Blackboard* const* ppBlackBoards = nullptr;
+		const int* pAgents = nullptr; //The ids the caller passed for these agents, e.g. to index its own SoA data
+		int nrOfAgents = 0;
+	};
+
+	class CompiledBehaviorTree;
+	class BehaviorTreeInstance;
+
 	//-----------------------------------------------------------------
 	// BEHAVIOR INTERFACES (BASE)
 	//-----------------------------------------------------------------
@@ -31,6 +42,8 @@ namespace Elite
 		IBehavior() = default;
 		virtual ~IBehavior() = default;
 		virtual BehaviorState Execute(Blackboard* pBlackBoard) = 0;
+		//Writes the behavior (and its children) to the node the parent allocated in the compiled tree
+		virtual void Compile(CompiledBehaviorTree& tree, int node) const = 0;
 
 	protected:
 		BehaviorState m_CurrentState = Failure;
@@ -68,6 +81,7 @@ namespace Elite
 		virtual ~BehaviorSelector() = default;
 
 		virtual BehaviorState Execute(Blackboard* pBlackBoard) override;
+		virtual void Compile(CompiledBehaviorTree& tree, int node) const override;
 	};
 
 	//--- SEQUENCE ---
@@ -79,6 +93,7 @@ namespace Elite
 		virtual ~BehaviorSequence() = default;
 
 		virtual BehaviorState Execute(Blackboard* pBlackBoard) override;
+		virtual void Compile(CompiledBehaviorTree& tree, int node) const override;
 	};
 
 	//--- PARTIAL SEQUENCE ---
@@ -90,6 +105,7 @@ namespace Elite
 		virtual ~BehaviorPartialSequence() = default;
 
 		virtual BehaviorState Execute(Blackboard* pBlackBoard) override;
+		virtual void Compile(CompiledBehaviorTree& tree, int node) const override;
 
 	private:
 		unsigned int m_CurrentBehaviorIndex = 0;
@@ -103,10 +119,15 @@ namespace Elite
 	{
 	public:
 		explicit BehaviorConditional(std::function<bool(Blackboard*)> fp) : m_fpConditional(fp) {}
+		//fpBatch evaluates the conditional for all the agents of a batched update at once (one result per agent)
+		BehaviorConditional(std::function<bool(Blackboard*)> fp, std::function<void(const BehaviorBatch&, bool*)> fpBatch)
+			: m_fpConditional(fp), m_fpBatchConditional(fpBatch) {}
 		virtual BehaviorState Execute(Blackboard* pBlackBoard) override;
+		virtual void Compile(CompiledBehaviorTree& tree, int node) const override;
 
 	private:
 		std::function<bool(Blackboard*)> m_fpConditional = nullptr;
+		std::function<void(const BehaviorBatch&, bool*)> m_fpBatchConditional = nullptr;
 	};
 
 	//-----------------------------------------------------------------
@@ -117,6 +138,7 @@ namespace Elite
 	public:
 		explicit BehaviorAction(std::function<BehaviorState(Blackboard*)> fp) : m_fpAction(fp) {}
 		virtual BehaviorState Execute(Blackboard* pBlackBoard) override;
+		virtual void Compile(CompiledBehaviorTree& tree, int node) const override;
 
 	private:
 		std::function<BehaviorState(Blackboard*)> m_fpAction = nullptr;
@@ -154,5 +176,110 @@ namespace Elite
 		Blackboard* m_pBlackBoard = nullptr;
 		IBehavior* m_pRootComposite = nullptr;
 	};
+
+	//-----------------------------------------------------------------
+	// COMPILED BEHAVIOR TREE
+	//-----------------------------------------------------------------
+	//Per agent state of a compiled tree, the tree itself is shared
+	struct BehaviorTreeState
+	{
+		int runningNode = -1; //Where the next update resumes, -1 is from the root
+		std::vector<int> cursors{}; //Next child of every partial sequence
+		BehaviorState currentState = Failure;
+	};
+
+	//The behaviors flattened into one node array: the children of a node are next to each other, so a node only needs the
+	//range of its children and its parent. An update resumes at the node that was running instead of at the root, walks
+	//down to a leaf and back up through the parents without recursion or virtual calls. The tree doesn't change after
+	//compiling, so one tree can drive any number of agents, each with its own BehaviorTreeState and blackboard.
+	class CompiledBehaviorTree final
+	{
+	public:
+		static const int InvalidNode = -1;
+
+		enum class NodeType
+		{
+			Selector,
+			Sequence,
+			PartialSequence,
+			Conditional,
+			Action
+		};
+
+		//Doesn't take ownership of the behaviors, they can be deleted once compiled
+		explicit CompiledBehaviorTree(const IBehavior* pRoot);
+
+		BehaviorState Update(BehaviorTreeState& state, Blackboard* pBlackBoard) const;
+		//Updates agents that all run this tree together: the agents are moved through the tree as a group, and every leaf
+		//runs once for all the agents that reached it (a conditional's batch function, or the single one per agent).
+		//pAgents (can be nullptr, then the index in ppInstances is used) is passed on to the batch conditionals
+		void UpdateBatch(BehaviorTreeInstance* const* ppInstances, const int* pAgents, int nrOfAgents) const;
+		int GetNrOfNodes() const { return int(m_Nodes.size()); }
+
+		//Used by IBehavior::Compile
+		void CompileComposite(int node, NodeType type, const std::vector<IBehavior*>& childrenBehaviors);
+		void CompileConditional(int node, const std::function<bool(Blackboard*)>& fpConditional,
+			const std::function<void(const BehaviorBatch&, bool*)>& fpBatchConditional);
+		void CompileAction(int node, const std::function<BehaviorState(Blackboard*)>& fpAction);
+
+	private:
+		struct Node
+		{
+			NodeType type = NodeType::Action;
+			int parent = InvalidNode;
+			int firstChild = 0;
+			int nrOfChildren = 0;
+			int data = 0; //Index of the conditional or action, or the cursor of a partial sequence
+		};
+
+		std::vector<Node> m_Nodes{};
+		std::vector<std::function<bool(Blackboard*)>> m_Conditionals{};
+		std::vector<std::function<void(const BehaviorBatch&, bool*)>> m_BatchConditionals{};
+		std::vector<std::function<BehaviorState(Blackboard*)>> m_Actions{};
+		int m_NrOfCursors = 0;
+
+		int AllocateNodes(int count, int parent);
+		//From a node down to the leaf (or empty composite, or partial sequence that's done) where its evaluation starts
+		int Descend(int node, BehaviorTreeState& state) const;
+		BehaviorState Run(int node, Blackboard* pBlackBoard) const;
+		void RunBatch(int node, const BehaviorBatch& batch, BehaviorState* pResults) const;
+		//From a node that finished with result up through its parents. True when a parent continues with another child,
+		//node is then the next leaf to run. False when the update is done (or running), state is then up to date
+		bool Ascend(int& node, BehaviorState& result, BehaviorTreeState& state) const;
+	};
+
+	//An agent running a shared compiled tree
+	class BehaviorTreeInstance final : public Elite::IDecisionMaking
+	{
+	public:
+		explicit BehaviorTreeInstance(const CompiledBehaviorTree* pTree, Blackboard* pBlackBoard)
+			: m_pTree(pTree), m_pBlackBoard(pBlackBoard) {};
+		~BehaviorTreeInstance()
+		{
+			SAFE_DELETE(m_pBlackBoard); //Takes ownership of passed blackboard, not of the tree!
+		};
+
+		virtual void Update(float deltaTime) override
+		{
+			if (m_pTree == nullptr)
+			{
+				m_State.currentState = Failure;
+				return;
+			}
+
+			m_pTree->Update(m_State, m_pBlackBoard);
+		}
+		Blackboard* GetBlackboard() const
+		{ return m_pBlackBoard; }
+		const BehaviorTreeState& GetState() const
+		{ return m_State; }
+
+	private:
+		friend class CompiledBehaviorTree; //UpdateBatch
+
+		const CompiledBehaviorTree* m_pTree = nullptr;
+		Blackboard* m_pBlackBoard = nullptr;
+		BehaviorTreeState m_State{};
+	};
 }
 #endif
\ No newline at end of file
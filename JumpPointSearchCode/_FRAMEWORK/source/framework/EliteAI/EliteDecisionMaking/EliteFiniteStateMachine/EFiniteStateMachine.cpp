@@ -3,10 +3,9 @@
 #include "EFiniteStateMachine.h"
 
 Elite::FiniteStateMachine::FiniteStateMachine(Elite::FSMState* startState, Elite::Blackboard* pBlackboard)
-    : m_pCurrentState(nullptr),
-    m_pBlackboard(pBlackboard)
+    : m_pBlackboard(pBlackboard)
 {
-    ChangeState(startState);
+    ChangeState(GetStateId(startState));
 }
 
 Elite::FiniteStateMachine::~FiniteStateMachine()
@@ -16,40 +15,62 @@ Elite::FiniteStateMachine::~FiniteStateMachine()
 
 void Elite::FiniteStateMachine::AddTransition(Elite::FSMState* startState, Elite::FSMState* toState, Elite::FSMTransition* transition)
 {
-    auto it = m_Transitions.find(startState);
-    if (it == m_Transitions.end())
+    AddTransition(startState, toState, transition, {});
+}
+
+void Elite::FiniteStateMachine::AddTransition(Elite::FSMState* startState, Elite::FSMState* toState, Elite::FSMTransition* transition, const std::vector<BlackboardKey>& watchedKeys)
+{
+    const int fromId = GetStateId(startState);
+    const int toId = GetStateId(toState);
+    if (fromId == InvalidState)
+        return;
+
+    Transition newTransition{};
+    newTransition.pTransition = transition;
+    newTransition.toState = toId;
+    newTransition.firstWatchedKey = int(m_WatchedKeys.size());
+    newTransition.nrOfWatchedKeys = int(watchedKeys.size());
+    m_WatchedKeys.insert(m_WatchedKeys.end(), watchedKeys.begin(), watchedKeys.end());
+
+    //At the end of the transitions of the start state, the ranges after it move up
+    const int insertAt = m_TransitionRanges[fromId].first + m_TransitionRanges[fromId].count;
+    m_Transitions.insert(m_Transitions.begin() + insertAt, newTransition);
+    for (int i = 0; i < int(m_TransitionRanges.size()); ++i)
     {
-        m_Transitions[startState] = Transitions();
+        if (i != fromId && m_TransitionRanges[i].first >= insertAt)
+            ++m_TransitionRanges[i].first;
     }
-   
-    m_Transitions[startState].push_back(std::make_pair(transition, toState));
+    ++m_TransitionRanges[fromId].count;
 }
 
 void Elite::FiniteStateMachine::Update(float deltaTime)
 {
-    //TODO 4: Look if 1 or more transition exists for the current state that we are in
-    //Tip: Check the transitions map for a TransitionState pair
-    auto it = m_Transitions.find(m_pCurrentState);
-    
-
-    //TODO 5: if a TransitionState exists
-    if (it != m_Transitions.end())
+    //The first transition of the current state that fires changes the state
+    if (m_CurrentState != InvalidState)
     {
-        //TODO 6: Loop over all the TransitionState pairs
-        for (auto transPair : it->second)
+        const TransitionRange& range = m_TransitionRanges[m_CurrentState];
+        for (int i = range.first; i < range.first + range.count; ++i)
         {
-            //TODO 7: If a ToTransition returns true => transition to the new corresponding state
-            if (transPair.first->ToTransition(m_pBlackboard))
+            Transition& transition = m_Transitions[i];
+            if (transition.nrOfWatchedKeys > 0)
             {
-                ChangeState(transPair.second);
+                const unsigned int versions = GetWatchedVersions(transition.firstWatchedKey, transition.nrOfWatchedKeys);
+                if (transition.isChecked && versions == transition.checkedVersions)
+                    continue;
+                transition.checkedVersions = versions;
+                transition.isChecked = true;
+            }
+
+            if (transition.pTransition->ToTransition(m_pBlackboard))
+            {
+                ChangeState(transition.toState);
                 break;
             }
         }
     }
 
-    //TODO 8: Update the current state (if one exists ;-))
-    if (m_pCurrentState)
-        m_pCurrentState->Update(m_pBlackboard, deltaTime);
+    if (m_CurrentState != InvalidState)
+        m_pStates[m_CurrentState]->Update(m_pBlackboard, deltaTime);
 }
 
 Elite::Blackboard* Elite::FiniteStateMachine::GetBlackboard() const
@@ -57,17 +78,47 @@ Elite::Blackboard* Elite::FiniteStateMachine::GetBlackboard() const
     return m_pBlackboard;
 }
 
-void Elite::FiniteStateMachine::ChangeState(FSMState* newState)
+int Elite::FiniteStateMachine::GetStateId(FSMState* pState)
+{
+    if (pState == nullptr)
+        return InvalidState;
+
+    //Only while setting up the machine, the updates use the ids
+    for (int i = 0; i < int(m_pStates.size()); ++i)
+    {
+        if (m_pStates[i] == pState)
+            return i;
+    }
+
+    m_pStates.push_back(pState);
+    TransitionRange range{};
+    range.first = int(m_Transitions.size());
+    m_TransitionRanges.push_back(range);
+    return int(m_pStates.size()) - 1;
+}
+
+void Elite::FiniteStateMachine::ChangeState(int newState)
 {
-    //TODO 1. If currently in a state => make sure the OnExit of that state gets called
-    if (m_pCurrentState)
-        m_pCurrentState->OnExit(m_pBlackboard);
+    if (m_CurrentState != InvalidState)
+        m_pStates[m_CurrentState]->OnExit(m_pBlackboard);
 
-    //TODO 2. Change the current state to the new state
-    m_pCurrentState = newState;
+    m_CurrentState = newState;
 
-    //TODO 3. Call the OnEnter of the new state
-    if (m_pCurrentState)
-        m_pCurrentState->OnEnter(m_pBlackboard);
-        
+    if (m_CurrentState != InvalidState)
+    {
+        //The watching transitions of the new state are checked at least once
+        const TransitionRange& range = m_TransitionRanges[m_CurrentState];
+        for (int i = range.first; i < range.first + range.count; ++i)
+            m_Transitions[i].isChecked = false;
+
+        m_pStates[m_CurrentState]->OnEnter(m_pBlackboard);
+    }
+}
+
+unsigned int Elite::FiniteStateMachine::GetWatchedVersions(int firstWatchedKey, int nrOfWatchedKeys) const
+{
+    unsigned int versions = 0;
+    for (int i = firstWatchedKey; i < firstWatchedKey + nrOfWatchedKeys; ++i)
+        versions += m_pBlackboard->GetVersion(m_WatchedKeys[i]);
+    return versions;
 }
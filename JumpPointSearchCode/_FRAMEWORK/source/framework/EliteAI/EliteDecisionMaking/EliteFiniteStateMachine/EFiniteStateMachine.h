@@ -30,24 +30,51 @@ namespace Elite
 		virtual bool ToTransition(Blackboard* pBlackboard) const = 0;
 	};
 
+	//The states get dense ids as they're added, the transitions of a state are next to each other in one array. An update
+	//only checks the transitions of the current state, through its index. Transitions that only depend on the blackboard
+	//can watch their data: they're only checked when it changed, instead of every update
 	class FiniteStateMachine final : public Elite::IDecisionMaking
 	{
 	public:
+		static const int InvalidState = -1;
+
 		FiniteStateMachine(FSMState* startState, Blackboard* pBlackboard);
 		virtual ~FiniteStateMachine();
 		
 		void AddTransition(FSMState* startState, FSMState* toState, FSMTransition* transition);
+		//Checked when one of the watched blackboard data changed since the last check, and once after entering startState
+		void AddTransition(FSMState* startState, FSMState* toState, FSMTransition* transition, const std::vector<BlackboardKey>& watchedKeys);
 		virtual void Update(float deltaTime) override;
 		Elite::Blackboard* GetBlackboard() const;
 
 	private:
-		void ChangeState(FSMState* newState);
+		//Id of the state, adds it when it's new
+		int GetStateId(FSMState* pState);
+		void ChangeState(int newState);
+		//Sum of the versions of the watched data, changes when any of them changed
+		unsigned int GetWatchedVersions(int firstWatchedKey, int nrOfWatchedKeys) const;
 	private:
-		typedef std::pair<FSMTransition*, FSMState*> TransitionStatePair;
-		typedef std::vector<TransitionStatePair> Transitions;
+		struct Transition
+		{
+			FSMTransition* pTransition = nullptr;
+			int toState = InvalidState;
+			int firstWatchedKey = 0;
+			int nrOfWatchedKeys = 0; //0 is checked every update
+			unsigned int checkedVersions = 0;
+			bool isChecked = false; //Since the state was entered
+		};
+
+		struct TransitionRange
+		{
+			int first = 0;
+			int count = 0;
+		};
 
-		std::map<FSMState*, Transitions> m_Transitions; //Key is the state, value are all the transitions for that current state 
-		FSMState* m_pCurrentState;
+		std::vector<FSMState*> m_pStates{}; //Index is the id
+		std::vector<TransitionRange> m_TransitionRanges{}; //Per state, in m_Transitions
+		std::vector<Transition> m_Transitions{};
+		std::vector<BlackboardKey> m_WatchedKeys{};
+		int m_CurrentState = InvalidState;
 		Blackboard* m_pBlackboard = nullptr; // takes ownership of the blackboard
 	};
 
@@ -0,0 +1,219 @@
+#include "stdafx.h"
+#include "EGraphBlob.h"
+
+using namespace Elite;
+
+namespace
+{
+	template<typename T>
+	bool IsSectionValid(const BlobSection& section, size_t blobSize)
+	{
+		if (section.offset % alignof(T) != 0)
+			return false;
+		const uint64_t end = uint64_t(section.offset) + uint64_t(section.count) * sizeof(T);
+		return end <= blobSize;
+	}
+
+	bool IsHeaderValid(const void* pData, size_t size, size_t headerSize, GraphBlobType type)
+	{
+		if (pData == nullptr || size < headerSize)
+			return false;
+
+		const auto pHeader = static_cast<const GraphBlobHeader*>(pData);
+		if (pHeader->magic != GraphBlobMagic)
+		{
+			std::cout << "WARNING: graph blob has an invalid magic number" << std::endl;
+			return false;
+		}
+		if (pHeader->version != GraphBlobVersion)
+		{
+			std::cout << "WARNING: graph blob version " << pHeader->version << " does not match " << GraphBlobVersion << ", rebake the data" << std::endl;
+			return false;
+		}
+		return pHeader->type == type && pHeader->headerSize == headerSize && pHeader->totalSize <= size;
+	}
+
+	//The CSR offsets must be monotonic and end exactly at the number of connections
+	bool IsCSRValid(const uint32_t* pOffsets, uint32_t nrOfNodes, uint32_t nrOfConnections)
+	{
+		if (pOffsets[0] != 0 || pOffsets[nrOfNodes] != nrOfConnections)
+			return false;
+		for (uint32_t i = 0; i < nrOfNodes; ++i)
+		{
+			if (pOffsets[i] > pOffsets[i + 1])
+				return false;
+		}
+		return true;
+	}
+
+	bool IsIndexValid(int32_t idx, uint32_t count)
+	{
+		return idx >= 0 && uint32_t(idx) < count;
+	}
+
+	//Every connection has to end at an existing node
+	bool AreConnectionsValid(const BakedConnection* pConnections, uint32_t nrOfConnections, uint32_t nrOfNodes)
+	{
+		for (uint32_t i = 0; i < nrOfConnections; ++i)
+		{
+			if (!IsIndexValid(pConnections[i].to, nrOfNodes))
+				return false;
+		}
+		return true;
+	}
+
+	//The records index into the other sections, a stale or corrupt blob could point past them
+	bool AreNavGraphIndicesValid(const char* pData, const NavGraphBlobHeader& header)
+	{
+		const auto pShapes = reinterpret_cast<const BakedShape*>(pData + header.shapes.offset);
+		if (header.shapes.count == 0) //Shape 0 is the contour
+			return false;
+		for (uint32_t i = 0; i < header.shapes.count; ++i)
+		{
+			if (uint64_t(pShapes[i].firstPoint) + pShapes[i].pointCount > header.points.count)
+				return false;
+		}
+
+		const auto pTriangles = reinterpret_cast<const BakedTriangle*>(pData + header.triangles.offset);
+		for (uint32_t i = 0; i < header.triangles.count; ++i)
+		{
+			for (int32_t lineIdx : pTriangles[i].lines)
+			{
+				if (!IsIndexValid(lineIdx, header.lines.count))
+					return false;
+			}
+		}
+
+		const auto pNodes = reinterpret_cast<const BakedNavNode*>(pData + header.nodes.offset);
+		for (uint32_t i = 0; i < header.nodes.count; ++i)
+		{
+			if (!IsIndexValid(pNodes[i].lineIdx, header.lines.count))
+				return false;
+		}
+
+		const auto pConnections = reinterpret_cast<const BakedConnection*>(pData + header.connections.offset);
+		return AreConnectionsValid(pConnections, header.connections.count, header.nodes.count);
+	}
+}
+
+#pragma region NavGraphBlob
+bool Elite::NavGraphBlob::Open(const void* pData, size_t size)
+{
+	m_pData = nullptr;
+	m_pHeader = nullptr;
+
+	if (!IsHeaderValid(pData, size, sizeof(NavGraphBlobHeader), GraphBlobType::NavGraph))
+		return false;
+
+	const auto pHeader = static_cast<const NavGraphBlobHeader*>(pData);
+	const bool sectionsValid =
+		IsSectionValid<BakedShape>(pHeader->shapes, size) &&
+		IsSectionValid<Vector2>(pHeader->points, size) &&
+		IsSectionValid<BakedTriangle>(pHeader->triangles, size) &&
+		IsSectionValid<BakedLine>(pHeader->lines, size) &&
+		IsSectionValid<BakedNavNode>(pHeader->nodes, size) &&
+		IsSectionValid<uint32_t>(pHeader->connectionOffsets, size) &&
+		IsSectionValid<BakedConnection>(pHeader->connections, size) &&
+		pHeader->connectionOffsets.count == pHeader->nodes.count + 1;
+	if (!sectionsValid)
+	{
+		std::cout << "WARNING: navigation graph blob is truncated or corrupt" << std::endl;
+		return false;
+	}
+
+	const auto pOffsets = reinterpret_cast<const uint32_t*>(static_cast<const char*>(pData) + pHeader->connectionOffsets.offset);
+	if (!IsCSRValid(pOffsets, pHeader->nodes.count, pHeader->connections.count))
+	{
+		std::cout << "WARNING: navigation graph blob has invalid connection offsets" << std::endl;
+		return false;
+	}
+
+	if (!AreNavGraphIndicesValid(static_cast<const char*>(pData), *pHeader))
+	{
+		std::cout << "WARNING: navigation graph blob has out of range indices" << std::endl;
+		return false;
+	}
+
+	m_pData = static_cast<const char*>(pData);
+	m_pHeader = pHeader;
+	return true;
+}
+
+BlobArray<Vector2> Elite::NavGraphBlob::GetShapePoints(uint32_t shapeIdx) const
+{
+	const BakedShape& shape = GetShapes()[shapeIdx];
+	return { GetPoints().pData + shape.firstPoint, shape.pointCount };
+}
+
+BlobArray<BakedConnection> Elite::NavGraphBlob::GetConnections(int nodeIdx) const
+{
+	const auto offsets = GetSection<uint32_t>(m_pHeader->connectionOffsets);
+	const auto connections = GetSection<BakedConnection>(m_pHeader->connections);
+	return { connections.pData + offsets[nodeIdx], offsets[nodeIdx + 1] - offsets[nodeIdx] };
+}
+#pragma endregion //NavGraphBlob
+
+#pragma region GridGraphBlob
+bool Elite::GridGraphBlob::Open(const void* pData, size_t size)
+{
+	m_pData = nullptr;
+	m_pHeader = nullptr;
+
+	if (!IsHeaderValid(pData, size, sizeof(GridGraphBlobHeader), GraphBlobType::GridGraph))
+		return false;
+
+	const auto pHeader = static_cast<const GridGraphBlobHeader*>(pData);
+	//Widen before multiplying, every cell needs at least its terrain in the blob
+	const uint64_t nrOfCellsWide = pHeader->columns > 0 && pHeader->rows > 0 ? uint64_t(pHeader->columns) * uint64_t(pHeader->rows) : 0;
+	const uint32_t nrOfCells = uint32_t(nrOfCellsWide);
+	const bool sectionsValid =
+		nrOfCellsWide > 0 && nrOfCellsWide <= size / sizeof(int32_t) &&
+		IsSectionValid<int32_t>(pHeader->terrain, size) &&
+		IsSectionValid<uint32_t>(pHeader->connectionOffsets, size) &&
+		IsSectionValid<BakedConnection>(pHeader->connections, size) &&
+		pHeader->terrain.count == nrOfCells &&
+		pHeader->connectionOffsets.count == nrOfCells + 1;
+	if (!sectionsValid)
+	{
+		std::cout << "WARNING: grid graph blob is truncated or corrupt" << std::endl;
+		return false;
+	}
+
+	const auto pOffsets = reinterpret_cast<const uint32_t*>(static_cast<const char*>(pData) + pHeader->connectionOffsets.offset);
+	if (!IsCSRValid(pOffsets, nrOfCells, pHeader->connections.count))
+	{
+		std::cout << "WARNING: grid graph blob has invalid connection offsets" << std::endl;
+		return false;
+	}
+
+	const auto pConnections = reinterpret_cast<const BakedConnection*>(static_cast<const char*>(pData) + pHeader->connections.offset);
+	if (!AreConnectionsValid(pConnections, pHeader->connections.count, nrOfCells))
+	{
+		std::cout << "WARNING: grid graph blob has out of range indices" << std::endl;
+		return false;
+	}
+
+	m_pData = static_cast<const char*>(pData);
+	m_pHeader = pHeader;
+	return true;
+}
+
+BlobArray<BakedConnection> Elite::GridGraphBlob::GetConnections(int nodeIdx) const
+{
+	const auto offsets = GetSection<uint32_t>(m_pHeader->connectionOffsets);
+	const auto connections = GetSection<BakedConnection>(m_pHeader->connections);
+	return { connections.pData + offsets[nodeIdx], offsets[nodeIdx + 1] - offsets[nodeIdx] };
+}
+#pragma endregion //GridGraphBlob
+
+bool Elite::GraphBlobWriter::SaveToFile(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::cout << "WARNING: could not write graph blob to " << path << std::endl;
+		return false;
+	}
+	file.write(m_Buffer.data(), m_Buffer.size());
+	return file.good();
+}
@@ -0,0 +1,221 @@
+#pragma once
+// EGraphBlob.h: versioned binary format for baked graphs.
+// A blob is one contiguous block: a fixed header followed by sections that are addressed by byte offset from the
+// start of the blob (never by pointer). The data is therefore relocatable and is used in place, straight from a
+// memory mapped file, without any parsing or per-node allocation.
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace Elite
+{
+#pragma region Format
+	static constexpr uint32_t GraphBlobMagic = 0x42474C45; // "ELGB"
+	static constexpr uint16_t GraphBlobVersion = 3; //Bump when the data a bake produces changes, 3: portal widths from the clearance next to the portal, 4: source hash
+	static constexpr uint32_t GraphBlobAlignment = 8;
+
+	enum class GraphBlobType : uint32_t
+	{
+		NavGraph = 1,
+		GridGraph = 2
+	};
+
+	struct BlobSection final
+	{
+		uint32_t offset = 0; //Byte offset from the start of the blob
+		uint32_t count = 0; //Number of elements
+	};
+
+	struct GraphBlobHeader final
+	{
+		uint32_t magic = GraphBlobMagic;
+		uint16_t version = GraphBlobVersion;
+		uint16_t headerSize = 0;
+		GraphBlobType type = GraphBlobType::NavGraph;
+		uint32_t totalSize = 0;
+	};
+
+	//FNV-1a, fingerprints the input a graph was baked from so a stale blob can be detected
+	inline uint64_t HashGraphBlobInput(const void* pData, size_t size, uint64_t hash = 14695981039346656037ull)
+	{
+		const auto pBytes = static_cast<const unsigned char*>(pData);
+		for (size_t i = 0; i < size; ++i)
+			hash = (hash ^ pBytes[i]) * 1099511628211ull;
+		return hash;
+	}
+
+	//Range of points in the points section, shape 0 is the contour, the others are the (expanded) obstacles
+	struct BakedShape final
+	{
+		uint32_t firstPoint = 0;
+		uint32_t pointCount = 0;
+	};
+
+	struct BakedTriangle final
+	{
+		Vector2 p1;
+		Vector2 p2;
+		Vector2 p3;
+		int32_t lines[3];
+	};
+
+	struct BakedLine final
+	{
+		Vector2 p1;
+		Vector2 p2;
+		int32_t index;
+	};
+
+	struct BakedNavNode final
+	{
+		Vector2 position;
+		int32_t lineIdx;
+		float portalWidth;
+	};
+
+	struct BakedConnection final
+	{
+		int32_t to;
+		float cost;
+	};
+
+	struct NavGraphBlobHeader final
+	{
+		GraphBlobHeader header;
+		uint64_t sourceHash = 0; //NavGraph::HashSource of the contour, obstacles and player radius the mesh was built from
+		uint32_t isDirectional = 0;
+		BlobSection shapes; //BakedShape
+		BlobSection points; //Vector2
+		BlobSection triangles; //BakedTriangle
+		BlobSection lines; //BakedLine
+		BlobSection nodes; //BakedNavNode
+		BlobSection connectionOffsets; //uint32_t, nodes.count + 1 entries (CSR)
+		BlobSection connections; //BakedConnection
+	};
+
+	struct GridGraphBlobHeader final
+	{
+		GraphBlobHeader header;
+		uint32_t isDirectional = 0;
+		uint32_t isConnectedDiagonally = 0;
+		int32_t columns = 0;
+		int32_t rows = 0;
+		int32_t cellSize = 0;
+		float costStraight = 1.f;
+		float costDiagonal = 1.5f;
+		BlobSection terrain; //int32_t TerrainType per cell, row major
+		BlobSection connectionOffsets; //uint32_t, cells + 1 entries (CSR)
+		BlobSection connections; //BakedConnection
+	};
+
+	static_assert(std::is_trivially_copyable<Vector2>::value && sizeof(Vector2) == 2 * sizeof(float), "Vector2 must stay a plain pair of floats to be baked");
+#pragma endregion //Format
+
+#pragma region Views
+	//Non owning view on an array inside a blob
+	template<typename T>
+	struct BlobArray final
+	{
+		const T* pData = nullptr;
+		uint32_t count = 0;
+
+		const T* begin() const { return pData; }
+		const T* end() const { return pData + count; }
+		uint32_t size() const { return count; }
+		bool empty() const { return count == 0; }
+		const T& operator[](uint32_t idx) const { return pData[idx]; }
+	};
+
+	class NavGraphBlob final
+	{
+	public:
+		NavGraphBlob() = default;
+		NavGraphBlob(const void* pData, size_t size) { Open(pData, size); }
+
+		//Validates the header, the section bounds and every index in the records, the data itself is used in place
+		bool Open(const void* pData, size_t size);
+		bool IsValid() const { return m_pHeader != nullptr; }
+
+		const NavGraphBlobHeader& GetHeader() const { return *m_pHeader; }
+		BlobArray<BakedShape> GetShapes() const { return GetSection<BakedShape>(m_pHeader->shapes); }
+		BlobArray<Vector2> GetPoints() const { return GetSection<Vector2>(m_pHeader->points); }
+		BlobArray<Vector2> GetShapePoints(uint32_t shapeIdx) const;
+		BlobArray<BakedTriangle> GetTriangles() const { return GetSection<BakedTriangle>(m_pHeader->triangles); }
+		BlobArray<BakedLine> GetLines() const { return GetSection<BakedLine>(m_pHeader->lines); }
+		BlobArray<BakedNavNode> GetNodes() const { return GetSection<BakedNavNode>(m_pHeader->nodes); }
+		BlobArray<BakedConnection> GetConnections(int nodeIdx) const;
+
+	private:
+		const char* m_pData = nullptr;
+		const NavGraphBlobHeader* m_pHeader = nullptr;
+
+		template<typename T>
+		BlobArray<T> GetSection(const BlobSection& section) const
+		{ return { reinterpret_cast<const T*>(m_pData + section.offset), section.count }; }
+	};
+
+	class GridGraphBlob final
+	{
+	public:
+		GridGraphBlob() = default;
+		GridGraphBlob(const void* pData, size_t size) { Open(pData, size); }
+
+		bool Open(const void* pData, size_t size);
+		bool IsValid() const { return m_pHeader != nullptr; }
+
+		const GridGraphBlobHeader& GetHeader() const { return *m_pHeader; }
+		BlobArray<int32_t> GetTerrain() const { return GetSection<int32_t>(m_pHeader->terrain); }
+		BlobArray<BakedConnection> GetConnections(int nodeIdx) const;
+
+	private:
+		const char* m_pData = nullptr;
+		const GridGraphBlobHeader* m_pHeader = nullptr;
+
+		template<typename T>
+		BlobArray<T> GetSection(const BlobSection& section) const
+		{ return { reinterpret_cast<const T*>(m_pData + section.offset), section.count }; }
+	};
+#pragma endregion //Views
+
+#pragma region Writer
+	//Builds a blob in memory, sections are appended aligned and the header is patched in at the end
+	class GraphBlobWriter final
+	{
+	public:
+		explicit GraphBlobWriter(size_t headerSize) : m_Buffer(headerSize, 0) {}
+
+		template<typename T>
+		BlobSection Write(const T* pData, size_t count)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable data can be baked");
+			Align();
+			BlobSection section{ static_cast<uint32_t>(m_Buffer.size()), static_cast<uint32_t>(count) };
+			const char* pBytes = reinterpret_cast<const char*>(pData);
+			m_Buffer.insert(m_Buffer.end(), pBytes, pBytes + count * sizeof(T));
+			return section;
+		}
+		template<typename T>
+		BlobSection Write(const std::vector<T>& data) { return Write(data.data(), data.size()); }
+
+		template<typename T_HeaderType>
+		void WriteHeader(T_HeaderType header, GraphBlobType type)
+		{
+			Align();
+			header.header = GraphBlobHeader{};
+			header.header.type = type;
+			header.header.headerSize = static_cast<uint16_t>(sizeof(T_HeaderType));
+			header.header.totalSize = static_cast<uint32_t>(m_Buffer.size());
+			memcpy(m_Buffer.data(), &header, sizeof(T_HeaderType));
+		}
+
+		const std::vector<char>& GetBuffer() const { return m_Buffer; }
+		bool SaveToFile(const std::string& path) const;
+
+	private:
+		std::vector<char> m_Buffer;
+
+		void Align() { m_Buffer.resize((m_Buffer.size() + GraphBlobAlignment - 1) & ~size_t(GraphBlobAlignment - 1), 0); }
+	};
+#pragma endregion //Writer
+}
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cfloat>
 #include "EGraphEnums.h"
 #include "EliteGraphUtilities/EGraphVisuals.h"
 
@@ -93,8 +94,13 @@ namespace Elite
 			: GraphNode2D(index, pos), m_LineIdx(lineIdx){}
 		virtual ~NavGraphNode() = default;
 		int GetLineIndex() const { return m_LineIdx; };
+
+		//Width of the portal (navmesh edge) this node sits on, agents wider than this can't pass through it
+		float GetPortalWidth() const { return m_PortalWidth; }
+		void SetPortalWidth(float width) { m_PortalWidth = width; }
 	protected:
 		int m_LineIdx;
+		float m_PortalWidth = FLT_MAX;
 	};
 
 	class InfluenceNode final : public Elite::GraphNode2D
@@ -9,6 +9,7 @@
 #include "EIGraph.h"
 #include "EGraphConnectionTypes.h"
 #include "EGraphNodeTypes.h"
+#include "EGraphBlob.h"
 
 namespace Elite
 {
@@ -19,6 +20,11 @@ namespace Elite
 		GridGraph(bool isDirectional);
 		GridGraph(int columns, int rows, int cellSize, bool isDirectionalGraph, bool isConnectedDiagonally, float costStraight = 1.f, float costDiagonal = 1.5);
 		void InitializeGrid(int columns, int rows, int cellSize, bool isDirectionalGraph, bool isConnectedDiagonally, float costStraight = 1.f, float costDiagonal = 1.5);
+		void InitializeGrid(const GridGraphBlob& bakedGrid); //Restores a baked grid, connections are taken as is instead of being rebuilt
+
+		//Writes the grid (terrain and connections) to the baked blob format, load it with MappedFile + GridGraphBlob
+		GraphBlobWriter Bake() const;
+		bool Bake(const std::string& path) const { return Bake().SaveToFile(path); }
 
 		using IGraph::GetNode;
 		T_NodeType* GetNode(int col, int row) const { return m_Nodes[GetIndex(col, row)]; }
@@ -27,6 +33,7 @@ namespace Elite
 
 		int GetRows() const { return m_NrOfRows; }
 		int GetColumns() const { return m_NrOfColumns; }
+		int GetCellSize() const { return m_CellSize; }
 
 		bool IsWithinBounds(int col, int row) const;
 		int GetIndex(int col, int row) const { return row * m_NrOfColumns + col; }
@@ -61,6 +68,10 @@ namespace Elite
 		void AddConnectionsInDirections(int idx, int col, int row, vector<Vector2> directions);
 
 		float CalculateConnectionCost(int fromIdx, int toIdx) const;
+
+		// baking helper functions, only terrain nodes store terrain
+		int32_t GetBakedTerrain(int idx) const { return int32_t(TerrainType::Ground); }
+		void SetBakedTerrain(int idx, int32_t terrain) {}
 	
 		friend class GraphRenderer;
 	};
@@ -135,6 +146,82 @@ namespace Elite
 		}
 	}
 
+	template<class T_NodeType, class T_ConnectionType>
+	inline void GridGraph<T_NodeType, T_ConnectionType>::InitializeGrid(const GridGraphBlob& bakedGrid)
+	{
+		const GridGraphBlobHeader& header = bakedGrid.GetHeader();
+		m_IsDirectionalGraph = header.isDirectional != 0;
+		m_NrOfColumns = header.columns;
+		m_NrOfRows = header.rows;
+		m_CellSize = header.cellSize;
+		m_IsConnectedDiagonally = header.isConnectedDiagonally != 0;
+		m_DefaultCostStraight = header.costStraight;
+		m_DefaultCostDiagonal = header.costDiagonal;
+
+		// Create all nodes
+		const auto terrain = bakedGrid.GetTerrain();
+		m_Nodes.reserve(terrain.size());
+		m_Connections.reserve(terrain.size());
+		for (uint32_t idx = 0; idx < terrain.size(); ++idx)
+		{
+			AddNode(new T_NodeType(int(idx)));
+			SetBakedTerrain(int(idx), terrain[idx]);
+		}
+
+		// The baked adjacency already holds both directions, so bypass AddConnection (no uniqueness checks or mirroring)
+		for (uint32_t idx = 0; idx < terrain.size(); ++idx)
+		{
+			for (const auto& bakedConnection : bakedGrid.GetConnections(int(idx)))
+				m_Connections[idx].push_back(new T_ConnectionType(int(idx), bakedConnection.to, bakedConnection.cost));
+		}
+		OnGraphModified(false, true);
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline GraphBlobWriter GridGraph<T_NodeType, T_ConnectionType>::Bake() const
+	{
+		std::vector<int32_t> terrain;
+		std::vector<uint32_t> connectionOffsets;
+		std::vector<BakedConnection> connections;
+		terrain.reserve(m_Nodes.size());
+		connectionOffsets.reserve(m_Nodes.size() + 1);
+		for (int idx = 0; idx < int(m_Nodes.size()); ++idx)
+		{
+			terrain.push_back(GetBakedTerrain(idx));
+			connectionOffsets.push_back(uint32_t(connections.size()));
+			for (const auto pConnection : m_Connections[idx])
+				connections.push_back({ pConnection->GetTo(), pConnection->GetCost() });
+		}
+		connectionOffsets.push_back(uint32_t(connections.size()));
+
+		GraphBlobWriter writer{ sizeof(GridGraphBlobHeader) };
+		GridGraphBlobHeader header{};
+		header.isDirectional = m_IsDirectionalGraph ? 1 : 0;
+		header.isConnectedDiagonally = m_IsConnectedDiagonally ? 1 : 0;
+		header.columns = m_NrOfColumns;
+		header.rows = m_NrOfRows;
+		header.cellSize = m_CellSize;
+		header.costStraight = m_DefaultCostStraight;
+		header.costDiagonal = m_DefaultCostDiagonal;
+		header.terrain = writer.Write(terrain);
+		header.connectionOffsets = writer.Write(connectionOffsets);
+		header.connections = writer.Write(connections);
+		writer.WriteHeader(header, GraphBlobType::GridGraph);
+		return writer;
+	}
+
+	template<>
+	inline int32_t GridGraph<GridTerrainNode, GraphConnection>::GetBakedTerrain(int idx) const
+	{
+		return int32_t(m_Nodes[idx]->GetTerrainType());
+	}
+
+	template<>
+	inline void GridGraph<GridTerrainNode, GraphConnection>::SetBakedTerrain(int idx, int32_t terrain)
+	{
+		m_Nodes[idx]->SetTerrainType(TerrainType(terrain));
+	}
+
 	template<class T_NodeType, class T_ConnectionType>
 	bool GridGraph<T_NodeType, T_ConnectionType>::IsWithinBounds(int col, int row) const
 	{
@@ -0,0 +1,297 @@
+#include "stdafx.h"
+#include "EInfluenceGridKernel.h"
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ELITE_INFLUENCE_AVX2
+#elif defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define ELITE_INFLUENCE_SSE2
+#endif
+
+using namespace Elite;
+
+namespace
+{
+	//Same order as the GridGraph directions: straight { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 }, diagonal { 1, 1 }, { -1, 1 }, { -1, -1 }, { 1, -1 }
+	const int DirectionColumns[InfluenceGridKernel::NrOfDirections] = { 1, 0, -1, 0, 1, -1, -1, 1 };
+	const int DirectionRows[InfluenceGridKernel::NrOfDirections] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+}
+
+void Elite::InfluenceGridKernel::Initialize(int columns, int rows, int nrOfChannels)
+{
+	m_Columns = columns;
+	m_Rows = rows;
+	m_PaddedColumns = columns + 2;
+	m_PlaneSize = m_PaddedColumns * (rows + 2);
+	m_NrOfChannels = nrOfChannels;
+
+	m_Current.assign(size_t(m_PlaneSize) * nrOfChannels, 0.f);
+	m_Next.assign(size_t(m_PlaneSize) * nrOfChannels, 0.f);
+	m_DirectionMasks.assign(m_PlaneSize, 0);
+
+	for (int d = 0; d < NrOfDirections; ++d)
+		m_DirectionOffsets[d] = DirectionRows[d] * m_PaddedColumns + DirectionColumns[d];
+
+	m_NrOfTileColumns = (columns + TileSize - 1) / TileSize;
+	m_NrOfTileRows = (rows + TileSize - 1) / TileSize;
+	m_TileFlags.assign(size_t(m_NrOfTileColumns) * m_NrOfTileRows, 0);
+	m_IsTileUpdated.assign(m_TileFlags.size(), 0);
+	m_UpdatedTiles.clear();
+	ActivateAllTiles();
+}
+
+int Elite::InfluenceGridKernel::GetDirection(int deltaColumn, int deltaRow)
+{
+	for (int d = 0; d < NrOfDirections; ++d)
+	{
+		if (DirectionColumns[d] == deltaColumn && DirectionRows[d] == deltaRow)
+			return d;
+	}
+	return -1;
+}
+
+InfluenceGridKernel::ChannelStep Elite::InfluenceGridKernel::CalculateChannelStep(float momentum, float decay) const
+{
+	ChannelStep step{};
+	step.momentum = momentum;
+	for (int d = 0; d < NrOfDirections; ++d)
+		step.directionDecays[d] = expf(-m_DirectionCosts[d] * decay);
+	return step;
+}
+
+void Elite::InfluenceGridKernel::SetInfluence(int idx, float influence, int channel)
+{
+	m_Current[channel * m_PlaneSize + ToPadded(idx)] = influence;
+
+	const int tileColumn = idx % m_Columns / TileSize;
+	const int tileRow = idx / m_Columns / TileSize;
+	const int tile = tileRow * m_NrOfTileColumns + tileColumn;
+	m_TileFlags[tile] &= ~TileSynced;
+	ActivateTileAndNeighbors(tileColumn, tileRow);
+	MarkTileUpdated(tile);
+}
+
+void Elite::InfluenceGridKernel::Propagate(const std::vector<ChannelStep>& channelSteps)
+{
+	PropagateTileRows(0, m_NrOfTileRows, channelSteps);
+	SwapBuffers();
+}
+
+void Elite::InfluenceGridKernel::PropagateTileRows(int firstTileRow, int endTileRow, const std::vector<ChannelStep>& channelSteps)
+{
+	for (int tile = firstTileRow * m_NrOfTileColumns; tile < endTileRow * m_NrOfTileColumns; ++tile)
+	{
+		const uint8_t flags = m_TileFlags[tile];
+		if (flags & TileActive)
+		{
+			PropagateTile(tile, channelSteps);
+		}
+		else if ((flags & TileSynced) == 0)
+		{
+			//First step the tile is skipped, next still holds the values of two steps ago
+			CopyTileToNext(tile);
+			m_TileFlags[tile] |= TileSynced;
+		}
+	}
+}
+
+void Elite::InfluenceGridKernel::SwapBuffers()
+{
+	m_Current.swap(m_Next);
+
+	//1. Tiles that were propagated need their cells synced elsewhere
+	for (int tile = 0; tile < int(m_TileFlags.size()); ++tile)
+	{
+		if (m_TileFlags[tile] & TileActive)
+			MarkTileUpdated(tile);
+		m_TileFlags[tile] &= ~TileActive;
+	}
+
+	//2. Changes spread one cell per step, so a changed tile activates itself and its neighbors
+	m_NrOfActiveTiles = 0;
+	for (int tileRow = 0; tileRow < m_NrOfTileRows; ++tileRow)
+	{
+		for (int tileColumn = 0; tileColumn < m_NrOfTileColumns; ++tileColumn)
+		{
+			uint8_t& flags = m_TileFlags[tileRow * m_NrOfTileColumns + tileColumn];
+			if (flags & TileChanged)
+			{
+				flags &= ~TileChanged;
+				ActivateTileAndNeighbors(tileColumn, tileRow);
+			}
+		}
+	}
+}
+
+void Elite::InfluenceGridKernel::ActivateAllTiles()
+{
+	for (auto& flags : m_TileFlags)
+		flags = uint8_t((flags | TileActive) & ~TileSynced);
+	m_NrOfActiveTiles = int(m_TileFlags.size());
+}
+
+void Elite::InfluenceGridKernel::ClearUpdatedTiles()
+{
+	for (const int tile : m_UpdatedTiles)
+		m_IsTileUpdated[tile] = 0;
+	m_UpdatedTiles.clear();
+}
+
+void Elite::InfluenceGridKernel::GetTileCells(int tile, int& firstColumn, int& endColumn, int& firstRow, int& endRow) const
+{
+	firstColumn = tile % m_NrOfTileColumns * TileSize;
+	endColumn = min(firstColumn + TileSize, m_Columns);
+	firstRow = tile / m_NrOfTileColumns * TileSize;
+	endRow = min(firstRow + TileSize, m_Rows);
+}
+
+void Elite::InfluenceGridKernel::ActivateTileAndNeighbors(int tileColumn, int tileRow)
+{
+	for (int row = max(tileRow - 1, 0); row <= min(tileRow + 1, m_NrOfTileRows - 1); ++row)
+	{
+		for (int column = max(tileColumn - 1, 0); column <= min(tileColumn + 1, m_NrOfTileColumns - 1); ++column)
+		{
+			uint8_t& flags = m_TileFlags[row * m_NrOfTileColumns + column];
+			if ((flags & TileActive) == 0)
+			{
+				flags |= TileActive;
+				++m_NrOfActiveTiles;
+			}
+		}
+	}
+}
+
+void Elite::InfluenceGridKernel::MarkTileUpdated(int tile)
+{
+	if (m_IsTileUpdated[tile])
+		return;
+	m_IsTileUpdated[tile] = 1;
+	m_UpdatedTiles.push_back(tile);
+}
+
+void Elite::InfluenceGridKernel::PropagateTile(int tile, const std::vector<ChannelStep>& channelSteps)
+{
+	int firstColumn, endColumn, firstRow, endRow;
+	GetTileCells(tile, firstColumn, endColumn, firstRow, endRow);
+
+	float maxChange = 0.f;
+	for (int row = firstRow; row < endRow; ++row)
+	{
+		const int rowStart = (row + 1) * m_PaddedColumns + firstColumn + 1;
+		for (int channel = 0; channel < m_NrOfChannels; ++channel)
+		{
+			const size_t planeOffset = size_t(channel) * m_PlaneSize;
+			maxChange = max(maxChange,
+				PropagateRow(rowStart, endColumn - firstColumn, m_Current.data() + planeOffset, m_Next.data() + planeOffset, channelSteps[channel]));
+		}
+	}
+
+	m_TileFlags[tile] &= ~TileSynced;
+	if (maxChange > m_ActivityEpsilon)
+		m_TileFlags[tile] |= TileChanged;
+}
+
+void Elite::InfluenceGridKernel::CopyTileToNext(int tile)
+{
+	int firstColumn, endColumn, firstRow, endRow;
+	GetTileCells(tile, firstColumn, endColumn, firstRow, endRow);
+
+	for (int channel = 0; channel < m_NrOfChannels; ++channel)
+	{
+		const size_t planeOffset = size_t(channel) * m_PlaneSize;
+		for (int row = firstRow; row < endRow; ++row)
+		{
+			const size_t rowStart = planeOffset + (row + 1) * m_PaddedColumns + firstColumn + 1;
+			memcpy(m_Next.data() + rowStart, m_Current.data() + rowStart, (endColumn - firstColumn) * sizeof(float));
+		}
+	}
+}
+
+float Elite::InfluenceGridKernel::PropagateRow(int rowStart, int nrOfCells, const float* pCurrent, float* pNext, const ChannelStep& step) const
+{
+	const uint8_t* pMasks = m_DirectionMasks.data();
+	const auto& directionDecays = step.directionDecays;
+	const float momentum = step.momentum;
+	const float retain = 1.f - momentum;
+	const int rowEnd = rowStart + nrOfCells;
+	int p = rowStart;
+	float maxChange = 0.f;
+
+#if defined(ELITE_INFLUENCE_AVX2)
+	const __m256 signMask = _mm256_set1_ps(-0.f);
+	const __m256 retainV = _mm256_set1_ps(retain);
+	const __m256 momentumV = _mm256_set1_ps(momentum);
+	__m256 maxChangeV = _mm256_setzero_ps();
+	for (; p + 8 <= rowEnd; p += 8)
+	{
+		const __m256i masks = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pMasks + p)));
+		__m256 best = _mm256_setzero_ps();
+		for (int d = 0; d < NrOfDirections; ++d)
+		{
+			const __m256i bit = _mm256_set1_epi32(1 << d);
+			const __m256 isConnected = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(masks, bit), bit));
+			const __m256 neighbor = _mm256_and_ps(isConnected,
+				_mm256_mul_ps(_mm256_loadu_ps(pCurrent + p + m_DirectionOffsets[d]), _mm256_set1_ps(directionDecays[d])));
+			const __m256 isStronger = _mm256_cmp_ps(_mm256_andnot_ps(signMask, best), _mm256_andnot_ps(signMask, neighbor), _CMP_LT_OQ);
+			best = _mm256_blendv_ps(best, neighbor, isStronger);
+		}
+		const __m256 current = _mm256_loadu_ps(pCurrent + p);
+		const __m256 next = _mm256_add_ps(_mm256_mul_ps(retainV, current), _mm256_mul_ps(momentumV, best));
+		_mm256_storeu_ps(pNext + p, next);
+		maxChangeV = _mm256_max_ps(maxChangeV, _mm256_andnot_ps(signMask, _mm256_sub_ps(next, current)));
+	}
+	alignas(32) float maxChanges[8];
+	_mm256_store_ps(maxChanges, maxChangeV);
+	for (const float change : maxChanges)
+		maxChange = max(maxChange, change);
+#elif defined(ELITE_INFLUENCE_SSE2)
+	const __m128 signMask = _mm_set1_ps(-0.f);
+	const __m128 retainV = _mm_set1_ps(retain);
+	const __m128 momentumV = _mm_set1_ps(momentum);
+	const __m128i zero = _mm_setzero_si128();
+	__m128 maxChangeV = _mm_setzero_ps();
+	for (; p + 4 <= rowEnd; p += 4)
+	{
+		int packedMasks = 0;
+		memcpy(&packedMasks, pMasks + p, sizeof(int));
+		const __m128i masks = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packedMasks), zero), zero);
+		__m128 best = _mm_setzero_ps();
+		for (int d = 0; d < NrOfDirections; ++d)
+		{
+			const __m128i bit = _mm_set1_epi32(1 << d);
+			const __m128 isConnected = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(masks, bit), bit));
+			const __m128 neighbor = _mm_and_ps(isConnected,
+				_mm_mul_ps(_mm_loadu_ps(pCurrent + p + m_DirectionOffsets[d]), _mm_set1_ps(directionDecays[d])));
+			const __m128 isStronger = _mm_cmplt_ps(_mm_andnot_ps(signMask, best), _mm_andnot_ps(signMask, neighbor));
+			best = _mm_or_ps(_mm_and_ps(isStronger, neighbor), _mm_andnot_ps(isStronger, best));
+		}
+		const __m128 current = _mm_loadu_ps(pCurrent + p);
+		const __m128 next = _mm_add_ps(_mm_mul_ps(retainV, current), _mm_mul_ps(momentumV, best));
+		_mm_storeu_ps(pNext + p, next);
+		maxChangeV = _mm_max_ps(maxChangeV, _mm_andnot_ps(signMask, _mm_sub_ps(next, current)));
+	}
+	alignas(16) float maxChanges[4];
+	_mm_store_ps(maxChanges, maxChangeV);
+	for (const float change : maxChanges)
+		maxChange = max(maxChange, change);
+#endif
+	//Scalar tail (or everything when no SIMD is available)
+	for (; p < rowEnd; ++p)
+	{
+		const uint8_t mask = pMasks[p];
+		float best = 0.f;
+		for (int d = 0; d < NrOfDirections; ++d)
+		{
+			if ((mask & (1 << d)) == 0)
+				continue;
+			const float neighbor = pCurrent[p + m_DirectionOffsets[d]] * directionDecays[d];
+			if (fabs(best) < fabs(neighbor))
+				best = neighbor;
+		}
+		pNext[p] = retain * pCurrent[p] + momentum * best;
+		maxChange = max(maxChange, fabsf(pNext[p] - pCurrent[p]));
+	}
+	return maxChange;
+}
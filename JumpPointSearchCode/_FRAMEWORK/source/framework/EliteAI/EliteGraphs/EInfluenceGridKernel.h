@@ -0,0 +1,109 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace Elite
+{
+	//Dense propagation kernel for influence maps on grid graphs.
+	//Influence lives in two flat float arrays (current/next) with a one cell border of zeros, so every cell can read its
+	//8 neighbors without bounds checks. Which neighbors a cell is connected to is stored as a bitmask per cell and the
+	//decay is precomputed per direction, so a step is a branchless max-abs/lerp stencil (AVX2 or SSE2 when available).
+	//Several channels (e.g. threat, food) share the masks, each channel is a separate padded plane (SoA) and a row is
+	//propagated for every channel before moving on, so the masks are only loaded once per step.
+	//The grid is split in tiles and only active tiles are propagated: a tile stays active while any of its cells changed
+	//more than the activity epsilon in the last step (or one of its neighbor tiles did, or influence was set in it),
+	//so a converged map costs next to nothing.
+	class InfluenceGridKernel final
+	{
+	public:
+		static constexpr int NrOfDirections = 8;
+		static constexpr int TileSize = 32; //Cells per tile side
+
+		//Per channel parameters of one step
+		struct ChannelStep
+		{
+			float momentum = 0.f;
+			std::array<float, NrOfDirections> directionDecays{};
+		};
+
+		InfluenceGridKernel() = default;
+
+		void Initialize(int columns, int rows, int nrOfChannels = 1);
+		int GetColumns() const { return m_Columns; }
+		int GetRows() const { return m_Rows; }
+		int GetNrOfCells() const { return m_Columns * m_Rows; }
+		int GetNrOfChannels() const { return m_NrOfChannels; }
+
+		//Direction index for a neighbor offset (same order as GridGraph: straight then diagonal), -1 if not a neighbor
+		static int GetDirection(int deltaColumn, int deltaRow);
+
+		void SetDirectionMask(int idx, uint8_t mask) { m_DirectionMasks[ToPadded(idx)] = mask; }
+		void SetDirectionCosts(const std::array<float, NrOfDirections>& costs) { m_DirectionCosts = costs; }
+
+		float GetInfluence(int idx, int channel = 0) const { return m_Current[channel * m_PlaneSize + ToPadded(idx)]; }
+		void SetInfluence(int idx, float influence, int channel = 0);
+		//First cell of a channel in the current buffer, rows are GetRowStride() apart
+		const float* GetChannelData(int channel) const { return m_Current.data() + channel * m_PlaneSize + m_PaddedColumns + 1; }
+		int GetRowStride() const { return m_PaddedColumns; }
+
+		//Full step: propagates the active tiles of every channel (one ChannelStep per channel) and swaps the buffers
+		void Propagate(const std::vector<ChannelStep>& channelSteps);
+
+		//Building blocks of a step, tile rows [firstTileRow, endTileRow) only read the current and only write the next buffer
+		ChannelStep CalculateChannelStep(float momentum, float decay) const;
+		void PropagateTileRows(int firstTileRow, int endTileRow, const std::vector<ChannelStep>& channelSteps);
+		//Swaps the buffers and activates the tiles (and their neighbors) that changed
+		void SwapBuffers();
+
+		//Activity (the workers read the epsilon, so only change it while no tile rows are being propagated)
+		float GetActivityEpsilon() const { return m_ActivityEpsilon; }
+		void SetActivityEpsilon(float epsilon) { m_ActivityEpsilon = epsilon; }
+		void ActivateAllTiles(); //E.g. when the momentum or decay changed, the converged values are no longer valid
+		bool IsIdle() const { return m_NrOfActiveTiles == 0; }
+		int GetNrOfActiveTiles() const { return m_NrOfActiveTiles; }
+		int GetNrOfTileRows() const { return m_NrOfTileRows; }
+
+		//Tiles whose influence changed since the last ClearUpdatedTiles (to only sync those cells elsewhere)
+		//Only touched by the thread that swaps the buffers, so it can be read and cleared while tile rows are being propagated
+		const std::vector<int>& GetUpdatedTiles() const { return m_UpdatedTiles; }
+		void ClearUpdatedTiles();
+		void GetTileCells(int tile, int& firstColumn, int& endColumn, int& firstRow, int& endRow) const;
+
+	private:
+		int m_Columns = 0;
+		int m_Rows = 0;
+		int m_PaddedColumns = 0;
+		int m_PlaneSize = 0; //Padded size of one channel
+		int m_NrOfChannels = 0;
+
+		std::vector<float> m_Current;
+		std::vector<float> m_Next;
+		std::vector<uint8_t> m_DirectionMasks;
+		std::array<float, NrOfDirections> m_DirectionCosts{};
+		std::array<int, NrOfDirections> m_DirectionOffsets{};
+
+		//Per tile state
+		enum TileFlags : uint8_t
+		{
+			TileActive = 1 << 0, //Propagated this step
+			TileChanged = 1 << 1, //A cell changed more than the epsilon this step, only written by the thread that owns the tile
+			TileSynced = 1 << 2 //Current and next hold the same values, so skipping the tile keeps it correct after a swap
+		};
+		int m_NrOfTileColumns = 0;
+		int m_NrOfTileRows = 0;
+		int m_NrOfActiveTiles = 0;
+		float m_ActivityEpsilon = 1e-3f;
+		std::vector<uint8_t> m_TileFlags;
+		std::vector<uint8_t> m_IsTileUpdated; //Per tile, in m_UpdatedTiles (kept out of m_TileFlags, the workers write those)
+		std::vector<int> m_UpdatedTiles;
+
+		int ToPadded(int idx) const { return (idx / m_Columns + 1) * m_PaddedColumns + idx % m_Columns + 1; }
+		void ActivateTileAndNeighbors(int tileColumn, int tileRow);
+		void MarkTileUpdated(int tile);
+		void PropagateTile(int tile, const std::vector<ChannelStep>& channelSteps);
+		void CopyTileToNext(int tile);
+		//Returns the largest change of the row
+		float PropagateRow(int rowStart, int nrOfCells, const float* pCurrent, float* pNext, const ChannelStep& step) const;
+	};
+}
@@ -2,130 +2,802 @@
 #include "EIGraph.h"
 #include "EGraphNodeTypes.h"
 #include "EGraphConnectionTypes.h"
+#include "EGridGraph.h"
+#include "EInfluenceGridKernel.h"
+#include "ENodeCostField.h"
+#include "framework\EliteHelpers\EWorkerPool.h"
 
 namespace Elite
 {
+	//Grid graphs get the dense SIMD propagation kernel, every other graph type uses the generic node/connection walk
+	template<class T_GraphType>
+	struct IsGridGraph : std::false_type {};
+	template<class T_NodeType, class T_ConnectionType>
+	struct IsGridGraph<GridGraph<T_NodeType, T_ConnectionType>> : std::true_type {};
+
+	//One term of a weighted query, e.g. { threatChannel, -1.f }, { foodChannel, .5f }
+	struct InfluenceWeight
+	{
+		int channel;
+		float weight;
+	};
+
+	struct InfluenceRegionResult
+	{
+		float total = 0.f;
+		int nrOfNodes = 0;
+		float highest = -FLT_MAX;
+		int highestIdx = invalid_node_index;
+		float lowest = FLT_MAX;
+		int lowestIdx = invalid_node_index;
+
+		float GetAverage() const { return nrOfNodes > 0 ? total / nrOfNodes : 0.f; }
+	};
+
 	template<class T_GraphType>
 	class InfluenceMap final : public T_GraphType
 	{
 	public:
 		InfluenceMap(bool isDirectional): T_GraphType(isDirectional) {}
-		void InitializeBuffer() { m_InfluenceDoubleBuffer = vector<float>(m_Nodes.size()); }
+		~InfluenceMap() { FinishPropagation(); }
+		void InitializeBuffer() { m_IsTopologyDirty = true; }
 		void PropagateInfluence(float deltaTime);
 
-		void SetInfluenceAtPosition(Elite::Vector2 pos, float influence);
+		//Channels share the graph and are propagated in the same pass, each with its own momentum and decay
+		//Channel 0 always exists, returns the index of the new channel
+		int AddChannel(float momentum, float decay);
+		int GetNrOfChannels() const { return int(m_Channels.size()); }
+
+		void SetInfluenceAtPosition(Elite::Vector2 pos, float influence, int channel = 0);
+		float GetInfluence(int idx, int channel = 0);
+		float GetInfluenceAtPosition(const Elite::Vector2& pos, int channel = 0);
+
+		//Weighted combination of channels, evaluated in place
+		float EvaluateInfluence(int idx, const vector<InfluenceWeight>& weights);
+		float EvaluateInfluenceAtPosition(const Elite::Vector2& pos, const vector<InfluenceWeight>& weights);
+		//Over every node within [min, max] (world positions)
+		InfluenceRegionResult EvaluateInfluenceInRegion(const Elite::Vector2& min, const Elite::Vector2& max, const vector<InfluenceWeight>& weights);
+
+		//Zero-copy view of a channel as an extra node cost for AStar (the pathfinding graph must be indexed like this map)
+		//Only valid until the next propagation step or topology change
+		NodeCostField GetCostField(int channel = 0, float weight = 1.f);
+
+		//The nodes only mirror one channel (used for rendering), copies what changed back into the nodes
+		//(done automatically by SetNodeColorsBasedOnInfluence, only needed when reading GetNode(idx)->GetInfluence() directly)
+		void SyncNodeInfluences();
+		int GetDisplayChannel() const { return m_DisplayChannel; }
+		void SetDisplayChannel(int channel) { m_DisplayChannel = channel; m_AreAllNodesOutOfDate = true; }
 
 		void Render() const {}
+		//Only recolors the nodes whose influence changed
 		void SetNodeColorsBasedOnInfluence();
 
-		float GetMomentum() const { return m_Momentum; }
-		void SetMomentum(float momentum) { m_Momentum = momentum; }
+		float GetMomentum(int channel = 0) const { return m_Channels[channel].momentum; }
+		void SetMomentum(float momentum, int channel = 0);
 
-		float GetDecay() const { return m_Decay; }
-		void SetDecay(float decay) { m_Decay = decay; }
+		float GetDecay(int channel = 0) const { return m_Channels[channel].decay; }
+		void SetDecay(float decay, int channel = 0);
+
+		//Only nodes near influence that was set or changed more than this in the last step are propagated
+		//A converged map is not propagated at all (directional graphs always propagate every node)
+		float GetConvergenceEpsilon() const { return m_ConvergenceEpsilon; }
+		//Completes a running step first, the workers read the epsilon
+		void SetConvergenceEpsilon(float epsilon) { FinishPropagation(); m_ConvergenceEpsilon = epsilon; m_GridKernel.SetActivityEpsilon(epsilon); }
+		bool IsConverged() const;
 
 		float GetPropagationInterval() const { return m_PropagationInterval; }
 		void SetPropagationInterval(float propagationInterval) { m_PropagationInterval = propagationInterval; }
 
+		//Pool the propagation is split over in row bands (must outlive the map), nullptr runs on the calling thread
+		//Maps can share a pool, it runs one job at a time so their steps run one after the other
+		WorkerPool* GetWorkerPool() const { return m_pWorkerPool; }
+		void SetWorkerPool(WorkerPool* pWorkerPool) { FinishPropagation(); m_pWorkerPool = pWorkerPool; }
+
+		//Async: a grid step keeps running on the workers across frames, the buffers are only swapped once it completed
+		//Influence set while a step is running is applied after the swap
+		bool IsAsyncPropagation() const { return m_IsAsyncPropagation; }
+		void SetAsyncPropagation(bool isAsync) { m_IsAsyncPropagation = isAsync; }
+		//Blocks until a running step completed and swaps the buffers
+		void FinishPropagation();
+
 	protected:
 		virtual void OnGraphModified(bool nrOfNodesChanged, bool nrOfConnectionsChanged) override;
 
 	private:
+		struct ChannelSettings
+		{
+			float momentum; // a higher momentum means a higher tendency to retain the current influence
+			float decay; // determines the decay in influence over distance
+		};
+
+		struct PendingInfluence
+		{
+			int idx;
+			int channel;
+			float influence;
+		};
+
+		enum NodeFlags : uint8_t
+		{
+			NodeActive = 1 << 0, //In m_ActiveNodes, propagated next step
+			NodeChanged = 1 << 1, //Changed more than the epsilon this step, only written by the thread that owns the node
+			NodeOutOfDate = 1 << 2, //In m_OutOfDateNodes, node does not mirror the display channel
+			NodeColorOutOfDate = 1 << 3 //In m_NodesToRecolor
+		};
+
 		Elite::Color m_NegativeColor{ 1.f, 0.2f, 0.f};
 		Elite::Color m_NeutralColor{ 0.f, 0.f, 0.f };
 		Elite::Color m_PositiveColor{ 0.f, 0.2f, 1.f};
 
 		float m_MaxAbsInfluence = 100.f;
 
-		float m_Momentum = 0.8f; // a higher momentum means a higher tendency to retain the current influence
-		float m_Decay = 0.1f; // determines the decay in influence over distance
+		vector<ChannelSettings> m_Channels{ { 0.8f, 0.1f } };
+		int m_DisplayChannel = 0;
 
 		float m_PropagationInterval = .05f; //in Seconds
 		float m_TimeSinceLastPropagation = 0.0f;
 
+		//Influence of the generic path, one plane of m_NrOfStoredNodes per channel (SoA)
+		//Grid graphs keep it in the kernel instead, then this is only used to carry it over a topology change
+		vector<float> m_Influences;
 		vector<float> m_InfluenceDoubleBuffer;
+		int m_NrOfStoredNodes = 0;
+		int m_NrOfStoredChannels = 0;
+
+		InfluenceGridKernel m_GridKernel;
+		bool m_IsTopologyDirty = true; //Nodes, connections or channels changed, storage and kernel need to be rebuilt
+		bool m_IsGridKernelUsable = false; //False when the connection costs differ per cell (e.g. terrain), then the generic path is used
+		bool m_AreAllNodesOutOfDate = true; //Every node needs to be synced and recolored (topology or display channel changed)
+
+		//Activity
+		float m_ConvergenceEpsilon = 1e-3f;
+		vector<uint8_t> m_NodeFlags; //NodeFlags per node
+		vector<int> m_ActiveNodes; //Generic path only, the grid kernel tracks activity per tile
+		vector<int> m_PropagatedNodes;
+		vector<int> m_OutOfDateNodes; //Generic path only, the grid kernel tracks updated tiles
+		vector<int> m_NodesToRecolor;
+
+		WorkerPool* m_pWorkerPool = nullptr;
+		bool m_IsAsyncPropagation = false;
+		bool m_IsStepInFlight = false; //Workers are reading the current and writing the next kernel buffer
+		WorkerPool::JobId m_StepJob = 0; //The job of the step in flight, only this one is waited for when the pool is shared
+		vector<PendingInfluence> m_PendingInfluences; //Set while a step was in flight
+
+		void UpdateTopology();
+		void ResizeInfluences(int nrOfNodes, int nrOfChannels);
+		void RebuildGridKernel(std::true_type);
+		void RebuildGridKernel(std::false_type) { m_IsGridKernelUsable = false; }
+		void PropagateGeneric();
+		void StartGridStep();
+		void CompleteGridStep();
+		void ActivateAll();
+		void ActivateNodeAndNeighbors(int idx);
+		void MarkNodeOutOfDate(int idx);
+		void SyncNodeInfluence(int idx);
+		void UpdateNodeColor(int idx);
+
+		float ReadInfluence(int idx, int channel) const;
+		float ReadWeightedInfluence(int idx, const vector<InfluenceWeight>& weights) const;
+		void EvaluateRegion(const Elite::Vector2& min, const Elite::Vector2& max, const vector<InfluenceWeight>& weights, InfluenceRegionResult& result, std::true_type) const;
+		void EvaluateRegion(const Elite::Vector2& min, const Elite::Vector2& max, const vector<InfluenceWeight>& weights, InfluenceRegionResult& result, std::false_type) const;
 	};
 
 	template <class T_GraphType>
 	void InfluenceMap<T_GraphType>::PropagateInfluence(float deltaTime)
 	{
-		// TODO: implement
 		m_TimeSinceLastPropagation += deltaTime;
 
+		// A step that is still running in the background keeps the current influence until it completes
+		if (m_IsStepInFlight)
+		{
+			if (!m_pWorkerPool->IsDone(m_StepJob))
+				return;
+			CompleteGridStep();
+		}
+
 		// Check if function executes once every interval
 		if (m_TimeSinceLastPropagation >= m_PropagationInterval)
 		{
-			// Go over all nodes
-			for (auto node : m_Nodes)
+			UpdateTopology();
+			if (IsConverged())
+			{
+				// Nothing left to propagate
+			}
+			else if (m_IsGridKernelUsable)
 			{
+				const bool isAsync = m_IsAsyncPropagation && m_pWorkerPool != nullptr;
+				StartGridStep();
+				if (!isAsync)
+					FinishPropagation();
+			}
+			else
+			{
+				PropagateGeneric();
+			}
+
+			m_TimeSinceLastPropagation -= m_PropagationInterval;
+		}
+	}
+
+	template <class T_GraphType>
+	inline bool InfluenceMap<T_GraphType>::IsConverged() const
+	{
+		if (m_IsTopologyDirty)
+			return false;
+		return m_IsGridKernelUsable ? m_GridKernel.IsIdle() : m_ActiveNodes.empty();
+	}
+
+	template <class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::SetMomentum(float momentum, int channel)
+	{
+		if (m_Channels[channel].momentum == momentum)
+			return;
+		m_Channels[channel].momentum = momentum;
+		ActivateAll(); //Converged values are no longer valid
+	}
+
+	template <class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::SetDecay(float decay, int channel)
+	{
+		if (m_Channels[channel].decay == decay)
+			return;
+		m_Channels[channel].decay = decay;
+		ActivateAll();
+	}
+
+	template <class T_GraphType>
+	void InfluenceMap<T_GraphType>::ActivateAll()
+	{
+		if (m_IsStepInFlight)
+			FinishPropagation();
+
+		m_GridKernel.ActivateAllTiles();
+		if (m_IsGridKernelUsable)
+			return;
+
+		for (int idx = 0; idx < m_NrOfStoredNodes; ++idx)
+		{
+			if ((m_NodeFlags[idx] & NodeActive) == 0)
+			{
+				m_NodeFlags[idx] |= NodeActive;
+				m_ActiveNodes.push_back(idx);
+			}
+		}
+	}
 
-				// Check influence of each neighbor and remember highest
-				float neighborInfluence{0.f};
-				for (auto connection : GetNodeConnections(node))
+	template <class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::ActivateNodeAndNeighbors(int idx)
+	{
+		if ((m_NodeFlags[idx] & NodeActive) == 0)
+		{
+			m_NodeFlags[idx] |= NodeActive;
+			m_ActiveNodes.push_back(idx);
+		}
+
+		//Undirected, so the neighbors are exactly the nodes that read from this one
+		for (auto pConnection : m_Connections[idx])
+		{
+			const int to = pConnection->GetTo();
+			if ((m_NodeFlags[to] & NodeActive) == 0)
+			{
+				m_NodeFlags[to] |= NodeActive;
+				m_ActiveNodes.push_back(to);
+			}
+		}
+	}
+
+	template <class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::MarkNodeOutOfDate(int idx)
+	{
+		if (m_NodeFlags[idx] & NodeOutOfDate)
+			return;
+		m_NodeFlags[idx] |= NodeOutOfDate;
+		m_OutOfDateNodes.push_back(idx);
+	}
+
+	template <class T_GraphType>
+	inline int InfluenceMap<T_GraphType>::AddChannel(float momentum, float decay)
+	{
+		m_Channels.push_back({ momentum, decay });
+		m_IsTopologyDirty = true;
+		return int(m_Channels.size()) - 1;
+	}
+
+	template <class T_GraphType>
+	void InfluenceMap<T_GraphType>::StartGridStep()
+	{
+		vector<InfluenceGridKernel::ChannelStep> channelSteps;
+		channelSteps.reserve(m_Channels.size());
+		for (const auto& channel : m_Channels)
+			channelSteps.push_back(m_GridKernel.CalculateChannelStep(channel.momentum, channel.decay));
+		m_IsStepInFlight = true;
+
+		if (m_pWorkerPool == nullptr)
+		{
+			m_GridKernel.PropagateTileRows(0, m_GridKernel.GetNrOfTileRows(), channelSteps);
+			return;
+		}
+
+		// Tile rows only read the current and only write the next buffer, so they need no synchronization
+		// A synchronous step is completed right after by FinishPropagation
+		const auto propagateTileRows = [this, channelSteps](int firstTileRow, int endTileRow)
+		{
+			m_GridKernel.PropagateTileRows(firstTileRow, endTileRow, channelSteps);
+		};
+		m_StepJob = m_pWorkerPool->Dispatch(m_GridKernel.GetNrOfTileRows(), propagateTileRows);
+	}
+
+	template <class T_GraphType>
+	void InfluenceMap<T_GraphType>::CompleteGridStep()
+	{
+		m_GridKernel.SwapBuffers();
+		m_IsStepInFlight = false;
+
+		for (const auto& pending : m_PendingInfluences)
+			m_GridKernel.SetInfluence(pending.idx, pending.influence, pending.channel);
+		m_PendingInfluences.clear();
+	}
+
+	template <class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::FinishPropagation()
+	{
+		if (!m_IsStepInFlight)
+			return;
+
+		if (m_pWorkerPool)
+			m_pWorkerPool->Wait(m_StepJob);
+		CompleteGridStep();
+	}
+
+	template <class T_GraphType>
+	void InfluenceMap<T_GraphType>::PropagateGeneric()
+	{
+		const int nrOfNodes = m_NrOfStoredNodes;
+		const int nrOfChannels = m_NrOfStoredChannels;
+		const float epsilon = m_ConvergenceEpsilon;
+
+		// Directional graphs would need the incoming connections to know who reads a changed node
+		if (m_IsDirectionalGraph)
+			ActivateAll();
+
+		m_PropagatedNodes.swap(m_ActiveNodes);
+		m_ActiveNodes.clear();
+
+		const auto propagateNodes = [this, nrOfNodes, nrOfChannels, epsilon](int first, int end)
+		{
+			for (int k = first; k < end; k++)
+			{
+				const int i = m_PropagatedNodes[k];
+				auto node = m_Nodes[i];
+				float maxChange = 0.f;
+				for (int channel = 0; channel < nrOfChannels; channel++)
 				{
-					float tempInfluence = GetNode(connection->GetTo())->GetInfluence() * expf(-connection->GetCost() * m_Decay);
-					if (fabs(neighborInfluence) < fabs(tempInfluence))
-						neighborInfluence = tempInfluence;
+					const float* pInfluences = m_Influences.data() + channel * nrOfNodes;
+					if (node->GetIndex() == invalid_node_index)
+					{
+						m_InfluenceDoubleBuffer[channel * nrOfNodes + i] = pInfluences[i];
+						continue;
+					}
+
+					// Check influence of each neighbor and remember highest
+					const float decay = m_Channels[channel].decay;
+					float neighborInfluence{0.f};
+					for (auto connection : GetNodeConnections(node))
+					{
+						float tempInfluence = pInfluences[connection->GetTo()] * expf(-connection->GetCost() * decay);
+						if (fabs(neighborInfluence) < fabs(tempInfluence))
+							neighborInfluence = tempInfluence;
+					}
+
+					// Calculate new influence
+					const float newInfluence = Lerp(pInfluences[i], neighborInfluence, m_Channels[channel].momentum);
+					m_InfluenceDoubleBuffer[channel * nrOfNodes + i] = newInfluence;
+					maxChange = max(maxChange, fabsf(newInfluence - pInfluences[i]));
 				}
 
-				// Calculate new influence
-				float newInfluence = Lerp(node->GetInfluence(), neighborInfluence, m_Momentum);
-				//std::cout << node->GetIndex() << " " << neighborInfluence << " " << newInfluence << std::endl << std::endl;
-				m_InfluenceDoubleBuffer.push_back(newInfluence);
+				m_NodeFlags[i] &= ~NodeActive;
+				if (maxChange > epsilon)
+					m_NodeFlags[i] |= NodeChanged;
 			}
+		};
 
-			//Copy from buffer to map
-			for (size_t i = 0; i < m_Nodes.size(); i++)
-				m_Nodes[i]->SetInfluence(m_InfluenceDoubleBuffer[i]);
-			m_InfluenceDoubleBuffer.clear();
+		// Go over the active nodes
+		if (m_pWorkerPool)
+			m_pWorkerPool->ParallelFor(int(m_PropagatedNodes.size()), propagateNodes);
+		else
+			propagateNodes(0, int(m_PropagatedNodes.size()));
 
-			m_TimeSinceLastPropagation -= m_PropagationInterval;
+		m_Influences.swap(m_InfluenceDoubleBuffer);
+
+		// Changed nodes activate themselves and their neighbors for the next step
+		for (const int idx : m_PropagatedNodes)
+		{
+			MarkNodeOutOfDate(idx);
+			if (m_NodeFlags[idx] & NodeChanged)
+			{
+				m_NodeFlags[idx] &= ~NodeChanged;
+				ActivateNodeAndNeighbors(idx);
+			}
+		}
+
+		// Skipped nodes must hold the same value in both buffers, so propagated nodes that go quiet are copied once
+		for (const int idx : m_PropagatedNodes)
+		{
+			if (m_NodeFlags[idx] & NodeActive)
+				continue;
+			for (int channel = 0; channel < nrOfChannels; channel++)
+				m_InfluenceDoubleBuffer[channel * nrOfNodes + idx] = m_Influences[channel * nrOfNodes + idx];
 		}
 	}
 
 	template <class T_GraphType>
-	inline void InfluenceMap<T_GraphType>::SetInfluenceAtPosition(Elite::Vector2 pos, float influence)
+	inline void InfluenceMap<T_GraphType>::UpdateTopology()
 	{
-		auto idx = GetNodeIdxAtWorldPos(pos);
-		if (IsNodeValid(idx))
-			GetNode(idx)->SetInfluence(influence);
+		if (!m_IsTopologyDirty)
+			return;
+
+		FinishPropagation();
+
+		//1. Take the influence out of the kernel, it is rebuilt for the new topology
+		if (m_IsGridKernelUsable)
+		{
+			for (int channel = 0; channel < m_NrOfStoredChannels; channel++)
+			{
+				for (int idx = 0; idx < m_NrOfStoredNodes; idx++)
+					m_Influences[channel * m_NrOfStoredNodes + idx] = m_GridKernel.GetInfluence(idx, channel);
+			}
+		}
+
+		//2. Resize while keeping every node's influence
+		ResizeInfluences(int(m_Nodes.size()), int(m_Channels.size()));
+
+		//3. Back into the kernel (if the grid can use it)
+		RebuildGridKernel(IsGridGraph<T_GraphType>());
+		m_GridKernel.SetActivityEpsilon(m_ConvergenceEpsilon);
+		m_IsTopologyDirty = false;
+
+		//4. Everything has to settle again
+		m_NodeFlags.assign(m_NrOfStoredNodes, 0);
+		m_ActiveNodes.clear();
+		m_OutOfDateNodes.clear();
+		m_NodesToRecolor.clear();
+		ActivateAll();
+		m_AreAllNodesOutOfDate = true;
 	}
 
-	template<class T_GraphType>
-	inline void InfluenceMap<T_GraphType>::SetNodeColorsBasedOnInfluence()
+	template <class T_GraphType>
+	void InfluenceMap<T_GraphType>::ResizeInfluences(int nrOfNodes, int nrOfChannels)
+	{
+		if (nrOfNodes != m_NrOfStoredNodes || nrOfChannels != m_NrOfStoredChannels)
+		{
+			vector<float> influences(size_t(nrOfNodes) * nrOfChannels, 0.f);
+			const int nrOfKeptNodes = min(nrOfNodes, m_NrOfStoredNodes);
+			for (int channel = 0; channel < min(nrOfChannels, m_NrOfStoredChannels); channel++)
+			{
+				const auto first = m_Influences.begin() + channel * m_NrOfStoredNodes;
+				std::copy(first, first + nrOfKeptNodes, influences.begin() + channel * nrOfNodes);
+			}
+			m_Influences.swap(influences);
+			m_NrOfStoredNodes = nrOfNodes;
+			m_NrOfStoredChannels = nrOfChannels;
+		}
+		m_InfluenceDoubleBuffer = m_Influences;
+	}
+
+	template <class T_GraphType>
+	void InfluenceMap<T_GraphType>::RebuildGridKernel(std::true_type)
 	{
-		const float half = .5f;
+		const int columns = GetColumns();
+		const int rows = GetRows();
+		m_IsGridKernelUsable = false;
+		if (columns * rows == 0 || columns * rows != int(m_Nodes.size()))
+			return;
 
-		for (auto& pNode : m_Nodes)
+		m_GridKernel.Initialize(columns, rows, int(m_Channels.size()));
+
+		//1. Direction masks from the actual connections, the kernel needs one cost per direction
+		std::array<float, InfluenceGridKernel::NrOfDirections> directionCosts{};
+		std::array<bool, InfluenceGridKernel::NrOfDirections> hasDirectionCost{};
+		for (int idx = 0; idx < columns * rows; ++idx)
 		{
-			Color nodeColor{};
-			float influence = pNode->GetInfluence();
-			float relativeInfluence = abs(influence) / m_MaxAbsInfluence;
+			uint8_t mask = 0;
+			for (auto pConnection : m_Connections[idx])
+			{
+				const int to = pConnection->GetTo();
+				const int direction = InfluenceGridKernel::GetDirection(to % columns - idx % columns, to / columns - idx / columns);
+				if (direction == -1)
+					return; //Not a neighbor connection, can't be expressed as a stencil
 
-			if (influence < 0)
+				if (!hasDirectionCost[direction])
+				{
+					directionCosts[direction] = pConnection->GetCost();
+					hasDirectionCost[direction] = true;
+				}
+				else if (fabs(directionCosts[direction] - pConnection->GetCost()) > 1e-5f)
+				{
+					return; //Non-uniform costs (e.g. terrain), fall back to the generic propagation
+				}
+				mask |= uint8_t(1 << direction);
+			}
+			m_GridKernel.SetDirectionMask(idx, mask);
+		}
+		m_GridKernel.SetDirectionCosts(directionCosts);
+
+		//2. Current influence
+		for (int channel = 0; channel < m_NrOfStoredChannels; ++channel)
+		{
+			for (int idx = 0; idx < columns * rows; ++idx)
+				m_GridKernel.SetInfluence(idx, m_Influences[channel * m_NrOfStoredNodes + idx], channel);
+		}
+
+		m_IsGridKernelUsable = true;
+	}
+
+	template <class T_GraphType>
+	inline float InfluenceMap<T_GraphType>::ReadInfluence(int idx, int channel) const
+	{
+		if (m_IsGridKernelUsable)
+			return m_GridKernel.GetInfluence(idx, channel);
+		return m_Influences[channel * m_NrOfStoredNodes + idx];
+	}
+
+	template <class T_GraphType>
+	inline float InfluenceMap<T_GraphType>::ReadWeightedInfluence(int idx, const vector<InfluenceWeight>& weights) const
+	{
+		float influence = 0.f;
+		for (const auto& weight : weights)
+			influence += ReadInfluence(idx, weight.channel) * weight.weight;
+		return influence;
+	}
+
+	template <class T_GraphType>
+	void InfluenceMap<T_GraphType>::SyncNodeInfluences()
+	{
+		if (m_NrOfStoredNodes != int(m_Nodes.size()) || m_DisplayChannel >= m_NrOfStoredChannels)
+			return;
+
+		if (m_AreAllNodesOutOfDate)
+		{
+			for (int i = 0; i < m_NrOfStoredNodes; i++)
+				m_Nodes[i]->SetInfluence(ReadInfluence(i, m_DisplayChannel));
+		}
+		else if (m_IsGridKernelUsable)
+		{
+			for (const int tile : m_GridKernel.GetUpdatedTiles())
 			{
-				nodeColor = Elite::Color{
-				Lerp(m_NeutralColor.r, m_NegativeColor.r, relativeInfluence),
-				Lerp(m_NeutralColor.g, m_NegativeColor.g, relativeInfluence),
-				Lerp(m_NeutralColor.b, m_NegativeColor.b, relativeInfluence)
-				};
+				int firstColumn, endColumn, firstRow, endRow;
+				m_GridKernel.GetTileCells(tile, firstColumn, endColumn, firstRow, endRow);
+				for (int row = firstRow; row < endRow; ++row)
+				{
+					for (int col = firstColumn; col < endColumn; ++col)
+						SyncNodeInfluence(row * m_GridKernel.GetColumns() + col);
+				}
 			}
-			else
+		}
+		else
+		{
+			for (const int idx : m_OutOfDateNodes)
+				SyncNodeInfluence(idx);
+		}
+
+		m_GridKernel.ClearUpdatedTiles();
+		for (const int idx : m_OutOfDateNodes)
+			m_NodeFlags[idx] &= ~NodeOutOfDate;
+		m_OutOfDateNodes.clear();
+		m_AreAllNodesOutOfDate = false;
+	}
+
+	template <class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::SyncNodeInfluence(int idx)
+	{
+		const float influence = ReadInfluence(idx, m_DisplayChannel);
+		if (m_Nodes[idx]->GetInfluence() == influence)
+			return;
+
+		m_Nodes[idx]->SetInfluence(influence);
+		if ((m_NodeFlags[idx] & NodeColorOutOfDate) == 0)
+		{
+			m_NodeFlags[idx] |= NodeColorOutOfDate;
+			m_NodesToRecolor.push_back(idx);
+		}
+	}
+
+	template <class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::SetInfluenceAtPosition(Elite::Vector2 pos, float influence, int channel)
+	{
+		auto idx = GetNodeIdxAtWorldPos(pos);
+		if (!IsNodeValid(idx))
+			return;
+
+		UpdateTopology();
+		if (!m_IsGridKernelUsable)
+		{
+			m_Influences[channel * m_NrOfStoredNodes + idx] = influence;
+			ActivateNodeAndNeighbors(idx);
+			MarkNodeOutOfDate(idx);
+		}
+		else if (m_IsStepInFlight)
+			m_PendingInfluences.push_back({ idx, channel, influence });
+		else
+			m_GridKernel.SetInfluence(idx, influence, channel);
+	}
+
+	template <class T_GraphType>
+	inline float InfluenceMap<T_GraphType>::GetInfluence(int idx, int channel)
+	{
+		if (!IsNodeValid(idx))
+			return 0.f;
+
+		UpdateTopology();
+		return ReadInfluence(idx, channel);
+	}
+
+	template <class T_GraphType>
+	inline float InfluenceMap<T_GraphType>::GetInfluenceAtPosition(const Elite::Vector2& pos, int channel)
+	{
+		return GetInfluence(GetNodeIdxAtWorldPos(pos), channel);
+	}
+
+	template <class T_GraphType>
+	inline NodeCostField InfluenceMap<T_GraphType>::GetCostField(int channel, float weight)
+	{
+		UpdateTopology();
+
+		NodeCostField costField{};
+		costField.nrOfNodes = m_NrOfStoredNodes;
+		costField.weight = weight;
+		if (m_IsGridKernelUsable)
+		{
+			costField.pData = m_GridKernel.GetChannelData(channel);
+			costField.columns = m_GridKernel.GetColumns();
+			costField.rowStride = m_GridKernel.GetRowStride();
+		}
+		else
+		{
+			costField.pData = m_Influences.data() + channel * m_NrOfStoredNodes;
+		}
+		return costField;
+	}
+
+	template <class T_GraphType>
+	inline float InfluenceMap<T_GraphType>::EvaluateInfluence(int idx, const vector<InfluenceWeight>& weights)
+	{
+		if (!IsNodeValid(idx))
+			return 0.f;
+
+		UpdateTopology();
+		return ReadWeightedInfluence(idx, weights);
+	}
+
+	template <class T_GraphType>
+	inline float InfluenceMap<T_GraphType>::EvaluateInfluenceAtPosition(const Elite::Vector2& pos, const vector<InfluenceWeight>& weights)
+	{
+		return EvaluateInfluence(GetNodeIdxAtWorldPos(pos), weights);
+	}
+
+	template <class T_GraphType>
+	InfluenceRegionResult InfluenceMap<T_GraphType>::EvaluateInfluenceInRegion(const Elite::Vector2& min, const Elite::Vector2& max, const vector<InfluenceWeight>& weights)
+	{
+		UpdateTopology();
+
+		InfluenceRegionResult result{};
+		EvaluateRegion(min, max, weights, result, IsGridGraph<T_GraphType>());
+		return result;
+	}
+
+	template <class T_GraphType>
+	void InfluenceMap<T_GraphType>::EvaluateRegion(const Elite::Vector2& min, const Elite::Vector2& max, const vector<InfluenceWeight>& weights,
+		InfluenceRegionResult& result, std::true_type) const
+	{
+		//Only the cells whose center lies in the region
+		const float cellSize = float(GetCellSize());
+		const int firstColumn = Clamp(int(ceilf(min.x / cellSize - .5f)), 0, GetColumns());
+		const int endColumn = Clamp(int(floorf(max.x / cellSize - .5f)) + 1, 0, GetColumns());
+		const int firstRow = Clamp(int(ceilf(min.y / cellSize - .5f)), 0, GetRows());
+		const int endRow = Clamp(int(floorf(max.y / cellSize - .5f)) + 1, 0, GetRows());
+
+		for (int row = firstRow; row < endRow; ++row)
+		{
+			for (int col = firstColumn; col < endColumn; ++col)
 			{
-				nodeColor = Elite::Color{
-				Lerp(m_NeutralColor.r, m_PositiveColor.r, relativeInfluence),
-				Lerp(m_NeutralColor.g, m_PositiveColor.g, relativeInfluence),
-				Lerp(m_NeutralColor.b, m_PositiveColor.b, relativeInfluence)
-				};
+				const int idx = GetIndex(col, row);
+				if (m_Nodes[idx]->GetIndex() == invalid_node_index)
+					continue;
+
+				const float influence = ReadWeightedInfluence(idx, weights);
+				result.total += influence;
+				++result.nrOfNodes;
+				if (influence > result.highest) { result.highest = influence; result.highestIdx = idx; }
+				if (influence < result.lowest) { result.lowest = influence; result.lowestIdx = idx; }
 			}
+		}
+	}
+
+	template <class T_GraphType>
+	void InfluenceMap<T_GraphType>::EvaluateRegion(const Elite::Vector2& min, const Elite::Vector2& max, const vector<InfluenceWeight>& weights,
+		InfluenceRegionResult& result, std::false_type) const
+	{
+		for (int idx = 0; idx < m_NrOfStoredNodes; ++idx)
+		{
+			if (m_Nodes[idx]->GetIndex() == invalid_node_index)
+				continue;
+
+			const Vector2 pos = GetNodeWorldPos(idx);
+			if (pos.x < min.x || pos.x > max.x || pos.y < min.y || pos.y > max.y)
+				continue;
+
+			const float influence = ReadWeightedInfluence(idx, weights);
+			result.total += influence;
+			++result.nrOfNodes;
+			if (influence > result.highest) { result.highest = influence; result.highestIdx = idx; }
+			if (influence < result.lowest) { result.lowest = influence; result.lowestIdx = idx; }
+		}
+	}
+
+	template<class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::SetNodeColorsBasedOnInfluence()
+	{
+		const bool recolorAll = m_AreAllNodesOutOfDate;
+		SyncNodeInfluences();
+
+		if (recolorAll)
+		{
+			for (int idx = 0; idx < int(m_Nodes.size()); ++idx)
+				UpdateNodeColor(idx);
+		}
+		else
+		{
+			for (const int idx : m_NodesToRecolor)
+				UpdateNodeColor(idx);
+		}
+
+		for (const int idx : m_NodesToRecolor)
+			m_NodeFlags[idx] &= ~NodeColorOutOfDate;
+		m_NodesToRecolor.clear();
+	}
+
+	template<class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::UpdateNodeColor(int idx)
+	{
+		auto pNode = m_Nodes[idx];
+		Color nodeColor{};
+		float influence = pNode->GetInfluence();
+		float relativeInfluence = abs(influence) / m_MaxAbsInfluence;
 
-			pNode->SetColor(nodeColor);
+		if (influence < 0)
+		{
+			nodeColor = Elite::Color{
+			Lerp(m_NeutralColor.r, m_NegativeColor.r, relativeInfluence),
+			Lerp(m_NeutralColor.g, m_NegativeColor.g, relativeInfluence),
+			Lerp(m_NeutralColor.b, m_NegativeColor.b, relativeInfluence)
+			};
+		}
+		else
+		{
+			nodeColor = Elite::Color{
+			Lerp(m_NeutralColor.r, m_PositiveColor.r, relativeInfluence),
+			Lerp(m_NeutralColor.g, m_PositiveColor.g, relativeInfluence),
+			Lerp(m_NeutralColor.b, m_PositiveColor.b, relativeInfluence)
+			};
 		}
+
+		pNode->SetColor(nodeColor);
 	}
 
 	template<class T_GraphType>
 	inline void InfluenceMap<T_GraphType>::OnGraphModified(bool nrOfNodesChanged, bool nrOfConnectionsChanged)
 	{
-		InitializeBuffer();
+		//Only flag it, InitializeGrid adds thousands of nodes one by one
+		SyncNodeInfluences();
+		m_IsTopologyDirty = true;
+
+		//Fewer nodes than stored means the graph was cleared, a new graph starts without influence
+		if (nrOfNodesChanged && int(m_Nodes.size()) < m_NrOfStoredNodes)
+		{
+			FinishPropagation();
+			m_Influences.clear();
+			m_NrOfStoredNodes = 0;
+			m_IsGridKernelUsable = false;
+		}
 	}
-}
\ No newline at end of file
+}
@@ -6,7 +6,8 @@ using namespace Elite;
 
 Elite::NavGraph::NavGraph(const Polygon& contourMesh, float playerRadius = 1.0f) :
 	Graph2D(false),
-	m_pNavMeshPolygon(nullptr)
+	m_pNavMeshPolygon(nullptr),
+	m_SourceHash(HashSource(contourMesh, playerRadius))
 {
 	//Create the navigation mesh (polygon of navigatable area= Contour - Static Shapes)
 	m_pNavMeshPolygon = new Polygon(contourMesh); // Create copy on heap
@@ -28,6 +29,57 @@ Elite::NavGraph::NavGraph(const Polygon& contourMesh, float playerRadius = 1.0f)
 	CreateNavigationGraph();
 }
 
+Elite::NavGraph::NavGraph(const NavGraphBlob& bakedGraph) :
+	Graph2D(bakedGraph.GetHeader().isDirectional != 0),
+	m_pNavMeshPolygon(nullptr),
+	m_SourceHash(bakedGraph.GetHeader().sourceHash)
+{
+	//1. Restore the navigation mesh, shape 0 is the contour, the others are its children
+	const auto contour = bakedGraph.GetShapePoints(0);
+	m_pNavMeshPolygon = new Polygon(contour.pData, contour.count);
+	for (uint32_t i = 1; i < bakedGraph.GetShapes().size(); ++i)
+	{
+		const auto shape = bakedGraph.GetShapePoints(i);
+		m_pNavMeshPolygon->AddChild(Polygon(shape.pData, shape.count));
+	}
+
+	std::vector<Triangle*> triangles;
+	triangles.reserve(bakedGraph.GetTriangles().size());
+	for (const auto& bakedTriangle : bakedGraph.GetTriangles())
+	{
+		Triangle* pTriangle = new Triangle(bakedTriangle.p1, bakedTriangle.p2, bakedTriangle.p3);
+		pTriangle->metaData.IndexLines = { { bakedTriangle.lines[0], bakedTriangle.lines[1], bakedTriangle.lines[2] } };
+		triangles.push_back(pTriangle);
+	}
+	std::vector<Line*> lines;
+	lines.reserve(bakedGraph.GetLines().size());
+	for (const auto& bakedLine : bakedGraph.GetLines())
+		lines.push_back(new Line(bakedLine.p1, bakedLine.p2, bakedLine.index));
+	m_pNavMeshPolygon->SetTriangulation(triangles, lines);
+	CreateTriangleAdjacency();
+
+	//2. Nodes
+	const auto nodes = bakedGraph.GetNodes();
+	m_Nodes.reserve(nodes.size());
+	m_Connections.reserve(nodes.size());
+	m_LineToNode.assign(lines.size(), invalid_node_index);
+	for (uint32_t i = 0; i < nodes.size(); ++i)
+	{
+		NavGraphNode* pNode = new NavGraphNode(int(i), nodes[i].lineIdx, nodes[i].position);
+		pNode->SetPortalWidth(nodes[i].portalWidth);
+		m_LineToNode[nodes[i].lineIdx] = int(i);
+		AddNode(pNode);
+	}
+
+	//3. Connections, the baked adjacency already holds both directions so they are not mirrored again
+	for (uint32_t i = 0; i < nodes.size(); ++i)
+	{
+		for (const auto& bakedConnection : bakedGraph.GetConnections(int(i)))
+			m_Connections[i].push_back(new GraphConnection2D(int(i), bakedConnection.to, bakedConnection.cost));
+	}
+	OnGraphModified(false, true);
+}
+
 Elite::NavGraph::~NavGraph()
 {
 	delete m_pNavMeshPolygon; 
@@ -36,12 +88,19 @@ Elite::NavGraph::~NavGraph()
 
 int Elite::NavGraph::GetNodeIdxFromLineIdx(int lineIdx) const
 {
-	auto nodeIt = std::find_if(m_Nodes.begin(), m_Nodes.end(), [lineIdx](const NavGraphNode* n) { return n->GetLineIndex() == lineIdx; });
-	if (nodeIt != m_Nodes.end())
+	if (lineIdx < 0 || lineIdx >= int(m_LineToNode.size()))
+		return invalid_node_index;
+	return m_LineToNode[lineIdx];
+}
+
+int Elite::NavGraph::GetTriangleIdxFromPosition(const Vector2& position, bool onLineAllowed) const
+{
+	const auto& triangles = m_pNavMeshPolygon->GetTriangles();
+	for (size_t i = 0; i < triangles.size(); ++i)
 	{
-		return (*nodeIt)->GetIndex();
+		if (PointInTriangle(position, triangles[i]->p1, triangles[i]->p2, triangles[i]->p3, onLineAllowed))
+			return int(i);
 	}
-
 	return invalid_node_index;
 }
 
@@ -50,18 +109,247 @@ Elite::Polygon* Elite::NavGraph::GetNavMeshPolygon() const
 	return m_pNavMeshPolygon;
 }
 
+uint64_t Elite::NavGraph::HashSource(const Polygon& baseMesh, float playerRadius)
+{
+	const auto hashShape = [](const Polygon& polygon, uint64_t hash)
+	{
+		const uint32_t pointCount = uint32_t(polygon.GetPoints().size());
+		hash = HashGraphBlobInput(&pointCount, sizeof(pointCount), hash);
+		for (const auto& point : polygon.GetPoints())
+			hash = HashGraphBlobInput(&point, sizeof(point), hash);
+		return hash;
+	};
+
+	uint64_t hash = HashGraphBlobInput(&playerRadius, sizeof(playerRadius));
+	hash = hashShape(baseMesh, hash);
+	for (const auto& shape : PHYSICSWORLD->GetAllStaticShapesInWorld(PhysicsFlags::NavigationCollider))
+		hash = hashShape(shape, hash);
+	return hash;
+}
+
+GraphBlobWriter Elite::NavGraph::Bake() const
+{
+	//1. Flatten the navigation mesh
+	std::vector<BakedShape> shapes;
+	std::vector<Vector2> points;
+	const auto addShape = [&shapes, &points](const Polygon& polygon)
+	{
+		shapes.push_back({ uint32_t(points.size()), uint32_t(polygon.GetPoints().size()) });
+		points.insert(points.end(), polygon.GetPoints().begin(), polygon.GetPoints().end());
+	};
+	addShape(*m_pNavMeshPolygon);
+	for (const auto& child : m_pNavMeshPolygon->GetChildren())
+		addShape(child);
+
+	std::vector<BakedTriangle> triangles;
+	triangles.reserve(m_pNavMeshPolygon->GetTriangles().size());
+	for (const auto pTriangle : m_pNavMeshPolygon->GetTriangles())
+	{
+		const auto& lineIdx = pTriangle->metaData.IndexLines;
+		triangles.push_back({ pTriangle->p1, pTriangle->p2, pTriangle->p3, { lineIdx[0], lineIdx[1], lineIdx[2] } });
+	}
+
+	std::vector<BakedLine> lines;
+	lines.reserve(m_pNavMeshPolygon->GetLines().size());
+	for (const auto pLine : m_pNavMeshPolygon->GetLines())
+		lines.push_back({ pLine->p1, pLine->p2, pLine->index });
+
+	//2. Flatten the graph, adjacency lists become CSR (offsets + connections)
+	std::vector<BakedNavNode> nodes;
+	std::vector<uint32_t> connectionOffsets;
+	std::vector<BakedConnection> connections;
+	nodes.reserve(m_Nodes.size());
+	connectionOffsets.reserve(m_Nodes.size() + 1);
+	for (const auto pNode : m_Nodes)
+	{
+		nodes.push_back({ pNode->GetPosition(), pNode->GetLineIndex(), pNode->GetPortalWidth() });
+		connectionOffsets.push_back(uint32_t(connections.size()));
+		for (const auto pConnection : m_Connections[pNode->GetIndex()])
+			connections.push_back({ pConnection->GetTo(), pConnection->GetCost() });
+	}
+	connectionOffsets.push_back(uint32_t(connections.size()));
+
+	//3. Write
+	GraphBlobWriter writer{ sizeof(NavGraphBlobHeader) };
+	NavGraphBlobHeader header{};
+	header.sourceHash = m_SourceHash;
+	header.isDirectional = m_IsDirectionalGraph ? 1 : 0;
+	header.shapes = writer.Write(shapes);
+	header.points = writer.Write(points);
+	header.triangles = writer.Write(triangles);
+	header.lines = writer.Write(lines);
+	header.nodes = writer.Write(nodes);
+	header.connectionOffsets = writer.Write(connectionOffsets);
+	header.connections = writer.Write(connections);
+	writer.WriteHeader(header, GraphBlobType::NavGraph);
+	return writer;
+}
+
+bool Elite::NavGraph::HasLineOfSight(const Vector2& from, const Vector2& to, float agentRadius, Vector2* pBlockedPosition) const
+{
+	const auto& triangles = m_pNavMeshPolygon->GetTriangles();
+	int triangleIdx = GetTriangleIdxFromPosition(from, true);
+	if (triangleIdx == invalid_node_index)
+	{
+		if (pBlockedPosition)
+			*pBlockedPosition = from;
+		return false;
+	}
+
+	const Vector2 direction = to - from;
+	const float agentWidth = 2.f * agentRadius;
+	const float agentRadiusSquared = agentRadius * agentRadius;
+	const auto isWalkableEdge = [this](int triangle, int edge)
+	{
+		const int nodeIdx = GetNodeIdxFromLineIdx(m_pNavMeshPolygon->GetTriangles()[triangle]->metaData.IndexLines[edge]);
+		return m_TriangleNeighbors[triangle][edge] != invalid_node_index && nodeIdx != invalid_node_index;
+	};
+	const auto block = [pBlockedPosition](const Vector2& position)
+	{
+		if (pBlockedPosition)
+			*pBlockedPosition = position;
+		return false;
+	};
+
+	//Every step moves to a triangle further along the segment, so we can never visit more triangles than there are
+	for (size_t step = 0; step < triangles.size(); ++step)
+	{
+		const Triangle* pTriangle = triangles[triangleIdx];
+		const std::array<Vector2, 3> corners{ { pTriangle->p1, pTriangle->p2, pTriangle->p3 } };
+
+		//1. Keep agentRadius clearance. The mesh has no extra vertices, every corner is a corner of the contour or an obstacle
+		//(approximation: only the corners and border edges of the triangles we pass through are checked)
+		if (agentRadius > 0.f)
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				const Vector2 closest = ProjectOnLineSegment(from, to, corners[i]);
+				if (DistanceSquared(closest, corners[i]) < agentRadiusSquared)
+					return block(closest);
+
+				if (!isWalkableEdge(triangleIdx, i))
+				{
+					const Vector2& a = corners[i];
+					const Vector2& b = corners[(i + 1) % 3];
+					if (DistanceSquared(ProjectOnLineSegment(a, b, from), from) < agentRadiusSquared)
+						return block(from);
+					if (DistanceSquared(ProjectOnLineSegment(a, b, to), to) < agentRadiusSquared)
+						return block(to);
+				}
+			}
+		}
+
+		//2. Find the edge where the segment leaves the current triangle (largest crossing parameter)
+		int exitEdge = -1;
+		float exitT = -FLT_MAX;
+		for (int i = 0; i < 3; ++i)
+		{
+			const Vector2& a = corners[i];
+			const Vector2 edge = corners[(i + 1) % 3] - a;
+			const float denominator = Cross(direction, edge);
+			if (abs(denominator) < FLT_EPSILON)
+				continue; //Parallel
+
+			const Vector2 toEdge = a - from;
+			const float t = Cross(toEdge, edge) / denominator; //Along the segment
+			const float u = Cross(toEdge, direction) / denominator; //Along the edge
+			if (u >= 0.f && u <= 1.f && t > exitT)
+			{
+				exitT = t;
+				exitEdge = i;
+			}
+		}
+
+		//3. Target lies within this triangle
+		if (exitEdge == -1 || exitT >= 1.f)
+			return true;
+
+		//4. Continue through the edge if it is a portal the agent fits through
+		if (!isWalkableEdge(triangleIdx, exitEdge)
+			|| m_Nodes[GetNodeIdxFromLineIdx(pTriangle->metaData.IndexLines[exitEdge])]->GetPortalWidth() < agentWidth)
+			return block(from + direction * Clamp(exitT, 0.f, 1.f));
+
+		triangleIdx = m_TriangleNeighbors[triangleIdx][exitEdge];
+	}
+
+	//Out of steps: the walk stopped advancing (e.g. bouncing between two triangles on a shared edge), don't claim a clear line
+	return block(from);
+}
+
+void Elite::NavGraph::CreateTriangleAdjacency()
+{
+	//Every line is shared by at most two triangles
+	const auto& triangles = m_pNavMeshPolygon->GetTriangles();
+	std::vector<std::array<int, 2>> lineTriangles(m_pNavMeshPolygon->GetLines().size(), { { invalid_node_index, invalid_node_index } });
+	for (int t = 0; t < int(triangles.size()); ++t)
+	{
+		for (auto lineIdx : triangles[t]->metaData.IndexLines)
+		{
+			auto& sharedBy = lineTriangles[lineIdx];
+			sharedBy[sharedBy[0] == invalid_node_index ? 0 : 1] = t;
+		}
+	}
+
+	m_TriangleNeighbors.assign(triangles.size(), { { invalid_node_index, invalid_node_index, invalid_node_index } });
+	for (int t = 0; t < int(triangles.size()); ++t)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			const auto& sharedBy = lineTriangles[triangles[t]->metaData.IndexLines[i]];
+			m_TriangleNeighbors[t][i] = sharedBy[0] == t ? sharedBy[1] : sharedBy[0];
+		}
+	}
+}
+
+float Elite::NavGraph::GetPortalClearance(int triangleIdx, int edge) const
+{
+	//Every corner is a corner of the contour or an obstacle (the mesh has no extra vertices), so the portal is at most as wide
+	//as it is long. A border edge of the triangle starts at one end of the portal, the room left next to it is the distance
+	//from the other end: shorter than the portal when the border edge leans over it (acute angle between them)
+	const Triangle* pTriangle = m_pNavMeshPolygon->GetTriangles()[triangleIdx];
+	const std::array<Vector2, 3> corners{ { pTriangle->p1, pTriangle->p2, pTriangle->p3 } };
+	float clearance = Distance(corners[edge], corners[(edge + 1) % 3]);
+	for (int i = 0; i < 3; ++i)
+	{
+		if (i == edge || m_TriangleNeighbors[triangleIdx][i] != invalid_node_index)
+			continue;
+
+		//The corner opposite of a border edge is one of the ends of the portal
+		const Vector2& portalEnd = corners[(i + 2) % 3];
+		const Vector2 closest = ProjectOnLineSegment(corners[i], corners[(i + 1) % 3], portalEnd);
+		clearance = min(clearance, Distance(closest, portalEnd));
+	}
+	return clearance;
+}
+
 void Elite::NavGraph::CreateNavigationGraph()
 {
-	for (auto line : m_pNavMeshPolygon->GetLines())
+	//1. Go over all the edges of the navigationmesh and create nodes (only for edges shared by two triangles)
+	CreateTriangleAdjacency();
+	const auto& triangles = m_pNavMeshPolygon->GetTriangles();
+	m_LineToNode.assign(m_pNavMeshPolygon->GetLines().size(), invalid_node_index);
+	for (int t = 0; t < int(triangles.size()); ++t)
 	{
-		if (m_pNavMeshPolygon->GetTrianglesFromLineIndex(line->index).size() > 1)
+		for (int i = 0; i < 3; ++i)
 		{
+			const int neighbor = m_TriangleNeighbors[t][i];
+			if (neighbor == invalid_node_index || neighbor < t) //Border, or already handled from the other triangle
+				continue;
+
+			const auto line = m_pNavMeshPolygon->GetLines()[triangles[t]->metaData.IndexLines[i]];
 			auto center = line->p1 + (line->p2 - line->p1)/2.f;
 			NavGraphNode* node = new NavGraphNode(m_Nodes.size(), line->index, center);
+			int neighborEdge = 0;
+			while (triangles[neighbor]->metaData.IndexLines[neighborEdge] != line->index)
+				++neighborEdge;
+			node->SetPortalWidth(min(GetPortalClearance(t, i), GetPortalClearance(neighbor, neighborEdge)));
+			m_LineToNode[line->index] = node->GetIndex();
 			AddNode(node);
 		}
 	}
-	for (auto triangle : m_pNavMeshPolygon->GetTriangles())
+
+	//2. Create connections now that every node is created
+	for (auto triangle : triangles)
 	{
 		std::vector<NavGraphNode*> tempNodes;
 		for (auto lineIdx : triangle->metaData.IndexLines)
@@ -87,11 +375,7 @@ void Elite::NavGraph::CreateNavigationGraph()
 			AddConnection(connection3);
 		}
 	}
-	SetConnectionCostsToDistance();
-	//1. Go over all the edges of the navigationmesh and create nodes
-	
-	//2. Create connections now that every node is created
-	
+
 	//3. Set the connections cost to the actual distance
+	SetConnectionCostsToDistance();
 }
-
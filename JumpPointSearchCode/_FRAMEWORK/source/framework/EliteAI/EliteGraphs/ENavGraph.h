@@ -3,22 +3,50 @@
 #include "framework/EliteAI/EliteGraphs/EGraph2D.h"
 #include "framework/EliteAI/EliteGraphs/EGraphConnectionTypes.h"
 #include "framework/EliteAI/EliteGraphs/EGraphNodeTypes.h"
+#include "framework/EliteAI/EliteGraphs/EGraphBlob.h"
 
 namespace Elite
 {
 	class NavGraph final: public Graph2D<NavGraphNode, GraphConnection2D>
 	{
 	public:
+		//playerRadius expands the obstacles before triangulating, pass 0 to build one mesh that serves every agent size
+		//(NavMeshPathfinding::FindPath then uses the portal widths and the agent radius instead)
 		NavGraph(const Polygon& baseMesh, float playerRadius );
+		explicit NavGraph(const NavGraphBlob& bakedGraph); //Restores a baked graph, skips expanding, triangulating and graph creation
 		~NavGraph();
 
+		//Writes the navigation mesh and graph to the baked blob format, load it with MappedFile + NavGraphBlob
+		GraphBlobWriter Bake() const;
+		bool Bake(const std::string& path) const { return Bake().SaveToFile(path); }
+
+		//Hash of everything the mesh is built from: the contour, the static navigation colliders and the player radius
+		//Compare it with NavGraphBlobHeader::sourceHash to find out if a baked graph is still up to date
+		static uint64_t HashSource(const Polygon& baseMesh, float playerRadius);
+		uint64_t GetSourceHash() const { return m_SourceHash; }
+
 		int GetNodeIdxFromLineIdx(int lineIdx) const;
 		Polygon* GetNavMeshPolygon() const;
 
+		//Triangle adjacency: neighbor i is the triangle across IndexLines[i], invalid_node_index on the border of the mesh
+		int GetTriangleIdxFromPosition(const Vector2& position, bool onLineAllowed = false) const;
+		const std::array<int, 3>& GetTriangleNeighbors(int triangleIdx) const { return m_TriangleNeighbors[triangleIdx]; }
+
+		//Walkability raycast: walks the triangles along the segment through their shared edges
+		//Returns true when "to" is reached without leaving the mesh or crossing a portal narrower than the agent
+		//When blocked, pBlockedPosition (optional) receives the point where the segment leaves the walkable area
+		bool HasLineOfSight(const Vector2& from, const Vector2& to, float agentRadius = 0.f, Vector2* pBlockedPosition = nullptr) const;
+
 	private:
 		//--- Datamembers ---
 		Polygon* m_pNavMeshPolygon = nullptr; //Polygon that represents navigation mesh
+		std::vector<int> m_LineToNode; //Node index per line index, invalid_node_index for border lines
+		std::vector<std::array<int, 3>> m_TriangleNeighbors;
+		uint64_t m_SourceHash = 0;
 
+		void CreateTriangleAdjacency();
+		//Room next to the portal on an edge of a triangle, it narrows where a border edge of the triangle leans over it
+		float GetPortalClearance(int triangleIdx, int edge) const;
 		void CreateNavigationGraph();
 
 
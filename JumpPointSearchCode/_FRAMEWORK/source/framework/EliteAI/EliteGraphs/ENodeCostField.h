@@ -0,0 +1,28 @@
+#pragma once
+// ENodeCostField.h: read-only view of an extra cost per node (e.g. an influence map channel) that pathfinders add to the
+// connection costs, so tactical queries don't have to change or clone the graph. It doesn't own or copy the data.
+
+namespace Elite
+{
+	struct NodeCostField
+	{
+		const float* pData = nullptr;
+		int nrOfNodes = 0;
+		int columns = 0; //0 for one value per node index, else the data is a grid with rows of rowStride values
+		int rowStride = 0;
+		float weight = 1.f; //cost = weight * value, e.g. -1 to avoid negative (threat) influence
+
+		bool IsValid() const { return pData != nullptr; }
+
+		//Negative costs are clamped to 0, A* needs costs that never decrease
+		float GetCost(int idx) const
+		{
+			if (pData == nullptr || idx < 0 || idx >= nrOfNodes)
+				return 0.f;
+
+			const float value = columns > 0 ? pData[idx / columns * rowStride + idx % columns] : pData[idx];
+			const float cost = weight * value;
+			return cost > 0.f ? cost : 0.f;
+		}
+	};
+}
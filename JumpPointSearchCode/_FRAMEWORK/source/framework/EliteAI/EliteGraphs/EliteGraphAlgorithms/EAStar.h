@@ -1,4 +1,5 @@
 #pragma once
+#include "framework\EliteAI\EliteGraphs\ENodeCostField.h"
 
 namespace Elite
 {
@@ -32,11 +33,15 @@ namespace Elite
 
 		std::vector<T_NodeType*> FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode);
 
+		// Extra cost for entering a node on top of the connection cost, indexed like the graph (default: none)
+		void SetCostField(const NodeCostField& costField) { m_CostField = costField; }
+
 	private:
 		float GetHeuristicCost(T_NodeType* pStartNode, T_NodeType* pEndNode) const;
 
 		IGraph<T_NodeType, T_ConnectionType>* m_pGraph;
 		Heuristic m_HeuristicFunction;
+		NodeCostField m_CostField{};
 	};
 
 	template <class T_NodeType, class T_ConnectionType>
@@ -53,6 +58,7 @@ namespace Elite
 		vector<NodeRecord> openList;
 		vector<NodeRecord> closedList;
 		NodeRecord currentRecord;
+		bool isGoalReached = false;
 
 		// Create NodeRecord to kickstart loop
 		currentRecord.pNode = pStartNode;
@@ -71,12 +77,15 @@ namespace Elite
 					currentRecord = record;
 			}
 			if (currentRecord.pConnection != nullptr && currentRecord.pConnection->GetTo() == pGoalNode->GetIndex())
+			{
+				isGoalReached = true;
 				break;
+			}
 
 			for (auto connection: m_pGraph->GetNodeConnections(currentRecord.pNode))
 			{
-				auto GCost = currentRecord.costSoFar + connection->GetCost();
 				int currentNode = connection->GetTo();
+				auto GCost = currentRecord.costSoFar + connection->GetCost() + m_CostField.GetCost(currentNode);
 				auto LCost = GCost + GetHeuristicCost(m_pGraph->GetNode(currentNode), pGoalNode);
 				auto lambda = [currentNode](const NodeRecord& n)-> bool {return currentNode == n.pNode->GetIndex(); };
 				auto clFound = find_if(closedList.begin(), closedList.end(), lambda);
@@ -108,6 +117,10 @@ namespace Elite
 			closedList.push_back(currentRecord);
 		}
 
+		// Open list ran out without reaching the goal (e.g. every route is blocked), no path
+		if (!isGoalReached)
+			return path;
+
 		auto idx = currentRecord.pConnection->GetFrom();
 		path.push_back(pGoalNode);
 		while (idx != pStartNode->GetIndex())
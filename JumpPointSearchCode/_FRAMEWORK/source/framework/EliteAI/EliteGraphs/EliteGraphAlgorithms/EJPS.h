@@ -34,6 +34,9 @@ namespace Elite
 
 		std::vector<T_NodeType*> FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode);
 
+		// No cost field (see AStar::SetCostField): jumps skip every cell until a forced neighbor of water, so per-cell costs
+		// can't be honoured without giving up the pruning. Use AStar for paths that have to weigh influence
+
 	private:
 		float GetHeuristicCost(T_NodeType* pStartNode, T_NodeType* pEndNode) const;
 
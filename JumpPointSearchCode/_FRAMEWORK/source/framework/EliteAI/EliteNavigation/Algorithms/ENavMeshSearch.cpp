@@ -0,0 +1,123 @@
+#include "stdafx.h"
+#include "ENavMeshSearch.h"
+
+using namespace Elite;
+
+bool Elite::NavMeshSearch::FindCorridor(const Vector2& startPos, const Vector2& endPos, float agentRadius,
+	std::vector<Portal>& portals, std::vector<Vector2>* pDebugEntryPoints)
+{
+	portals.clear();
+	if (pDebugEntryPoints)
+		pDebugEntryPoints->clear();
+	m_NrOfExpanded = 0;
+
+	const Polygon* pPolygon = m_pNavGraph->GetNavMeshPolygon();
+	const auto& triangles = pPolygon->GetTriangles();
+	const auto& lines = pPolygon->GetLines();
+
+	const int startTriangle = m_pNavGraph->GetTriangleIdxFromPosition(startPos);
+	const int goalTriangle = m_pNavGraph->GetTriangleIdxFromPosition(endPos);
+	if (startTriangle == invalid_node_index || goalTriangle == invalid_node_index)
+		return false;
+
+	//Fresh search, records of previous searches become invalid by bumping the id
+	m_Records.resize(triangles.size());
+	if (++m_SearchId == 0)
+	{
+		for (auto& record : m_Records)
+			record.searchId = 0;
+		m_SearchId = 1;
+	}
+	m_OpenList.clear();
+
+	const auto openTriangle = [this](int triangle, const TriangleRecord& record)
+	{
+		m_Records[triangle] = record;
+		m_OpenList.push_back({ record.estimatedTotalCost, triangle });
+		std::push_heap(m_OpenList.begin(), m_OpenList.end(), std::greater<OpenEntry>());
+	};
+
+	TriangleRecord startRecord{};
+	startRecord.entryPoint = startPos;
+	startRecord.estimatedTotalCost = Distance(startPos, endPos);
+	startRecord.searchId = m_SearchId;
+	openTriangle(startTriangle, startRecord);
+
+	const float agentWidth = 2.f * agentRadius;
+	bool isGoalReached = false;
+	while (!m_OpenList.empty())
+	{
+		std::pop_heap(m_OpenList.begin(), m_OpenList.end(), std::greater<OpenEntry>());
+		const OpenEntry current = m_OpenList.back();
+		m_OpenList.pop_back();
+
+		TriangleRecord& currentRecord = m_Records[current.triangle];
+		if (currentRecord.isClosed || current.estimatedTotalCost > currentRecord.estimatedTotalCost)
+			continue; //Stale entry
+		currentRecord.isClosed = true;
+		++m_NrOfExpanded;
+
+		if (current.triangle == goalTriangle)
+		{
+			isGoalReached = true;
+			break;
+		}
+
+		const auto& neighbors = m_pNavGraph->GetTriangleNeighbors(current.triangle);
+		for (int i = 0; i < 3; ++i)
+		{
+			const int neighbor = neighbors[i];
+			if (neighbor == invalid_node_index)
+				continue;
+
+			//Portal must exist in the graph and be wide enough for the agent
+			const int lineIdx = triangles[current.triangle]->metaData.IndexLines[i];
+			const int nodeIdx = m_pNavGraph->GetNodeIdxFromLineIdx(lineIdx);
+			if (nodeIdx == invalid_node_index || m_pNavGraph->GetNode(nodeIdx)->GetPortalWidth() < agentWidth)
+				continue;
+
+			const TriangleRecord& neighborRecord = m_Records[neighbor];
+			const bool isKnown = neighborRecord.searchId == m_SearchId;
+			if (isKnown && neighborRecord.isClosed)
+				continue;
+
+			//Cross the portal at the point closest to where we entered the current triangle
+			const Line* pLine = lines[lineIdx];
+			const Vector2 entryPoint = ProjectOnLineSegment(pLine->p1, pLine->p2, currentRecord.entryPoint, agentRadius);
+			const float costSoFar = currentRecord.costSoFar + Distance(currentRecord.entryPoint, entryPoint);
+			if (isKnown && costSoFar >= neighborRecord.costSoFar)
+				continue;
+
+			TriangleRecord record{};
+			record.entryPoint = entryPoint;
+			record.costSoFar = costSoFar;
+			record.estimatedTotalCost = costSoFar + Distance(entryPoint, endPos);
+			record.parentTriangle = current.triangle;
+			record.entryLine = lineIdx;
+			record.searchId = m_SearchId;
+			openTriangle(neighbor, record);
+		}
+	}
+
+	if (!isGoalReached)
+		return false;
+
+	//Walk back from the goal to get the corridor
+	m_Corridor.clear();
+	for (int triangle = goalTriangle; triangle != startTriangle; triangle = m_Records[triangle].parentTriangle)
+		m_Corridor.push_back(triangle);
+	std::reverse(m_Corridor.begin(), m_Corridor.end());
+
+	//Portals are oriented as seen from the center of the triangle they are entered from
+	portals.push_back(Portal(Line(startPos, startPos)));
+	for (const int triangle : m_Corridor)
+	{
+		const TriangleRecord& record = m_Records[triangle];
+		const Vector2 approachPosition = triangles[record.parentTriangle]->GetCenter();
+		portals.push_back(SSFA::MakePortal(*lines[record.entryLine], approachPosition, agentRadius));
+		if (pDebugEntryPoints)
+			pDebugEntryPoints->push_back(record.entryPoint);
+	}
+	portals.push_back(Portal(Line(endPos, endPos)));
+	return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include "framework\EliteAI\EliteGraphs\ENavGraph.h"
+#include "framework\EliteAI\EliteNavigation\Algorithms\EPathSmoothing.h"
+
+namespace Elite
+{
+	//A* over the triangles of a navigation mesh (instead of over the edge midpoints of the NavGraph).
+	//A triangle is reached at the closest point of its entry portal (seen from where its parent was reached), which is
+	//a much tighter g-cost than the midpoint distances, and the heuristic is the Euclidean distance to the goal.
+	//The result is the portal corridor, ready to be funneled by SSFA::OptimizePortals.
+	class NavMeshSearch final
+	{
+	public:
+		//Keep the search around between queries on the same graph: the records and open list are reused, a new search id
+		//invalidates the records of the previous one
+		explicit NavMeshSearch(const NavGraph* pNavGraph) : m_pNavGraph(pNavGraph) {}
+
+		const NavGraph* GetNavGraph() const { return m_pNavGraph; }
+
+		//Fills portals (cleared first) with the corridor from startPos to endPos, including the degenerate start and end portals
+		//Portals narrower than the agent are not crossed, the others are shrunk by agentRadius
+		//Returns false if either position is off the mesh or no corridor exists
+		bool FindCorridor(const Vector2& startPos, const Vector2& endPos, float agentRadius,
+			std::vector<Portal>& portals, std::vector<Vector2>* pDebugEntryPoints = nullptr);
+
+		int GetNrOfExpandedTriangles() const { return m_NrOfExpanded; }
+
+	private:
+		struct TriangleRecord
+		{
+			Vector2 entryPoint = {}; //Closest point on the entry portal
+			float costSoFar = 0.f; //g-cost
+			float estimatedTotalCost = 0.f; //f-cost
+			int parentTriangle = invalid_node_index;
+			int entryLine = invalid_node_index;
+			unsigned int searchId = 0; //Record is only valid when this matches m_SearchId, avoids clearing all records per search
+			bool isClosed = false;
+		};
+
+		struct OpenEntry
+		{
+			float estimatedTotalCost;
+			int triangle;
+			bool operator>(const OpenEntry& other) const { return estimatedTotalCost > other.estimatedTotalCost; }
+		};
+
+		const NavGraph* m_pNavGraph = nullptr;
+		std::vector<TriangleRecord> m_Records;
+		std::vector<OpenEntry> m_OpenList; //Binary heap, stale entries are skipped when popped
+		std::vector<int> m_Corridor;
+		unsigned int m_SearchId = 0;
+		int m_NrOfExpanded = 0;
+	};
+}
@@ -4,6 +4,11 @@
 #include "framework/EliteGeometry/EGeometry2DTypes.h"
 #include "framework/EliteAI/EliteGraphs/EGraphNodeTypes.h"
 
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#include <xmmintrin.h>
+#define ELITE_SSFA_SIMD
+#endif
+
 namespace Elite
 {
 	//Portal struct (only contains line info atm, you can expand this if needed)
@@ -16,6 +21,25 @@ namespace Elite
 		Elite::Line Line = {};
 	};
 
+	//Range in one of the shared buffers of SSFABatch
+	struct SSFARange
+	{
+		uint32_t first = 0;
+		uint32_t count = 0;
+	};
+
+	//Caller owned buffers for SSFA::SmoothPaths, keep one around so the buffers are reused between calls
+	struct SSFABatch
+	{
+		//Output: corridor i uses portals[portalRanges[i]] and its smoothed path is points[pathRanges[i]]
+		std::vector<Portal> portals;
+		std::vector<SSFARange> portalRanges;
+		std::vector<Elite::Vector2> points;
+		std::vector<SSFARange> pathRanges;
+
+		//Scratch (SoA) for the portal orientation pass
+		std::vector<float> previousX, previousY;
+	};
 
 	class SSFA final
 	{
@@ -24,14 +48,16 @@ namespace Elite
 		//--- References ---
 		//http://digestingduck.blogspot.be/2010/03/simple-stupid-funnel-algorithm.html
 		//https://gamedev.stackexchange.com/questions/68302/how-does-the-simple-stupid-funnel-algorithm-work
-		static std::vector<Portal> FindPortals(
+		//Writes the portals of the node path into portals (cleared first, capacity is reused)
+		//Portals are shrunk by agentRadius on both sides so the funnel keeps the agent away from the corners
+		static void FindPortals(
 			const std::vector<NavGraphNode*>& nodePath,
-			Polygon* navMeshPolygon)
+			const Polygon* navMeshPolygon,
+			std::vector<Portal>& portals,
+			float agentRadius = 0.f)
 		{
-			//Container
-			std::vector<Portal> vPortals = {};
-
-			vPortals.push_back(Portal(Line(nodePath[0]->GetPosition(), nodePath[0]->GetPosition())));
+			portals.clear();
+			portals.push_back(Portal(Line(nodePath[0]->GetPosition(), nodePath[0]->GetPosition())));
 
 			//For each node received, get it's corresponding line
 			for (size_t i = 1; i < nodePath.size() - 1; ++i)
@@ -39,39 +65,49 @@ namespace Elite
 				//Local variables
 				auto pNode = nodePath[i]; //Store node, except last node, because this is our target node!
 				auto pLine = navMeshPolygon->GetLines()[pNode->GetLineIndex()];
-
-				//Redetermine it's "orientation" based on the required path (left-right vs right-left) - p1 should be right point
-				auto centerLine = (pLine->p1 + pLine->p2) / 2.0f;
-				auto previousPosition = i == 0 ? nodePath[0]->GetPosition() : nodePath[i - 1]->GetPosition();
-				auto cp = Cross((centerLine - previousPosition), (pLine->p1 - previousPosition));
-				Line portalLine = {};
-				if (cp > 0)//Left
-					portalLine = Line(pLine->p2, pLine->p1);
-				else //Right
-					portalLine = Line(pLine->p1, pLine->p2);
-
-				//Store portal
-				vPortals.push_back(Portal(portalLine));
+				portals.push_back(MakePortal(*pLine, nodePath[i - 1]->GetPosition(), agentRadius));
 			}
 			//Add degenerate portal to force end evaluation
-			vPortals.push_back(Portal(Line(nodePath[nodePath.size()-1]->GetPosition(), nodePath[nodePath.size() - 1]->GetPosition())));
+			portals.push_back(Portal(Line(nodePath[nodePath.size() - 1]->GetPosition(), nodePath[nodePath.size() - 1]->GetPosition())));
+		}
 
-			return vPortals;
+		//Creates the portal for a line that is crossed coming from approachPosition
+		static Portal MakePortal(const Line& line, const Elite::Vector2& approachPosition, float agentRadius = 0.f)
+		{
+			//Redetermine it's "orientation" based on the required path (left-right vs right-left) - p1 should be right point
+			auto centerLine = (line.p1 + line.p2) / 2.0f;
+			auto cp = Cross((centerLine - approachPosition), (line.p1 - approachPosition));
+			Portal portal{};
+			if (cp > 0)//Left
+				portal = Portal(Line(line.p2, line.p1));
+			else //Right
+				portal = Portal(Line(line.p1, line.p2));
+			ShrinkPortal(portal, agentRadius);
+			return portal;
 		}
 
-		static std::vector<Elite::Vector2> OptimizePortals(const std::vector<Portal>& portals)
+		//Runs the funnel over the portals and APPENDS the resulting points to path (single pass, no searching in the output)
+		static void OptimizePortals(const Portal* pPortals, size_t nrOfPortals, std::vector<Elite::Vector2>& path)
 		{
 			//P1 == right point of portal, P2 == left point of portal
-			std::vector<Elite::Vector2> vPath = {};
-			auto apex = portals[0].Line.p1;
-			auto apexIndex = 0, leftLegIndex = 1, rightLegIndex = 1;
-			auto rightLeg = portals[rightLegIndex].Line.p1 - apex;
-			auto leftLeg = portals[leftLegIndex].Line.p2 - apex;
+			const size_t pathStart = path.size();
+			const auto nrOfPortalsU = static_cast<unsigned int>(nrOfPortals);
+			auto apex = pPortals[0].Line.p1;
+			auto apexIndex = 0u, leftLegIndex = 1u, rightLegIndex = 1u;
+			auto rightLeg = pPortals[rightLegIndex].Line.p1 - apex;
+			auto leftLeg = pPortals[leftLegIndex].Line.p2 - apex;
+
+			//The apex only moves forward through the corridor, so a duplicate can only be the point we pushed last
+			const auto pushApex = [&path, pathStart](const Elite::Vector2& point)
+			{
+				if (path.size() == pathStart || !(path.back() == point))
+					path.push_back(point);
+			};
 
-			for (unsigned int i = 1; i < static_cast<unsigned int>(portals.size()); ++i)
+			for (unsigned int i = 1; i < nrOfPortalsU; ++i)
 			{
 				//Local
-				const auto &portal = portals[i];
+				const auto &portal = pPortals[i];
 
 				//--- RIGHT CHECK ---
 				auto newRightLeg = portal.Line.p1 - apex;
@@ -90,13 +126,11 @@ namespace Elite
 						apexIndex = leftLegIndex;
 						unsigned int newIt = apexIndex + 1;
 						i = leftLegIndex = rightLegIndex = newIt;
-						//if (std::find_if(vPath.begin(), vPath.end(), [&apex](const Elite::Vector2& lhs) { return lhs == apex;  }) == vPath.end())
-						if (find(vPath.begin(), vPath.end(), apex) == vPath.end())
-							vPath.push_back(apex);
-						if (newIt < static_cast<unsigned int>(portals.size()))
+						pushApex(apex);
+						if (newIt < nrOfPortalsU)
 						{
-							rightLeg = portals[rightLegIndex].Line.p1 - apex;
-							leftLeg = portals[leftLegIndex].Line.p2 - apex;
+							rightLeg = pPortals[rightLegIndex].Line.p1 - apex;
+							leftLeg = pPortals[leftLegIndex].Line.p2 - apex;
 							continue;
 						}
 					}
@@ -119,13 +153,11 @@ namespace Elite
 						apexIndex = rightLegIndex;
 						unsigned int newIt = apexIndex + 1;
 						i = leftLegIndex = rightLegIndex = newIt;
-						//if (std::find_if(vPath.begin(), vPath.end(), [&apex](const Elite::Vector2& lhs) { return lhs == apex;  }) == vPath.end())
-						if (find(vPath.begin(), vPath.end(), apex) == vPath.end())
-							vPath.push_back(apex);
-						if (newIt < static_cast<unsigned int>(portals.size()))
+						pushApex(apex);
+						if (newIt < nrOfPortalsU)
 						{
-							rightLeg = portals[rightLegIndex].Line.p1 - apex;
-							leftLeg = portals[leftLegIndex].Line.p2 - apex;
+							rightLeg = pPortals[rightLegIndex].Line.p1 - apex;
+							leftLeg = pPortals[leftLegIndex].Line.p2 - apex;
 							continue;
 						}
 					}
@@ -133,12 +165,124 @@ namespace Elite
 			}
 			
 			// Add last path point (You can use the last portal p1 or p2 points as both are equal to the endPoint of the path
-			vPath.push_back(portals[portals.size()-1].Line.p1);
-			
-			return vPath;
+			path.push_back(pPortals[nrOfPortals - 1].Line.p1);
 		}
+
+		//Smooths the corridors of many agents in one call. All portals are gathered first so their orientation
+		//(one cross product per portal) is computed in a single vectorised pass, after which each corridor is funneled.
+		static void SmoothPaths(
+			const std::vector<std::vector<NavGraphNode*>>& nodePaths,
+			const Polygon* navMeshPolygon,
+			SSFABatch& batch,
+			float agentRadius = 0.f)
+		{
+			batch.portals.clear();
+			batch.portalRanges.clear();
+			batch.points.clear();
+			batch.pathRanges.clear();
+			batch.previousX.clear();
+			batch.previousY.clear();
+
+			//1. Gather the unoriented portals and the position each portal is approached from
+			const auto& lines = navMeshPolygon->GetLines();
+			for (const auto& nodePath : nodePaths)
+			{
+				SSFARange range{ static_cast<uint32_t>(batch.portals.size()), 0 };
+				if (nodePath.size() >= 2)
+				{
+					for (size_t i = 0; i < nodePath.size(); ++i)
+					{
+						const auto position = nodePath[i]->GetPosition();
+						const bool isEndPoint = i == 0 || i == nodePath.size() - 1;
+						const auto previous = i == 0 ? position : nodePath[i - 1]->GetPosition();
+						batch.portals.push_back(isEndPoint ? Portal(Line(position, position)) : Portal(*lines[nodePath[i]->GetLineIndex()]));
+						batch.previousX.push_back(previous.x);
+						batch.previousY.push_back(previous.y);
+					}
+					range.count = static_cast<uint32_t>(nodePath.size());
+				}
+				batch.portalRanges.push_back(range);
+			}
+
+			//2. Orient all portals at once (p1 should be the right point)
+			OrientPortals(batch.portals.data(), batch.previousX.data(), batch.previousY.data(), batch.portals.size());
+			if (agentRadius > 0.f)
+			{
+				for (auto& portal : batch.portals)
+					ShrinkPortal(portal, agentRadius);
+			}
+
+			//3. Funnel each corridor into the shared point buffer
+			for (const auto& portalRange : batch.portalRanges)
+			{
+				SSFARange pathRange{ static_cast<uint32_t>(batch.points.size()), 0 };
+				if (portalRange.count > 0)
+					OptimizePortals(batch.portals.data() + portalRange.first, portalRange.count, batch.points);
+				pathRange.count = static_cast<uint32_t>(batch.points.size()) - pathRange.first;
+				batch.pathRanges.push_back(pathRange);
+			}
+		}
+
 	private:
 		SSFA() {};
 		~SSFA() {};
+
+		//Moves both portal points inwards by radius, portals narrower than the agent collapse onto their center
+		static void ShrinkPortal(Portal& portal, float radius)
+		{
+			auto& line = portal.Line;
+			const auto edge = line.p2 - line.p1;
+			const float length = edge.Magnitude();
+			if (length <= 2.f * radius)
+			{
+				line.p1 = line.p2 = (line.p1 + line.p2) / 2.0f;
+				return;
+			}
+			const auto offset = edge * (radius / length);
+			line.p1 += offset;
+			line.p2 -= offset;
+		}
+
+		//Swaps the points of every portal that is approached from its left side
+		//cross = (center - previous) x (p1 - previous)
+		static void OrientPortals(Portal* pPortals, const float* pPreviousX, const float* pPreviousY, size_t count)
+		{
+			size_t i = 0;
+#ifdef ELITE_SSFA_SIMD
+			const __m128 half = _mm_set1_ps(0.5f);
+			const __m128 zero = _mm_setzero_ps();
+			for (; i + 4 <= count; i += 4)
+			{
+				const Portal* p = pPortals + i;
+				const __m128 ax = _mm_setr_ps(p[0].Line.p1.x, p[1].Line.p1.x, p[2].Line.p1.x, p[3].Line.p1.x);
+				const __m128 ay = _mm_setr_ps(p[0].Line.p1.y, p[1].Line.p1.y, p[2].Line.p1.y, p[3].Line.p1.y);
+				const __m128 bx = _mm_setr_ps(p[0].Line.p2.x, p[1].Line.p2.x, p[2].Line.p2.x, p[3].Line.p2.x);
+				const __m128 by = _mm_setr_ps(p[0].Line.p2.y, p[1].Line.p2.y, p[2].Line.p2.y, p[3].Line.p2.y);
+				const __m128 px = _mm_loadu_ps(pPreviousX + i);
+				const __m128 py = _mm_loadu_ps(pPreviousY + i);
+
+				const __m128 centerX = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(ax, bx), half), px);
+				const __m128 centerY = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(ay, by), half), py);
+				const __m128 cross = _mm_sub_ps(
+					_mm_mul_ps(centerX, _mm_sub_ps(ay, py)),
+					_mm_mul_ps(centerY, _mm_sub_ps(ax, px)));
+
+				const int leftMask = _mm_movemask_ps(_mm_cmpgt_ps(cross, zero));
+				for (int lane = 0; lane < 4; ++lane)
+				{
+					if (leftMask & (1 << lane))
+						std::swap(pPortals[i + lane].Line.p1, pPortals[i + lane].Line.p2);
+				}
+			}
+#endif
+			for (; i < count; ++i)
+			{
+				auto& line = pPortals[i].Line;
+				const Vector2 previous{ pPreviousX[i], pPreviousY[i] };
+				const auto centerLine = (line.p1 + line.p2) / 2.0f;
+				if (Cross(centerLine - previous, line.p1 - previous) > 0)
+					std::swap(line.p1, line.p2);
+			}
+		}
 	};
 }
@@ -0,0 +1,401 @@
+#include "stdafx.h"
+#include "EAABBTree.h"
+
+#include <array>
+
+using namespace Elite;
+
+namespace
+{
+	float GetPerimeter(const Vector2& min, const Vector2& max)
+	{
+		return 2.f * ((max.x - min.x) + (max.y - min.y));
+	}
+
+	Vector2 GetMin(const Vector2& v1, const Vector2& v2) { return { min(v1.x, v2.x), min(v1.y, v2.y) }; }
+	Vector2 GetMax(const Vector2& v1, const Vector2& v2) { return { max(v1.x, v2.x), max(v1.y, v2.y) }; }
+
+	//Traversal stack of a query, one per query so the queries can run in parallel and a filter can run queries of its own.
+	//Balanced trees stay well within the fixed part, only very deep ones spill onto the heap
+	class QueryStack final
+	{
+	public:
+		bool IsEmpty() const { return m_Size == 0; }
+		void Push(int node)
+		{
+			if (m_Size < FixedSize)
+				m_Fixed[m_Size] = node;
+			else
+				m_Overflow.push_back(node);
+			++m_Size;
+		}
+		int Pop()
+		{
+			--m_Size;
+			if (m_Size < FixedSize)
+				return m_Fixed[m_Size];
+
+			const int node = m_Overflow.back();
+			m_Overflow.pop_back();
+			return node;
+		}
+
+	private:
+		static const int FixedSize = 64;
+		std::array<int, FixedSize> m_Fixed;
+		std::vector<int> m_Overflow{};
+		int m_Size = 0;
+	};
+}
+
+Elite::AABBTree::AABBTree(float margin)
+	: m_Margin{ margin > 0.f ? margin : 0.f }
+{
+}
+
+void Elite::AABBTree::Clear()
+{
+	m_Root = null_node;
+	m_FreeList = null_node;
+	m_Nodes.clear();
+	m_Items.clear();
+}
+
+void Elite::AABBTree::Insert(int id, const Vector2& center, float radius)
+{
+	if (id < 0)
+		return;
+	if (Contains(id))
+	{
+		Move(id, center, radius);
+		return;
+	}
+
+	if (id >= int(m_Items.size()))
+		m_Items.resize(id + 1);
+
+	const int leaf = AllocateNode();
+	const Vector2 extents{ radius + m_Margin, radius + m_Margin };
+	m_Nodes[leaf].min = center - extents;
+	m_Nodes[leaf].max = center + extents;
+	m_Nodes[leaf].id = id;
+	m_Nodes[leaf].height = 0;
+
+	Item& item = m_Items[id];
+	item.center = center;
+	item.radius = radius;
+	item.leaf = leaf;
+	InsertLeaf(leaf);
+}
+
+void Elite::AABBTree::Move(int id, const Vector2& center, float radius)
+{
+	if (!Contains(id))
+	{
+		Insert(id, center, radius);
+		return;
+	}
+
+	Item& item = m_Items[id];
+	item.center = center;
+	item.radius = radius;
+
+	//Still inside of the fat box: nothing to do
+	Node& leaf = m_Nodes[item.leaf];
+	if (center.x - radius >= leaf.min.x && center.y - radius >= leaf.min.y && center.x + radius <= leaf.max.x && center.y + radius <= leaf.max.y)
+		return;
+
+	RemoveLeaf(item.leaf);
+	const Vector2 extents{ radius + m_Margin, radius + m_Margin };
+	leaf.min = center - extents;
+	leaf.max = center + extents;
+	InsertLeaf(item.leaf);
+}
+
+void Elite::AABBTree::Remove(int id)
+{
+	if (!Contains(id))
+		return;
+
+	const int leaf = m_Items[id].leaf;
+	RemoveLeaf(leaf);
+	FreeNode(leaf);
+	m_Items[id].leaf = null_node;
+}
+
+void Elite::AABBTree::QueryRange(const Vector2& min, const Vector2& max, std::vector<int>& ids) const
+{
+	if (m_Root == null_node)
+		return;
+
+	QueryStack stack{};
+	stack.Push(m_Root);
+	while (!stack.IsEmpty())
+	{
+		const Node& node = m_Nodes[stack.Pop()];
+		if (!AreBoxesOverlapping(min, max, node.min, node.max))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			const Item& item = m_Items[node.id];
+			const Vector2 extents{ item.radius, item.radius };
+			if (AreBoxesOverlapping(min, max, item.center - extents, item.center + extents))
+				ids.push_back(node.id);
+			continue;
+		}
+
+		stack.Push(node.child1);
+		stack.Push(node.child2);
+	}
+}
+
+void Elite::AABBTree::QueryRadius(const Vector2& center, float radius, std::vector<int>& ids) const
+{
+	if (m_Root == null_node)
+		return;
+
+	const float radiusSquared = radius * radius;
+	QueryStack stack{};
+	stack.Push(m_Root);
+	while (!stack.IsEmpty())
+	{
+		const Node& node = m_Nodes[stack.Pop()];
+		if (DistanceSquaredToBox(center, node.min, node.max) > radiusSquared)
+			continue;
+
+		if (node.IsLeaf())
+		{
+			const Item& item = m_Items[node.id];
+			const float reach = radius + item.radius;
+			if (DistanceSquared(center, item.center) <= reach * reach)
+				ids.push_back(node.id);
+			continue;
+		}
+
+		stack.Push(node.child1);
+		stack.Push(node.child2);
+	}
+}
+
+int Elite::AABBTree::QueryNearest(const Vector2& pos, float maxDistance, const Filter& filter) const
+{
+	int nearest = InvalidId;
+	if (m_Root == null_node)
+		return nearest;
+
+	float nearestDistanceSquared = maxDistance * maxDistance;
+	QueryStack stack{};
+	stack.Push(m_Root);
+	while (!stack.IsEmpty())
+	{
+		const Node& node = m_Nodes[stack.Pop()];
+		if (DistanceSquaredToBox(pos, node.min, node.max) >= nearestDistanceSquared)
+			continue;
+
+		if (node.IsLeaf())
+		{
+			const float distanceSquared = DistanceSquared(pos, m_Items[node.id].center);
+			if (distanceSquared < nearestDistanceSquared && (!filter || filter(node.id)))
+			{
+				nearest = node.id;
+				nearestDistanceSquared = distanceSquared;
+			}
+			continue;
+		}
+
+		//Visit the closest child first, so the search radius shrinks quickly
+		const Node& child1 = m_Nodes[node.child1];
+		const Node& child2 = m_Nodes[node.child2];
+		if (DistanceSquaredToBox(pos, child1.min, child1.max) < DistanceSquaredToBox(pos, child2.min, child2.max))
+		{
+			stack.Push(node.child2);
+			stack.Push(node.child1);
+		}
+		else
+		{
+			stack.Push(node.child1);
+			stack.Push(node.child2);
+		}
+	}
+
+	return nearest;
+}
+
+int Elite::AABBTree::AllocateNode()
+{
+	int node = m_FreeList;
+	if (node != null_node)
+		m_FreeList = m_Nodes[node].parent;
+	else
+	{
+		node = int(m_Nodes.size());
+		m_Nodes.emplace_back();
+	}
+
+	m_Nodes[node] = Node{};
+	return node;
+}
+
+void Elite::AABBTree::FreeNode(int node)
+{
+	m_Nodes[node].parent = m_FreeList;
+	m_Nodes[node].height = -1;
+	m_FreeList = node;
+}
+
+void Elite::AABBTree::InsertLeaf(int leaf)
+{
+	if (m_Root == null_node)
+	{
+		m_Root = leaf;
+		m_Nodes[leaf].parent = null_node;
+		return;
+	}
+
+	//Find the best sibling: walk down while it's cheaper to push the leaf into a child than to pair it with the node
+	const Vector2 leafMin = m_Nodes[leaf].min;
+	const Vector2 leafMax = m_Nodes[leaf].max;
+	int sibling = m_Root;
+	while (!m_Nodes[sibling].IsLeaf())
+	{
+		const Node& node = m_Nodes[sibling];
+		const float perimeter = GetPerimeter(node.min, node.max);
+		const float combinedPerimeter = GetPerimeter(GetMin(node.min, leafMin), GetMax(node.max, leafMax));
+
+		//Cost of a new parent for this node and the leaf, and the minimum cost of pushing the leaf further down
+		const float cost = 2.f * combinedPerimeter;
+		const float inheritanceCost = 2.f * (combinedPerimeter - perimeter);
+
+		float childCosts[2];
+		const int children[2] = { node.child1, node.child2 };
+		for (int i = 0; i < 2; ++i)
+		{
+			const Node& child = m_Nodes[children[i]];
+			const float childPerimeter = GetPerimeter(GetMin(child.min, leafMin), GetMax(child.max, leafMax));
+			childCosts[i] = (child.IsLeaf() ? childPerimeter : childPerimeter - GetPerimeter(child.min, child.max)) + inheritanceCost;
+		}
+
+		if (cost < childCosts[0] && cost < childCosts[1])
+			break;
+
+		sibling = childCosts[0] < childCosts[1] ? children[0] : children[1];
+	}
+
+	//Pair the leaf and the sibling under a new parent
+	const int oldParent = m_Nodes[sibling].parent;
+	const int newParent = AllocateNode();
+	m_Nodes[newParent].parent = oldParent;
+	m_Nodes[newParent].min = GetMin(leafMin, m_Nodes[sibling].min);
+	m_Nodes[newParent].max = GetMax(leafMax, m_Nodes[sibling].max);
+	m_Nodes[newParent].height = m_Nodes[sibling].height + 1;
+	m_Nodes[newParent].child1 = sibling;
+	m_Nodes[newParent].child2 = leaf;
+	m_Nodes[sibling].parent = newParent;
+	m_Nodes[leaf].parent = newParent;
+
+	if (oldParent == null_node)
+		m_Root = newParent;
+	else if (m_Nodes[oldParent].child1 == sibling)
+		m_Nodes[oldParent].child1 = newParent;
+	else
+		m_Nodes[oldParent].child2 = newParent;
+
+	RefitAncestors(oldParent);
+}
+
+void Elite::AABBTree::RemoveLeaf(int leaf)
+{
+	if (leaf == m_Root)
+	{
+		m_Root = null_node;
+		return;
+	}
+
+	const int parent = m_Nodes[leaf].parent;
+	const int grandParent = m_Nodes[parent].parent;
+	const int sibling = m_Nodes[parent].child1 == leaf ? m_Nodes[parent].child2 : m_Nodes[parent].child1;
+
+	//The sibling takes the place of the parent
+	m_Nodes[sibling].parent = grandParent;
+	if (grandParent == null_node)
+		m_Root = sibling;
+	else if (m_Nodes[grandParent].child1 == parent)
+		m_Nodes[grandParent].child1 = sibling;
+	else
+		m_Nodes[grandParent].child2 = sibling;
+
+	FreeNode(parent);
+	RefitAncestors(grandParent);
+}
+
+int Elite::AABBTree::Balance(int iA)
+{
+	//Rotates the higher child of A up when the heights of A's children differ by more than one
+	Node& A = m_Nodes[iA];
+	if (A.IsLeaf() || A.height < 2)
+		return iA;
+
+	const int iB = A.child1;
+	const int iC = A.child2;
+	const int balance = m_Nodes[iC].height - m_Nodes[iB].height;
+	if (balance >= -1 && balance <= 1)
+		return iA;
+
+	//Higher child (goes up), its children (the higher one stays with it) and the lower child of A
+	const int iUp = balance > 1 ? iC : iB;
+	const int iLow = balance > 1 ? iB : iC;
+	Node& up = m_Nodes[iUp];
+	const int iF = up.child1;
+	const int iG = up.child2;
+	const bool keepF = m_Nodes[iF].height > m_Nodes[iG].height;
+	const int iKeep = keepF ? iF : iG;
+	const int iGive = keepF ? iG : iF;
+
+	//A becomes a child of up
+	up.child1 = iA;
+	up.child2 = iKeep;
+	up.parent = A.parent;
+	A.parent = iUp;
+	if (up.parent == null_node)
+		m_Root = iUp;
+	else if (m_Nodes[up.parent].child1 == iA)
+		m_Nodes[up.parent].child1 = iUp;
+	else
+		m_Nodes[up.parent].child2 = iUp;
+
+	//A keeps its lower child and gets the other child of up
+	if (balance > 1)
+		A.child2 = iGive;
+	else
+		A.child1 = iGive;
+	m_Nodes[iGive].parent = iA;
+
+	const Node& low = m_Nodes[iLow];
+	const Node& give = m_Nodes[iGive];
+	const Node& keep = m_Nodes[iKeep];
+	A.min = GetMin(low.min, give.min);
+	A.max = GetMax(low.max, give.max);
+	A.height = 1 + max(low.height, give.height);
+	up.min = GetMin(A.min, keep.min);
+	up.max = GetMax(A.max, keep.max);
+	up.height = 1 + max(A.height, keep.height);
+	return iUp;
+}
+
+void Elite::AABBTree::RefitAncestors(int node)
+{
+	while (node != null_node)
+	{
+		node = Balance(node);
+
+		Node& n = m_Nodes[node];
+		const Node& child1 = m_Nodes[n.child1];
+		const Node& child2 = m_Nodes[n.child2];
+		n.height = 1 + max(child1.height, child2.height);
+		n.min = GetMin(child1.min, child2.min);
+		n.max = GetMax(child1.max, child2.max);
+
+		node = n.parent;
+	}
+}
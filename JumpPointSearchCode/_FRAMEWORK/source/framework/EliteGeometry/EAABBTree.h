@@ -0,0 +1,66 @@
+#pragma once
+// EAABBTree.h: dynamic bounding volume tree (same idea as Box2D's b2DynamicTree).
+// Every item is a leaf with a box that is fattened by a margin, so an item that moves a little stays in its leaf and
+// only items leaving their fat box are reinserted. New leaves go next to the sibling that grows the tree's boxes the
+// least and the tree is kept balanced with rotations, so it needs no world bounds and copes with clusters.
+#include "ESpatialPartition.h"
+
+namespace Elite
+{
+	class AABBTree final : public ISpatialPartition
+	{
+	public:
+		explicit AABBTree(float margin = 2.f);
+		~AABBTree() = default;
+
+		SpatialPartitionType GetType() const override { return SpatialPartitionType::AABBTree; }
+
+		void Clear() override;
+		void Insert(int id, const Vector2& center, float radius) override;
+		void Move(int id, const Vector2& center, float radius) override;
+		void Remove(int id) override;
+		bool Contains(int id) const override { return id >= 0 && id < int(m_Items.size()) && m_Items[id].leaf != null_node; }
+
+		void QueryRange(const Vector2& min, const Vector2& max, std::vector<int>& ids) const override;
+		void QueryRadius(const Vector2& center, float radius, std::vector<int>& ids) const override;
+		int QueryNearest(const Vector2& pos, float maxDistance, const Filter& filter = nullptr) const override;
+
+		int GetHeight() const { return m_Root == null_node ? 0 : m_Nodes[m_Root].height; }
+
+	private:
+		static constexpr int null_node = -1;
+
+		struct Node
+		{
+			Vector2 min = {};
+			Vector2 max = {};
+			int parent = null_node; //Next free node when the node is on the free list
+			int child1 = null_node;
+			int child2 = null_node;
+			int id = InvalidId; //Item of a leaf
+			int height = 0; //0 for leaves, -1 when free
+
+			bool IsLeaf() const { return child1 == null_node; }
+		};
+
+		struct Item
+		{
+			Vector2 center = {};
+			float radius = 0.f;
+			int leaf = null_node;
+		};
+
+		float m_Margin;
+		int m_Root = null_node;
+		int m_FreeList = null_node;
+		std::vector<Node> m_Nodes;
+		std::vector<Item> m_Items; //Indexed by id
+
+		int AllocateNode();
+		void FreeNode(int node);
+		void InsertLeaf(int leaf);
+		void RemoveLeaf(int leaf);
+		int Balance(int node);
+		void RefitAncestors(int node);
+	};
+}
@@ -341,6 +341,20 @@ const std::vector<Elite::Triangle*>& Elite::Polygon::Triangulate()
 	return m_vpTriangles;
 }
 
+void Elite::Polygon::SetTriangulation(const std::vector<Triangle*>& triangles, const std::vector<Line*>& lines)
+{
+	//Release the current triangulation first
+	for (auto t : m_vpTriangles)
+		SAFE_DELETE(t);
+	for (auto l : m_vpLines)
+		SAFE_DELETE(l);
+
+	//Triangles and lines are expected to be consistent already (line indices stored in the triangle meta data)
+	m_vpTriangles = triangles;
+	m_vpLines = lines;
+	m_isTriangulated = true;
+}
+
 void Elite::Polygon::OrientateWithChildren(Winding winding)
 {
 	//Based on the orientation given rewind these points if necessary, change winding of children
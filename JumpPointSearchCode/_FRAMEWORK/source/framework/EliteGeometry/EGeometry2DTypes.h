@@ -41,6 +41,19 @@ namespace Elite
 	};
 #pragma endregion //Line
 
+#pragma region Circle
+	struct Circle final
+	{
+		//=== Datamembers ===
+		Vector2 center = {};
+		float radius = 0.f;
+
+		//=== Constructors ===
+		Circle() = default;
+		Circle(const Vector2& _center, float _radius) : center(_center), radius(_radius) {}
+	};
+#pragma endregion //Circle
+
 #pragma region Triangle
 	//Triangle MetaData is used for optimized intersecting and shared edges calculations
 	struct TriangleMetaData final
@@ -125,6 +138,7 @@ namespace Elite
 
 		//Triangulation functions
 		const std::vector<Triangle*>& Triangulate();
+		void SetTriangulation(const std::vector<Triangle*>& triangles, const std::vector<Line*>& lines); //Takes ownership, used to restore baked data
 		void OrientateWithChildren(Winding winding);
 		void ExpandShape(float amount);
 
@@ -0,0 +1,265 @@
+#include "stdafx.h"
+#include "ELooseQuadtree.h"
+
+#include <array>
+
+using namespace Elite;
+
+Elite::LooseQuadtree::LooseQuadtree(const Vector2& worldMin, const Vector2& worldMax, int depth)
+	: m_WorldMin{ worldMin }
+	, m_WorldSize{ max(max(worldMax.x - worldMin.x, worldMax.y - worldMin.y), FLT_EPSILON) }
+	, m_Depth{ depth < 0 ? 0 : (depth > MaxDepth ? MaxDepth : depth) }
+{
+	//Level d starts after the (4^d - 1) / 3 nodes of the levels above it
+	m_LevelOffsets.resize(m_Depth + 2);
+	for (int d = 0; d <= m_Depth + 1; ++d)
+		m_LevelOffsets[d] = ((1 << (2 * d)) - 1) / 3;
+
+	m_Nodes.resize(m_LevelOffsets[m_Depth + 1]);
+	for (int d = 0; d <= m_Depth; ++d)
+	{
+		const int nrOfColumns = 1 << d;
+		for (int row = 0; row < nrOfColumns; ++row)
+		{
+			for (int col = 0; col < nrOfColumns; ++col)
+			{
+				Node& node = m_Nodes[m_LevelOffsets[d] + row * nrOfColumns + col];
+				node.depth = d;
+				node.column = col;
+				node.row = row;
+			}
+		}
+	}
+}
+
+void Elite::LooseQuadtree::Clear()
+{
+	for (Node& node : m_Nodes)
+	{
+		node.items.clear();
+		node.nrOfItemsInSubtree = 0;
+	}
+	m_Items.clear();
+}
+
+void Elite::LooseQuadtree::Insert(int id, const Vector2& center, float radius)
+{
+	if (id < 0)
+		return;
+	if (Contains(id))
+	{
+		Move(id, center, radius);
+		return;
+	}
+
+	if (id >= int(m_Items.size()))
+		m_Items.resize(id + 1);
+
+	Item& item = m_Items[id];
+	item.center = center;
+	item.radius = radius;
+	AddToNode(id, FindNode(center, radius));
+}
+
+void Elite::LooseQuadtree::Move(int id, const Vector2& center, float radius)
+{
+	if (!Contains(id))
+	{
+		Insert(id, center, radius);
+		return;
+	}
+
+	Item& item = m_Items[id];
+	item.center = center;
+	item.radius = radius;
+
+	const int node = FindNode(center, radius);
+	if (node == item.node)
+		return;
+
+	RemoveFromNode(id);
+	AddToNode(id, node);
+}
+
+void Elite::LooseQuadtree::Remove(int id)
+{
+	if (!Contains(id))
+		return;
+
+	RemoveFromNode(id);
+}
+
+template<typename T_NodeTest, typename T_ItemVisit>
+void Elite::LooseQuadtree::Traverse(const T_NodeTest& isNodeOverlapping, const T_ItemVisit& visitItem) const
+{
+	std::array<int, 4 * (MaxDepth + 1)> stack;
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const int nodeIdx = stack[--stackSize];
+		const Node& node = m_Nodes[nodeIdx];
+		for (int id : node.items)
+			visitItem(id, m_Items[id]);
+
+		if (node.depth == m_Depth)
+			continue;
+
+		const int childDepth = node.depth + 1;
+		const int nrOfColumns = 1 << childDepth;
+		for (int i = 0; i < 4; ++i)
+		{
+			const int child = m_LevelOffsets[childDepth] + (node.row * 2 + i / 2) * nrOfColumns + node.column * 2 + i % 2;
+			if (m_Nodes[child].nrOfItemsInSubtree == 0)
+				continue;
+
+			Vector2 looseMin, looseMax;
+			GetLooseBounds(child, looseMin, looseMax);
+			if (isNodeOverlapping(looseMin, looseMax))
+				stack[stackSize++] = child;
+		}
+	}
+}
+
+void Elite::LooseQuadtree::QueryRange(const Vector2& min, const Vector2& max, std::vector<int>& ids) const
+{
+	Traverse(
+		[&min, &max](const Vector2& looseMin, const Vector2& looseMax) { return AreBoxesOverlapping(min, max, looseMin, looseMax); },
+		[&min, &max, &ids](int id, const Item& item)
+		{
+			const Vector2 extents{ item.radius, item.radius };
+			if (AreBoxesOverlapping(min, max, item.center - extents, item.center + extents))
+				ids.push_back(id);
+		});
+}
+
+void Elite::LooseQuadtree::QueryRadius(const Vector2& center, float radius, std::vector<int>& ids) const
+{
+	const float radiusSquared = radius * radius;
+	Traverse(
+		[&center, radiusSquared](const Vector2& looseMin, const Vector2& looseMax) { return DistanceSquaredToBox(center, looseMin, looseMax) <= radiusSquared; },
+		[&center, radius, &ids](int id, const Item& item)
+		{
+			const float reach = radius + item.radius;
+			if (DistanceSquared(center, item.center) <= reach * reach)
+				ids.push_back(id);
+		});
+}
+
+int Elite::LooseQuadtree::QueryNearest(const Vector2& pos, float maxDistance, const Filter& filter) const
+{
+	int nearest = InvalidId;
+	float nearestDistanceSquared = maxDistance * maxDistance;
+
+	//Depth first, nearest child first, so the search radius shrinks quickly
+	std::array<int, 4 * (MaxDepth + 1)> stack;
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const Node& node = m_Nodes[stack[--stackSize]];
+
+		//The root holds what doesn't fit anywhere else (e.g. items outside of the world), so it isn't pruned
+		Vector2 looseMin, looseMax;
+		if (node.depth > 0)
+		{
+			GetLooseBounds(int(&node - m_Nodes.data()), looseMin, looseMax);
+			if (DistanceSquaredToBox(pos, looseMin, looseMax) >= nearestDistanceSquared)
+				continue;
+		}
+
+		for (int id : node.items)
+		{
+			const float distanceSquared = DistanceSquared(pos, m_Items[id].center);
+			if (distanceSquared < nearestDistanceSquared && (!filter || filter(id)))
+			{
+				nearest = id;
+				nearestDistanceSquared = distanceSquared;
+			}
+		}
+
+		if (node.depth == m_Depth)
+			continue;
+
+		//Push the children farthest first
+		std::array<std::pair<float, int>, 4> children;
+		int nrOfChildren = 0;
+		const int childDepth = node.depth + 1;
+		const int nrOfColumns = 1 << childDepth;
+		for (int i = 0; i < 4; ++i)
+		{
+			const int child = m_LevelOffsets[childDepth] + (node.row * 2 + i / 2) * nrOfColumns + node.column * 2 + i % 2;
+			if (m_Nodes[child].nrOfItemsInSubtree == 0)
+				continue;
+
+			GetLooseBounds(child, looseMin, looseMax);
+			children[nrOfChildren++] = { DistanceSquaredToBox(pos, looseMin, looseMax), child };
+		}
+		std::sort(children.begin(), children.begin() + nrOfChildren, std::greater<std::pair<float, int>>());
+		for (int i = 0; i < nrOfChildren; ++i)
+			stack[stackSize++] = children[i].second;
+	}
+
+	return nearest;
+}
+
+int Elite::LooseQuadtree::FindNode(const Vector2& center, float radius) const
+{
+	const Vector2 local = center - m_WorldMin;
+	if (local.x < 0.f || local.y < 0.f || local.x > m_WorldSize || local.y > m_WorldSize)
+		return 0;
+
+	//Deepest level where the item still fits in the loose bounds (radius <= half a cell)
+	int depth = 0;
+	float cellSize = m_WorldSize;
+	while (depth < m_Depth && radius <= cellSize * 0.25f)
+	{
+		cellSize *= 0.5f;
+		++depth;
+	}
+
+	const int nrOfColumns = 1 << depth;
+	const int col = min(int(local.x / cellSize), nrOfColumns - 1);
+	const int row = min(int(local.y / cellSize), nrOfColumns - 1);
+	return m_LevelOffsets[depth] + row * nrOfColumns + col;
+}
+
+void Elite::LooseQuadtree::AddToNode(int id, int node)
+{
+	Item& item = m_Items[id];
+	item.node = node;
+	item.slot = int(m_Nodes[node].items.size());
+	m_Nodes[node].items.push_back(id);
+
+	//Count the item in the node and all its ancestors
+	int depth = m_Nodes[node].depth, col = m_Nodes[node].column, row = m_Nodes[node].row;
+	for (; depth >= 0; --depth, col /= 2, row /= 2)
+		++m_Nodes[m_LevelOffsets[depth] + row * (1 << depth) + col].nrOfItemsInSubtree;
+}
+
+void Elite::LooseQuadtree::RemoveFromNode(int id)
+{
+	Item& item = m_Items[id];
+	Node& node = m_Nodes[item.node];
+
+	//Swap with the last item of the node
+	const int lastId = node.items.back();
+	node.items[item.slot] = lastId;
+	m_Items[lastId].slot = item.slot;
+	node.items.pop_back();
+
+	int depth = node.depth, col = node.column, row = node.row;
+	for (; depth >= 0; --depth, col /= 2, row /= 2)
+		--m_Nodes[m_LevelOffsets[depth] + row * (1 << depth) + col].nrOfItemsInSubtree;
+
+	item.node = invalid_node;
+}
+
+void Elite::LooseQuadtree::GetLooseBounds(int node, Vector2& min, Vector2& max) const
+{
+	const Node& n = m_Nodes[node];
+	const float cellSize = m_WorldSize / (1 << n.depth);
+	const Vector2 halfCell{ cellSize * 0.5f, cellSize * 0.5f };
+	min = m_WorldMin + Vector2{ n.column * cellSize, n.row * cellSize } - halfCell;
+	max = min + Vector2{ cellSize * 2.f, cellSize * 2.f };
+}
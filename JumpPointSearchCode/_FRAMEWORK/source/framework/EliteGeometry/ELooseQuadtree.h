@@ -0,0 +1,67 @@
+#pragma once
+// ELooseQuadtree.h: loose quadtree over fixed (square) world bounds.
+// The nodes are stored per level in one flat array (level d is a 2^d x 2^d grid). An item goes to the deepest level
+// whose cells are at least twice its diameter, in the cell of its center: as a node's loose bounds are its cell grown by
+// half a cell on every side, the item always fits and moving it is just changing cells, the tree never has to split or
+// merge. Nodes keep the number of items in their subtree, so queries skip empty branches.
+#include "ESpatialPartition.h"
+
+namespace Elite
+{
+	class LooseQuadtree final : public ISpatialPartition
+	{
+	public:
+		static constexpr int MaxDepth = 8; //Limits the node count (and the query stack)
+
+		LooseQuadtree(const Vector2& worldMin, const Vector2& worldMax, int depth = 6);
+		~LooseQuadtree() = default;
+
+		SpatialPartitionType GetType() const override { return SpatialPartitionType::LooseQuadtree; }
+
+		void Clear() override;
+		void Insert(int id, const Vector2& center, float radius) override;
+		void Move(int id, const Vector2& center, float radius) override;
+		void Remove(int id) override;
+		bool Contains(int id) const override { return id >= 0 && id < int(m_Items.size()) && m_Items[id].node != invalid_node; }
+
+		void QueryRange(const Vector2& min, const Vector2& max, std::vector<int>& ids) const override;
+		void QueryRadius(const Vector2& center, float radius, std::vector<int>& ids) const override;
+		int QueryNearest(const Vector2& pos, float maxDistance, const Filter& filter = nullptr) const override;
+
+	private:
+		static constexpr int invalid_node = -1;
+
+		struct Item
+		{
+			Vector2 center = {};
+			float radius = 0.f;
+			int node = invalid_node;
+			int slot = 0; //Index in the items of its node
+		};
+
+		struct Node
+		{
+			std::vector<int> items;
+			int nrOfItemsInSubtree = 0;
+			int depth = 0;
+			int column = 0;
+			int row = 0;
+		};
+
+		Vector2 m_WorldMin;
+		float m_WorldSize; //Side of the root cell
+		int m_Depth;
+		std::vector<int> m_LevelOffsets;
+		std::vector<Node> m_Nodes;
+		std::vector<Item> m_Items; //Indexed by id
+
+		int FindNode(const Vector2& center, float radius) const;
+		void AddToNode(int id, int node);
+		void RemoveFromNode(int id);
+		void GetLooseBounds(int node, Vector2& min, Vector2& max) const;
+
+		//Visits the items of every node for which isNodeOverlapping(looseMin, looseMax) holds (the root always does)
+		template<typename T_NodeTest, typename T_ItemVisit>
+		void Traverse(const T_NodeTest& isNodeOverlapping, const T_ItemVisit& visitItem) const;
+	};
+}
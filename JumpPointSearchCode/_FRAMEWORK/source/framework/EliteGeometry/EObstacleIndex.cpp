@@ -0,0 +1,285 @@
+#include "stdafx.h"
+#include "EObstacleIndex.h"
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define OBSTACLE_INDEX_SSE2
+#endif
+
+using namespace Elite;
+
+namespace
+{
+	const float no_hit = FLT_MAX;
+
+	//Scratch of a query, per thread so the feelers can be queried in parallel
+	struct QueryScratch
+	{
+		std::vector<int> candidates;
+		std::vector<int> circles;
+		std::vector<int> segments;
+	};
+
+	QueryScratch& GetQueryScratch()
+	{
+		static thread_local QueryScratch scratch{};
+		return scratch;
+	}
+
+	//Distance along the ray to the first point within radius of the center, 0 when it starts inside, no_hit when it misses
+	float RayCircle(const Vector2& origin, const Vector2& direction, float length, const Vector2& center, float radius)
+	{
+		const Vector2 toOrigin{ origin - center };
+		const float b = toOrigin.Dot(direction);
+		const float c = toOrigin.Dot(toOrigin) - radius * radius;
+		if (c <= 0.f)
+			return 0.f;
+
+		const float discriminant = b * b - c;
+		if (b >= 0.f || discriminant < 0.f)
+			return no_hit;
+
+		const float distance = -b - sqrtf(discriminant);
+		return distance <= length ? distance : no_hit;
+	}
+
+#if defined(OBSTACLE_INDEX_SSE2)
+	__m128 Gather(const float* pData, const int* pIndices)
+	{
+		return _mm_set_ps(pData[pIndices[3]], pData[pIndices[2]], pData[pIndices[1]], pData[pIndices[0]]);
+	}
+#endif
+}
+
+void ObstacleIndex::Clear()
+{
+	m_CirclesX.clear();
+	m_CirclesY.clear();
+	m_CirclesRadius.clear();
+	m_SegmentsX1.clear();
+	m_SegmentsY1.clear();
+	m_SegmentsX2.clear();
+	m_SegmentsY2.clear();
+	m_Tree.Clear();
+}
+
+void ObstacleIndex::AddCircle(const Circle& circle)
+{
+	//The tree stores bounding circles, the narrow phase tests the real shapes
+	m_Tree.Insert(GetCircleId(GetNrOfCircles()), circle.center, circle.radius);
+	m_CirclesX.push_back(circle.center.x);
+	m_CirclesY.push_back(circle.center.y);
+	m_CirclesRadius.push_back(circle.radius);
+}
+
+void ObstacleIndex::AddCircles(const std::vector<Circle>& circles)
+{
+	for (const Circle& circle : circles)
+		AddCircle(circle);
+}
+
+void ObstacleIndex::AddSegment(const Vector2& p1, const Vector2& p2)
+{
+	m_Tree.Insert(GetSegmentId(GetNrOfSegments()), (p1 + p2) * 0.5f, Distance(p1, p2) * 0.5f);
+	m_SegmentsX1.push_back(p1.x);
+	m_SegmentsY1.push_back(p1.y);
+	m_SegmentsX2.push_back(p2.x);
+	m_SegmentsY2.push_back(p2.y);
+}
+
+void ObstacleIndex::AddPolygons(const std::vector<Polygon>& polygons)
+{
+	for (const Polygon& polygon : polygons)
+	{
+		const std::list<Vector2>& points = polygon.GetPoints();
+		if (points.size() < 2)
+			continue;
+
+		Vector2 previous = points.back();
+		for (const Vector2& point : points)
+		{
+			AddSegment(previous, point);
+			previous = point;
+		}
+	}
+}
+
+void ObstacleIndex::QueryFeelers(const Feeler* pFeelers, int count, FeelerHit* pHits) const
+{
+	QueryScratch& scratch = GetQueryScratch();
+	for (int feelerIdx = 0; feelerIdx < count; ++feelerIdx)
+	{
+		const Feeler& feeler = pFeelers[feelerIdx];
+		FeelerHit& hit = pHits[feelerIdx];
+		hit = FeelerHit{};
+
+		//Broad phase: the box around the swept feeler
+		const Vector2 end{ feeler.origin + feeler.direction * feeler.length };
+		const Vector2 extents{ feeler.radius, feeler.radius };
+		const Vector2 boxMin{ min(feeler.origin.x, end.x), min(feeler.origin.y, end.y) };
+		const Vector2 boxMax{ max(feeler.origin.x, end.x), max(feeler.origin.y, end.y) };
+		scratch.candidates.clear();
+		m_Tree.QueryRange(boxMin - extents, boxMax + extents, scratch.candidates);
+		if (scratch.candidates.empty())
+			continue;
+
+		scratch.circles.clear();
+		scratch.segments.clear();
+		for (int id : scratch.candidates)
+		{
+			if (id % 2 == 0)
+				scratch.circles.push_back(id / 2);
+			else
+				scratch.segments.push_back(id / 2);
+		}
+
+		float nearestDistance = no_hit;
+		Vector2 nearestNormal{};
+
+		//Circles grown by the radius of the feeler
+		int nearestCircle = -1;
+		int i = 0;
+		const int nrOfCandidateCircles = int(scratch.circles.size());
+#if defined(OBSTACLE_INDEX_SSE2)
+		const __m128 originX = _mm_set1_ps(feeler.origin.x);
+		const __m128 originY = _mm_set1_ps(feeler.origin.y);
+		const __m128 directionX = _mm_set1_ps(feeler.direction.x);
+		const __m128 directionY = _mm_set1_ps(feeler.direction.y);
+		const __m128 length = _mm_set1_ps(feeler.length);
+		const __m128 feelerRadius = _mm_set1_ps(feeler.radius);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 noHit = _mm_set1_ps(no_hit);
+		for (; i + 4 <= nrOfCandidateCircles; i += 4)
+		{
+			const int* pIds = scratch.circles.data() + i;
+			const __m128 toOriginX = _mm_sub_ps(originX, Gather(m_CirclesX.data(), pIds));
+			const __m128 toOriginY = _mm_sub_ps(originY, Gather(m_CirclesY.data(), pIds));
+			const __m128 radius = _mm_add_ps(Gather(m_CirclesRadius.data(), pIds), feelerRadius);
+
+			const __m128 b = _mm_add_ps(_mm_mul_ps(toOriginX, directionX), _mm_mul_ps(toOriginY, directionY));
+			const __m128 c = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(toOriginX, toOriginX), _mm_mul_ps(toOriginY, toOriginY)), _mm_mul_ps(radius, radius));
+			const __m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), c);
+			const __m128 distance = _mm_sub_ps(_mm_sub_ps(zero, b), _mm_sqrt_ps(_mm_max_ps(discriminant, zero)));
+
+			//Same cases as RayCircle: inside, or moving towards the circle and reaching it within the length
+			const __m128 isInside = _mm_cmple_ps(c, zero);
+			const __m128 isHit = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(discriminant, zero), _mm_cmplt_ps(b, zero)), _mm_cmple_ps(distance, length));
+			__m128 result = _mm_or_ps(_mm_and_ps(isHit, distance), _mm_andnot_ps(isHit, noHit));
+			result = _mm_andnot_ps(isInside, result); //0 when inside
+
+			float distances[4];
+			_mm_storeu_ps(distances, result);
+			for (int j = 0; j < 4; ++j)
+			{
+				if (distances[j] < nearestDistance)
+				{
+					nearestDistance = distances[j];
+					nearestCircle = pIds[j];
+				}
+			}
+		}
+#endif
+		for (; i < nrOfCandidateCircles; ++i)
+		{
+			const int id = scratch.circles[i];
+			const float distance = RayCircle(feeler.origin, feeler.direction, feeler.length, { m_CirclesX[id], m_CirclesY[id] }, m_CirclesRadius[id] + feeler.radius);
+			if (distance < nearestDistance)
+			{
+				nearestDistance = distance;
+				nearestCircle = id;
+			}
+		}
+
+		if (nearestCircle >= 0)
+		{
+			const Vector2 center{ m_CirclesX[nearestCircle], m_CirclesY[nearestCircle] };
+			nearestNormal = feeler.origin + feeler.direction * nearestDistance - center;
+		}
+
+		//Segments as capsules with the radius of the feeler: the side facing the feeler and the two end caps
+		for (int id : scratch.segments)
+		{
+			const Vector2 p1{ m_SegmentsX1[id], m_SegmentsY1[id] };
+			const Vector2 p2{ m_SegmentsX2[id], m_SegmentsY2[id] };
+			const Vector2 edge{ p2 - p1 };
+			const float edgeLength = edge.Magnitude();
+			if (edgeLength <= 0.f)
+				continue;
+
+			Vector2 normal{ -edge.y / edgeLength, edge.x / edgeLength };
+			if ((feeler.origin - p1).Dot(normal) < 0.f)
+				normal = -normal;
+
+			//Already touching the side
+			const float along = (feeler.origin - p1).Dot(edge) / (edgeLength * edgeLength);
+			if (along >= 0.f && along <= 1.f && (feeler.origin - p1).Dot(normal) <= feeler.radius)
+			{
+				nearestDistance = 0.f;
+				nearestNormal = normal;
+				break;
+			}
+
+			const float denominator = Cross(feeler.direction, edge);
+			if (denominator != 0.f)
+			{
+				const Vector2 toSide{ p1 + normal * feeler.radius - feeler.origin };
+				const float distance = Cross(toSide, edge) / denominator;
+				const float s = Cross(toSide, feeler.direction) / denominator;
+				if (distance >= 0.f && distance <= feeler.length && s >= 0.f && s <= 1.f && distance < nearestDistance)
+				{
+					nearestDistance = distance;
+					nearestNormal = normal;
+				}
+			}
+
+			for (const Vector2& cap : { p1, p2 })
+			{
+				const float distance = RayCircle(feeler.origin, feeler.direction, feeler.length, cap, feeler.radius);
+				if (distance < nearestDistance)
+				{
+					nearestDistance = distance;
+					nearestNormal = feeler.origin + feeler.direction * distance - cap;
+				}
+			}
+		}
+
+		if (nearestDistance == no_hit)
+			continue;
+
+		hit.isHit = true;
+		hit.distance = nearestDistance;
+		hit.point = feeler.origin + feeler.direction * nearestDistance;
+		hit.normal = nearestNormal.MagnitudeSquared() > 0.f ? nearestNormal.GetNormalized() : -feeler.direction;
+		hit.avoidance = hit.normal * (feeler.length > 0.f ? 1.f - nearestDistance / feeler.length : 1.f);
+	}
+}
+
+bool ObstacleIndex::IsOverlapping(const Vector2& center, float radius) const
+{
+	QueryScratch& scratch = GetQueryScratch();
+	scratch.candidates.clear();
+	m_Tree.QueryRadius(center, radius, scratch.candidates);
+
+	//Circles are exact in the tree, segments only by their bounding circle
+	for (int id : scratch.candidates)
+	{
+		if (id % 2 == 0)
+			return true;
+
+		const int segment = id / 2;
+		const Vector2 p1{ m_SegmentsX1[segment], m_SegmentsY1[segment] };
+		const Vector2 p2{ m_SegmentsX2[segment], m_SegmentsY2[segment] };
+		if (DistanceSquared(ProjectOnLineSegment(p1, p2, center), center) <= radius * radius)
+			return true;
+	}
+	return false;
+}
+
+void ObstacleIndex::RenderDebug() const
+{
+	const Color color{ 1.f, 0.5f, 0.f };
+	for (int i = 0; i < GetNrOfCircles(); ++i)
+		DEBUGRENDERER2D->DrawCircle({ m_CirclesX[i], m_CirclesY[i] }, m_CirclesRadius[i], color, 0.4f);
+	for (int i = 0; i < GetNrOfSegments(); ++i)
+		DEBUGRENDERER2D->DrawSegment({ m_SegmentsX1[i], m_SegmentsY1[i] }, { m_SegmentsX2[i], m_SegmentsY2[i] }, color, 0.4f);
+}
@@ -0,0 +1,68 @@
+#pragma once
+// EObstacleIndex.h: static obstacles (circles and wall segments) in an AABB tree, for obstacle avoidance.
+// Shapes are put in the tree as they're added (e.g. the static shapes of the physics world at the start and every
+// obstacle placed later), then queried with "feelers": the lookahead
+// rays of many agents at once. A feeler is swept by the radius of its agent and stops at the first obstacle it touches,
+// the hit gives the normal to steer along and an avoidance that grows as the obstacle gets closer.
+#include <vector>
+#include "EGeometry2DTypes.h"
+#include "EAABBTree.h"
+
+namespace Elite
+{
+	class ObstacleIndex final
+	{
+	public:
+		struct Feeler
+		{
+			Vector2 origin = {};
+			Vector2 direction = {}; //Normalized
+			float length = 0.f;
+			float radius = 0.f; //Radius of the agent
+		};
+
+		struct FeelerHit
+		{
+			bool isHit = false;
+			float distance = 0.f; //Along the feeler, to the position of the agent when it touches the obstacle
+			Vector2 point = {}; //Position of the agent when it touches the obstacle
+			Vector2 normal = {}; //Away from the obstacle
+			Vector2 avoidance = {}; //normal * (1 - distance / length), 0 when there is no hit
+		};
+
+		ObstacleIndex() = default;
+
+		void Clear();
+		void AddCircle(const Circle& circle);
+		void AddCircles(const std::vector<Circle>& circles);
+		void AddSegment(const Vector2& p1, const Vector2& p2);
+		void AddPolygons(const std::vector<Polygon>& polygons); //The edges of the outer shape of every polygon
+
+		int GetNrOfCircles() const { return int(m_CirclesX.size()); }
+		int GetNrOfSegments() const { return int(m_SegmentsX1.size()); }
+
+		//First hit of every feeler, pHits has count elements
+		void QueryFeelers(const Feeler* pFeelers, int count, FeelerHit* pHits) const;
+		FeelerHit QueryFeeler(const Feeler& feeler) const { FeelerHit hit{}; QueryFeelers(&feeler, 1, &hit); return hit; }
+		//True when the circle overlaps (or touches) any of the shapes
+		bool IsOverlapping(const Vector2& center, float radius) const;
+
+		void RenderDebug() const;
+
+	private:
+		//SoA, so the narrow phase tests 4 circles at a time
+		std::vector<float> m_CirclesX;
+		std::vector<float> m_CirclesY;
+		std::vector<float> m_CirclesRadius;
+		std::vector<float> m_SegmentsX1;
+		std::vector<float> m_SegmentsY1;
+		std::vector<float> m_SegmentsX2;
+		std::vector<float> m_SegmentsY2;
+
+		//Circle i is id 2 * i, segment i is id 2 * i + 1, so adding either doesn't change the ids of the others
+		AABBTree m_Tree{ 0.f };
+
+		static int GetCircleId(int circle) { return circle * 2; }
+		static int GetSegmentId(int segment) { return segment * 2 + 1; }
+	};
+}
@@ -0,0 +1,19 @@
+#include "stdafx.h"
+#include "ESpatialPartition.h"
+
+#include "ELooseQuadtree.h"
+#include "EAABBTree.h"
+
+Elite::ISpatialPartition* Elite::CreateSpatialPartition(SpatialPartitionType type, const Vector2& worldMin, const Vector2& worldMax)
+{
+	switch (type)
+	{
+	case SpatialPartitionType::LooseQuadtree:
+		return new LooseQuadtree(worldMin, worldMax);
+	case SpatialPartitionType::AABBTree:
+		return new AABBTree();
+	default:
+		std::cout << "CreateSpatialPartition: unknown partition type\n";
+		return nullptr;
+	}
+}
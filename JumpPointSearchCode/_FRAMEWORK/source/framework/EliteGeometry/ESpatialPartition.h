@@ -0,0 +1,63 @@
+#pragma once
+// ESpatialPartition.h: interface shared by the spatial partitions (loose quadtree, dynamic AABB tree), so every app can
+// pick the one that suits its distribution of entities and use the same range, radius and nearest queries.
+// Items are circles identified by an id chosen by the user (e.g. the index of the entity in its array). The partitions
+// store their item data indexed by id, so ids should be small and dense.
+#include <vector>
+#include <functional>
+
+namespace Elite
+{
+	enum class SpatialPartitionType
+	{
+		LooseQuadtree, //Fixed world bounds, cheap moves, good for many similar sized items spread over the world
+		AABBTree //Unbounded, adapts to clusters and very different item sizes
+	};
+
+	class ISpatialPartition
+	{
+	public:
+		static constexpr int InvalidId = -1;
+		using Filter = std::function<bool(int id)>;
+
+		ISpatialPartition() = default;
+		virtual ~ISpatialPartition() = default;
+
+		virtual SpatialPartitionType GetType() const = 0;
+
+		virtual void Clear() = 0;
+		virtual void Insert(int id, const Vector2& center, float radius) = 0;
+		virtual void Move(int id, const Vector2& center, float radius) = 0;
+		virtual void Remove(int id) = 0;
+		virtual bool Contains(int id) const = 0;
+
+		//Queries are const and don't use shared scratch, so several threads can query at once. They append the found ids.
+		//Items whose bounding box overlaps the box [min, max]
+		virtual void QueryRange(const Vector2& min, const Vector2& max, std::vector<int>& ids) const = 0;
+		//Items whose circle overlaps the query circle (items with a radius of 0 are points)
+		virtual void QueryRadius(const Vector2& center, float radius, std::vector<int>& ids) const = 0;
+		//Item with the closest center within maxDistance that passes the filter (if any), InvalidId if there is none
+		virtual int QueryNearest(const Vector2& pos, float maxDistance, const Filter& filter = nullptr) const = 0;
+
+	private:
+		ISpatialPartition(const ISpatialPartition& other) = delete;
+		ISpatialPartition& operator=(const ISpatialPartition& other) = delete;
+	};
+
+	//Creates a partition of the given type, the world bounds are only used by the loose quadtree (items outside of them
+	//are still found, just slower)
+	ISpatialPartition* CreateSpatialPartition(SpatialPartitionType type, const Vector2& worldMin, const Vector2& worldMax);
+
+	//Squared distance from a point to a box, 0 inside
+	inline float DistanceSquaredToBox(const Vector2& pos, const Vector2& min, const Vector2& max)
+	{
+		const float deltaX = pos.x < min.x ? min.x - pos.x : (pos.x > max.x ? pos.x - max.x : 0.f);
+		const float deltaY = pos.y < min.y ? min.y - pos.y : (pos.y > max.y ? pos.y - max.y : 0.f);
+		return deltaX * deltaX + deltaY * deltaY;
+	}
+
+	inline bool AreBoxesOverlapping(const Vector2& min1, const Vector2& max1, const Vector2& min2, const Vector2& max2)
+	{
+		return min1.x <= max2.x && max1.x >= min2.x && min1.y <= max2.y && max1.y >= min2.y;
+	}
+}
@@ -0,0 +1,106 @@
+#include "stdafx.h"
+#include "EMappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Elite;
+
+bool Elite::MappedFile::Open(const std::string& path)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		std::cout << "WARNING: MappedFile could not open " << path << std::endl;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(hFile);
+		return false;
+	}
+
+	HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (hMapping == nullptr)
+	{
+		std::cout << "WARNING: MappedFile could not map " << path << std::endl;
+		CloseHandle(hFile);
+		return false;
+	}
+
+	const void* pView = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (pView == nullptr)
+	{
+		CloseHandle(hMapping);
+		CloseHandle(hFile);
+		return false;
+	}
+
+	m_hFile = hFile;
+	m_hMapping = hMapping;
+	m_pData = pView;
+	m_Size = static_cast<size_t>(fileSize.QuadPart);
+#else
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		std::cout << "WARNING: MappedFile could not open " << path << std::endl;
+		return false;
+	}
+
+	struct stat fileInfo {};
+	if (fstat(fd, &fileInfo) != 0 || fileInfo.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void* pView = mmap(nullptr, static_cast<size_t>(fileInfo.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	if (pView == MAP_FAILED)
+	{
+		std::cout << "WARNING: MappedFile could not map " << path << std::endl;
+		close(fd);
+		return false;
+	}
+
+	m_FileDescriptor = fd;
+	m_pData = pView;
+	m_Size = static_cast<size_t>(fileInfo.st_size);
+#endif
+	return true;
+}
+
+void Elite::MappedFile::Close()
+{
+#ifdef _WIN32
+	if (m_pData)
+		UnmapViewOfFile(m_pData);
+	if (m_hMapping)
+		CloseHandle(static_cast<HANDLE>(m_hMapping));
+	if (m_hFile)
+		CloseHandle(static_cast<HANDLE>(m_hFile));
+	m_hMapping = nullptr;
+	m_hFile = nullptr;
+#else
+	if (m_pData)
+		munmap(const_cast<void*>(m_pData), m_Size);
+	if (m_FileDescriptor >= 0)
+		close(m_FileDescriptor);
+	m_FileDescriptor = -1;
+#endif
+	m_pData = nullptr;
+	m_Size = 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+// EMappedFile.h: read-only memory mapped file. The mapped view stays valid for the lifetime of the object,
+// so data that is laid out to be used in place (e.g. baked graph blobs) never has to be copied or parsed.
+
+namespace Elite
+{
+	class MappedFile final
+	{
+	public:
+		MappedFile() = default;
+		explicit MappedFile(const std::string& path) { Open(path); }
+		~MappedFile() { Close(); }
+
+		bool Open(const std::string& path);
+		void Close();
+
+		bool IsOpen() const { return m_pData != nullptr; }
+		const void* GetData() const { return m_pData; }
+		size_t GetSize() const { return m_Size; }
+
+	private:
+		//--- Datamembers ---
+#ifdef _WIN32
+		void* m_hFile = nullptr;
+		void* m_hMapping = nullptr;
+#else
+		int m_FileDescriptor = -1;
+#endif
+		const void* m_pData = nullptr;
+		size_t m_Size = 0;
+
+		MappedFile(const MappedFile& other) = delete;
+		MappedFile& operator=(const MappedFile& other) = delete;
+		MappedFile(MappedFile&& other) = delete;
+		MappedFile& operator=(MappedFile&& other) = delete;
+	};
+}
@@ -0,0 +1,117 @@
+#include "stdafx.h"
+#include "EWorkerPool.h"
+
+using namespace Elite;
+
+Elite::WorkerPool::WorkerPool(int nrOfThreads)
+{
+	if (nrOfThreads < 0)
+		nrOfThreads = max(int(std::thread::hardware_concurrency()) - 1, 0);
+
+	m_Threads.reserve(nrOfThreads);
+	for (int i = 0; i < nrOfThreads; ++i)
+		m_Threads.emplace_back(&WorkerPool::WorkerLoop, this);
+}
+
+Elite::WorkerPool::~WorkerPool()
+{
+	Wait();
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_IsShuttingDown = true;
+	}
+	m_WorkAvailable.notify_all();
+	for (auto& thread : m_Threads)
+		thread.join();
+}
+
+Elite::WorkerPool::JobId Elite::WorkerPool::Dispatch(int count, const RangeJob& job)
+{
+	Wait();
+	if (count <= 0)
+		return m_Generation; //Done like the job before it
+
+	if (m_Threads.empty())
+	{
+		job(0, count);
+		return m_Generation;
+	}
+
+	JobId jobId = 0;
+	{
+		//A few chunks per thread so uneven chunks balance out
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Job = job;
+		m_Count = count;
+		m_NrOfChunks = min(count, (GetNrOfThreads() + 1) * 4);
+		m_ChunkSize = (count + m_NrOfChunks - 1) / m_NrOfChunks;
+		m_NrOfChunks = (count + m_ChunkSize - 1) / m_ChunkSize;
+		m_NextChunk = 0;
+		m_NrOfCompletedChunks = 0;
+		jobId = ++m_Generation;
+	}
+	m_WorkAvailable.notify_all();
+	return jobId;
+}
+
+bool Elite::WorkerPool::IsDone(JobId job) const
+{
+	//The pool runs one job at a time, so a job that isn't the current one is done
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return job != m_Generation || m_NrOfCompletedChunks == m_NrOfChunks;
+}
+
+void Elite::WorkerPool::Wait()
+{
+	//Help instead of idling, then wait for the chunks other threads are still running
+	while (RunChunk()) {}
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_WorkDone.wait(lock, [this]() { return m_NrOfCompletedChunks == m_NrOfChunks; });
+}
+
+void Elite::WorkerPool::Wait(JobId job)
+{
+	while (!IsDone(job) && RunChunk()) {}
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_WorkDone.wait(lock, [this, job]() { return job != m_Generation || m_NrOfCompletedChunks == m_NrOfChunks; });
+}
+
+void Elite::WorkerPool::WorkerLoop()
+{
+	unsigned int generation = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_WorkAvailable.wait(lock, [this, generation]() { return m_IsShuttingDown || m_Generation != generation; });
+			if (m_IsShuttingDown)
+				return;
+			generation = m_Generation;
+		}
+
+		while (RunChunk()) {}
+	}
+}
+
+bool Elite::WorkerPool::RunChunk()
+{
+	int first = 0;
+	int end = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_NextChunk >= m_NrOfChunks)
+			return false;
+		first = m_NextChunk++ * m_ChunkSize;
+		end = min(first + m_ChunkSize, m_Count);
+	}
+
+	//The job is only replaced after every chunk completed, so it can be used without the lock
+	m_Job(first, end);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (++m_NrOfCompletedChunks == m_NrOfChunks)
+		m_WorkDone.notify_all();
+	return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+// EWorkerPool.h: small pool of worker threads that runs one range job at a time (e.g. the rows of a grid).
+// The range is split in chunks that the workers (and the thread that waits) pick up until all are done.
+#include <functional>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace Elite
+{
+	class WorkerPool final
+	{
+	public:
+		using RangeJob = std::function<void(int first, int end)>;
+		using JobId = unsigned int;
+
+		//nrOfThreads < 0 uses one thread less than the hardware has (the calling thread helps when waiting)
+		explicit WorkerPool(int nrOfThreads = -1);
+		~WorkerPool();
+
+		int GetNrOfThreads() const { return int(m_Threads.size()); }
+
+		//Runs job(first, end) over [0, count) and blocks until every chunk is done
+		void ParallelFor(int count, const RangeJob& job) { Dispatch(count, job); Wait(); }
+
+		//Starts job(first, end) over [0, count) without blocking, waits for the previous job first
+		//Runs inline when the pool has no threads. The id tells when this job is done, whoever dispatches after it
+		JobId Dispatch(int count, const RangeJob& job);
+		bool IsDone(JobId job) const;
+		//Waits for the current job, so for every job dispatched before it too
+		void Wait();
+		//Only waits for the given job, returns right away when another job (e.g. of another user of the pool) is the current one
+		void Wait(JobId job);
+
+	private:
+		//--- Datamembers ---
+		std::vector<std::thread> m_Threads;
+		mutable std::mutex m_Mutex;
+		std::condition_variable m_WorkAvailable;
+		std::condition_variable m_WorkDone;
+
+		RangeJob m_Job;
+		int m_Count = 0;
+		int m_ChunkSize = 0;
+		int m_NrOfChunks = 0;
+		int m_NextChunk = 0;
+		int m_NrOfCompletedChunks = 0;
+		unsigned int m_Generation = 0;
+		bool m_IsShuttingDown = false;
+
+		void WorkerLoop();
+		bool RunChunk(); //Runs one chunk of the current job, false when none are left
+
+		WorkerPool(const WorkerPool& other) = delete;
+		WorkerPool& operator=(const WorkerPool& other) = delete;
+		WorkerPool(WorkerPool&& other) = delete;
+		WorkerPool& operator=(WorkerPool&& other) = delete;
+	};
+}
@@ -10,6 +10,7 @@
 /* --- STANDARD --- */
 #include <math.h>
 /* --- UTILITIES --- */
+#include "ERandom.h"
 #include "EMathUtilities.h"
 /* --- TYPES --- */
 #include "EVector2.h"
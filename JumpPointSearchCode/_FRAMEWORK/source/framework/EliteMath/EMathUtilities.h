@@ -10,6 +10,7 @@
 #include <cstdlib>
 #include <cfloat>
 #include <type_traits>
+#include "ERandom.h"
 
 namespace Elite {
 	/* --- CONSTANTS --- */
@@ -84,24 +85,21 @@ namespace Elite {
 		return a;
 	}
 
-	/*! Random Integer */
+	/*! Random Integer (stream of the calling thread, see ERandom.h) */
 	inline int randomInt(int max = 1)
-	{ return rand() % max; }
+	{ return GetThreadRandomStream().NextInt(max); }
 
 	/*! Random Float */
 	inline float randomFloat(float max = 1.f)
-	{ return max * (float(rand()) / RAND_MAX); }
+	{ return max * GetThreadRandomStream().NextFloat(); }
 
 	/*! Random Float */
 	inline float randomFloat(float min, float max)
-	{
-		auto range = max - min;
-		return (range * (float(rand()) / RAND_MAX)) + min;
-	}
+	{ return GetThreadRandomStream().NextFloat(min, max); }
 
 	/*! Random Binomial Float */
 	inline float randomBinomial(float max = 1.f)
-	{ return randomFloat(max) - randomFloat(max); }
+	{ return GetThreadRandomStream().NextBinomial(max); }
 
 	/*! Linear Interpolation */
 	/*inline float Lerp(float v0, float v1, float t)
@@ -0,0 +1,106 @@
+#pragma once
+// ERandom.h: fast, deterministic random numbers (xoshiro128**) in independent streams seeded from one world seed.
+// A stream is identified by an id (and an optional sub stream, e.g. the index of an agent), so the numbers an agent
+// draws don't depend on which thread updates it or in which order: parallel updates give the same result as serial ones.
+// Streams created without an id get the next id of a counter that SetRandomSeed resets, so a world that creates its
+// streams in the same order after setting the seed replays exactly.
+#include <cstdint>
+#include <atomic>
+
+namespace Elite
+{
+	class RandomStream final
+	{
+	public:
+		//Next stream of the world seed
+		RandomStream();
+		explicit RandomStream(uint64_t streamId, uint64_t subStream = 0) { Seed(streamId, subStream); }
+
+		void Seed(uint64_t streamId, uint64_t subStream = 0);
+
+		uint32_t NextUInt()
+		{
+			const uint32_t result = RotateLeft(m_State[1] * 5, 7) * 9;
+			const uint32_t t = m_State[1] << 9;
+			m_State[2] ^= m_State[0];
+			m_State[3] ^= m_State[1];
+			m_State[1] ^= m_State[2];
+			m_State[0] ^= m_State[3];
+			m_State[2] ^= t;
+			m_State[3] = RotateLeft(m_State[3], 11);
+			return result;
+		}
+
+		//[0, max), 0 when max <= 0
+		int NextInt(int max) { return max > 0 ? int((uint64_t(NextUInt()) * uint32_t(max)) >> 32) : 0; }
+		//[0, 1)
+		float NextFloat() { return (NextUInt() >> 8) * (1.f / 16777216.f); }
+		//[min, max)
+		float NextFloat(float min, float max) { return min + (max - min) * NextFloat(); }
+		//(-max, max), more likely around 0
+		float NextBinomial(float max = 1.f) { return max * (NextFloat() - NextFloat()); }
+
+	private:
+		uint32_t m_State[4];
+
+		static uint32_t RotateLeft(uint32_t x, int k) { return (x << k) | (x >> (32 - k)); }
+	};
+
+	namespace RandomDetail
+	{
+		inline uint64_t SplitMix(uint64_t x)
+		{
+			x += 0x9E3779B97F4A7C15ull;
+			x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+			x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+			return x ^ (x >> 31);
+		}
+
+		inline std::atomic<uint64_t>& GetSeed() { static std::atomic<uint64_t> seed{ 0x5EED5EED5EED5EEDull }; return seed; }
+		inline std::atomic<uint64_t>& GetNextStreamId() { static std::atomic<uint64_t> nextId{ 0 }; return nextId; }
+
+		//The thread streams are the sub streams of one id the counter never reaches
+		constexpr uint64_t ThreadStreamId = ~0ull;
+		inline std::atomic<uint64_t>& GetNextThread() { static std::atomic<uint64_t> nextThread{ 0 }; return nextThread; }
+	}
+
+	inline uint64_t GetRandomSeed() { return RandomDetail::GetSeed(); }
+
+	//Id of a new stream, e.g. for a group of streams that are its sub streams (one per agent)
+	inline uint64_t CreateRandomStreamId() { return RandomDetail::GetNextStreamId()++; }
+
+	inline RandomStream::RandomStream()
+	{
+		Seed(CreateRandomStreamId());
+	}
+
+	inline void RandomStream::Seed(uint64_t streamId, uint64_t subStream)
+	{
+		uint64_t x = RandomDetail::SplitMix(GetRandomSeed());
+		x = RandomDetail::SplitMix(x ^ streamId);
+		x = RandomDetail::SplitMix(x ^ subStream);
+		const uint64_t y = RandomDetail::SplitMix(x);
+		m_State[0] = uint32_t(x);
+		m_State[1] = uint32_t(x >> 32);
+		m_State[2] = uint32_t(y);
+		m_State[3] = uint32_t(y >> 32) | 1u; //Never all zero
+	}
+
+	//Stream of the calling thread, for code that isn't tied to an agent (e.g. spawning on the main thread)
+	//Threads are numbered in the order they first ask for it: use a stream per agent in parallel code
+	inline RandomStream& GetThreadRandomStream()
+	{
+		static thread_local RandomStream stream{ RandomDetail::ThreadStreamId, RandomDetail::GetNextThread()++ };
+		return stream;
+	}
+
+	//Set before the world creates its streams: resets the ids of the streams created without one and the stream of the
+	//calling thread (the main thread is always thread 0)
+	inline void SetRandomSeed(uint64_t seed)
+	{
+		RandomDetail::GetSeed() = seed;
+		RandomDetail::GetNextStreamId() = 0;
+		GetThreadRandomStream().Seed(RandomDetail::ThreadStreamId, 0);
+		RandomDetail::GetNextThread() = 1;
+	}
+}
@@ -201,6 +201,10 @@ namespace Elite
 	{
 		return{ randomFloat(min, max),randomFloat(min, max) };
 	}
+	inline Vector2 randomVector2(RandomStream& random, float min, float max)
+	{
+		return{ random.NextFloat(min, max), random.NextFloat(min, max) };
+	}
 	/*! Orientation to a Vector2 */
 	inline Vector2 OrientationToVector(float orientation)
 	{
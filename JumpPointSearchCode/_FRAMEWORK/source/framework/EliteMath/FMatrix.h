@@ -94,11 +94,15 @@ namespace Elite
 		}
 
 		void Randomize(float min, float max)
+		{
+			Randomize(min, max, GetThreadRandomStream());
+		}
+
+		void Randomize(float min, float max, RandomStream& random)
 		{
 			for (int i = 0; i < m_Size; ++i)
 			{
-				float r = min + static_cast <float> (rand()) / (static_cast <float> (RAND_MAX / (max - min)));
-				m_Data[i] = r;
+				m_Data[i] = random.NextFloat(min, max);
 			}
 		}
 
@@ -125,6 +125,20 @@ void Elite::RigidBodyBase<Elite::Vector2, Elite::Vector2>::RemoveAllShapes()
 	m_vFixtures.clear();
 }
 
+template <>
+void Elite::RigidBodyBase<Elite::Vector2, Elite::Vector2>::SetCircleRadius(float radius)
+{
+	auto pBody = static_cast<b2Body*>(m_pBody);
+	for (auto fix : m_vFixtures)
+	{
+		auto pB2Fix = static_cast<b2Fixture*>(fix);
+		if (pB2Fix->GetType() == b2Shape::e_circle)
+			pB2Fix->GetShape()->m_radius = radius;
+	}
+	//The broadphase picks up the new size when the body moves or is activated again
+	pBody->ResetMassData();
+}
+
 template <>
 void Elite::RigidBodyBase<Elite::Vector2, Elite::Vector2>::Initialize()
 {
@@ -238,6 +252,20 @@ float Elite::RigidBodyBase<Elite::Vector2, Elite::Vector2>::GetLinearDamping()
 	return pBody->GetLinearDamping();
 }
 
+template <>
+void Elite::RigidBodyBase<Elite::Vector2, Elite::Vector2>::SetActive(bool isActive)
+{
+	auto pBody = static_cast<b2Body*>(m_pBody);
+	pBody->SetActive(isActive);
+}
+
+template <>
+bool Elite::RigidBodyBase<Elite::Vector2, Elite::Vector2>::IsActive()
+{
+	auto pBody = static_cast<b2Body*>(m_pBody);
+	return pBody->IsActive();
+}
+
 template <>
 void Elite::RigidBodyBase<Elite::Vector2, Elite::Vector2>::AddForce(const Vector2& force, EForceMode mode, bool autoWake)
 {
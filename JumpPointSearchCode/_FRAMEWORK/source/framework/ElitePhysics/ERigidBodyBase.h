@@ -28,6 +28,8 @@ namespace Elite
 		//=== RigidBody Functions ===
 		void AddShape(Elite::EPhysicsShape* pShape);
 		void RemoveAllShapes();
+		//Resizes the circle shapes in place, instead of removing them and adding new ones
+		void SetCircleRadius(float radius);
 
 		internalTransformType GetTransform();
 		void SetTransform(const internalTransformType& transform);
@@ -47,6 +49,10 @@ namespace Elite
 		void SetLinearDamping(float damping);
 		float GetLinearDamping();
 
+		//An inactive body is out of the simulation (no collisions, no contacts) but keeps its shapes, so it can be reused
+		void SetActive(bool isActive);
+		bool IsActive();
+
 		void AddForce(const translationType& force, EForceMode mode, bool autoWake = true);
 		void AddTorque(const translationType& torque, EForceMode mode, bool autoWake = true);
 
@@ -27,7 +27,11 @@ App_AgarioGame_BT::~App_AgarioGame_BT()
 	m_pAgentVec.clear();
 
 	SAFE_DELETE(m_pContactListener);
+	SAFE_DELETE(m_pFoodStore);
+	SAFE_DELETE(m_pAgentStore);
 	SAFE_DELETE(m_pUberAgent);
+	SAFE_DELETE(m_pAgentBehaviorTree);
+	SAFE_DELETE(m_pUberBehaviorTree);
 
 	for (auto pNC : m_vNavigationColliders)
 		SAFE_DELETE(pNC);
@@ -36,6 +40,10 @@ App_AgarioGame_BT::~App_AgarioGame_BT()
 
 void App_AgarioGame_BT::Start()
 {
+	//Seeding the world before anything draws a random number
+	Elite::SetRandomSeed(m_RandomSeed);
+	m_SpawnRandom.Seed(Elite::CreateRandomStreamId());
+
 	//Create Boundaries
 	const float blockSize{ 2.0f };
 	const float hBlockSize{ blockSize / 2.0f };
@@ -48,42 +56,69 @@ void App_AgarioGame_BT::Start()
 	//Creating the world contact listener that informs us of collisions
 	m_pContactListener = new AgarioContactListener();
 
-	//Create food items
-	m_pFoodVec.reserve(m_AmountOfFood);
+	//Creating the entity stores the decision making queries
+	const Elite::Vector2 worldMin{ -m_TrimWorldSize, -m_TrimWorldSize };
+	const Elite::Vector2 worldMax{ m_TrimWorldSize, m_TrimWorldSize };
+	m_pFoodStore = new AgarioEntityStore(m_PartitionType, worldMin, worldMax);
+	m_pAgentStore = new AgarioEntityStore(m_PartitionType, worldMin, worldMax);
+
+	//Every frame close to the uber agent, a few times a second further away
+	m_Scheduler.AddBucket(m_TrimWorldSize * 0.3f, 0.f, 0.f);
+	m_Scheduler.AddBucket(m_TrimWorldSize * 0.6f, 0.1f, 0.05f);
+	m_Scheduler.AddBucket(FLT_MAX, 0.25f, 0.1f);
+	m_Scheduler.SetMaxDecisionsPerFrame(m_MaxDecisionsPerFrame);
+
+	//Create food items, twice as many in the pool so the food spawned while it's eaten doesn't allocate
+	m_FoodPool.Preallocate(m_AmountOfFood * 2);
+	m_pFoodVec.reserve(m_AmountOfFood * 2);
 	for (int i = 0; i < m_AmountOfFood; i++)
 	{
-		Elite::Vector2 randomPos = randomVector2(-m_TrimWorldSize, m_TrimWorldSize);
-		m_pFoodVec.push_back(new AgarioFood(randomPos));
+		Elite::Vector2 randomPos = randomVector2(m_SpawnRandom, -m_TrimWorldSize, m_TrimWorldSize);
+		m_FoodPool.Acquire(m_pFoodVec, randomPos);
 	}
 
+	//Create the behavior tree of the agents, compiled once and shared by all of them
+	//The crowd is updated in batches (UpdateAgents), so its conditionals get their batched version
+	Elite::IBehavior* pAgentBehavior = new BehaviorSelector(
+		{ new BehaviorSequence(
+			{
+				new BehaviorConditional(IsCloseToBiggerEnemy, IsCloseToBiggerEnemyBatch),
+				new BehaviorAction(ChangeToFlee)
+			}),
+			new BehaviorSequence(
+			{
+				new BehaviorConditional(IsCloseToFood, IsCloseToFoodBatch),
+				new BehaviorAction(ChangeToSeek)
+			}),
+			new BehaviorAction(ChangeToWander)
+		});
+	m_pAgentBehaviorTree = new CompiledBehaviorTree(pAgentBehavior);
+	SAFE_DELETE(pAgentBehavior);
+
 	//Create agents
+	m_AgentPool.Preallocate(m_AmountOfAgents);
 	m_pAgentVec.reserve(m_AmountOfAgents);
 	for (int i = 0; i < m_AmountOfAgents; i++)
 	{
-		Vector2 randomPos = randomVector2(-m_TrimWorldSize, m_TrimWorldSize);
-		AgarioAgent* newAgent = new AgarioAgent(randomPos);
+		Vector2 randomPos = randomVector2(m_SpawnRandom, -m_TrimWorldSize, m_TrimWorldSize);
+		AgarioAgent* newAgent = m_AgentPool.Acquire(m_pAgentVec, randomPos);
 
 		//1. Create Blackboard
 		Elite::Blackboard* pBlackBoard = CreateBlackboard(newAgent);
 
-		//2. Create BehaviorTree
-		Elite::BehaviorTree* pBehaviorTree = new BehaviorTree(pBlackBoard,
-			new BehaviorAction(ChangeToWander)
-		);
-		//3. Set the BehaviorTree active on the agent 
-		newAgent->SetDecisionMaking(pBehaviorTree);
+		//2. Set the shared BehaviorTree active on the agent
+		newAgent->SetDecisionMaking(new BehaviorTreeInstance(m_pAgentBehaviorTree, pBlackBoard));
 		
 		
 		
-		m_pAgentVec.push_back(newAgent);
 	}
 
 
 	//-------------------
 	//Create The Uber Agent
 	//-------------------
-	Elite::Vector2 randomPos = randomVector2(-m_TrimWorldSize, m_TrimWorldSize);
-	Color customColor = Color{ randomFloat(), randomFloat(), randomFloat() };
+	Elite::Vector2 randomPos = randomVector2(m_SpawnRandom, -m_TrimWorldSize, m_TrimWorldSize);
+	Color customColor = Color{ m_SpawnRandom.NextFloat(), m_SpawnRandom.NextFloat(), m_SpawnRandom.NextFloat() };
 	m_pUberAgent = new AgarioAgent(randomPos, customColor);
 
 	//Create and add the necessary blackboard data
@@ -91,8 +126,7 @@ void App_AgarioGame_BT::Start()
 	Elite::Blackboard* pBlackBoard = CreateBlackboard(m_pUberAgent);
 				
 	//2. Create BehaviorTree (make more conditions/actions and create a more advanced tree than the simple agents
-	Elite::BehaviorTree* pBehaviorTree = new BehaviorTree(pBlackBoard,
-		new BehaviorSelector(
+	Elite::IBehavior* pUberBehavior = new BehaviorSelector(
 		{ new BehaviorSequence(
 			{
 				new BehaviorConditional(IsCloseToBiggerEnemy),
@@ -104,12 +138,15 @@ void App_AgarioGame_BT::Start()
 				new BehaviorAction(ChangeToSeek)
 			}),
 			new BehaviorAction(ChangeToWander)
-		})
-	);
+		});
+	m_pUberBehaviorTree = new CompiledBehaviorTree(pUberBehavior);
+	SAFE_DELETE(pUberBehavior);
 
 	//3. Set the BehaviorTree active on the agent
-	m_pUberAgent->SetDecisionMaking(pBehaviorTree);
-	
+	m_pUberAgent->SetDecisionMaking(new BehaviorTreeInstance(m_pUberBehaviorTree, pBlackBoard));
+
+	m_pFoodStore->Sync(m_pFoodVec);
+	m_pAgentStore->Sync(m_pAgentVec);
 }
 
 void App_AgarioGame_BT::Update(float deltaTime)
@@ -126,8 +163,11 @@ void App_AgarioGame_BT::Update(float deltaTime)
 	m_pUberAgent->Update(deltaTime);
 	
 	//Update the other agents and food
-	UpdateAgarioEntities(m_pFoodVec, deltaTime);
-	UpdateAgarioEntities(m_pAgentVec, deltaTime);
+	for (AgarioFood* pFood : m_pFoodVec)
+	{
+		pFood->Update(deltaTime);
+	}
+	UpdateAgents(deltaTime);
 
 	
 	//Check if we need to spawn new food
@@ -135,7 +175,62 @@ void App_AgarioGame_BT::Update(float deltaTime)
 	if (m_TimeSinceLastFoodSpawn > m_FoodSpawnDelay)
 	{
 		m_TimeSinceLastFoodSpawn = 0.f;
-		m_pFoodVec.push_back(new AgarioFood(randomVector2(-m_TrimWorldSize, m_TrimWorldSize)));
+		m_FoodPool.Spawn(randomVector2(m_SpawnRandom, -m_TrimWorldSize, m_TrimWorldSize));
+	}
+
+	//The food eaten and the agents killed this frame go back to their pool, the new food and agents come out of it
+	ApplySpawnsAndRemovals();
+
+	//Update the entity stores for the decision making of the next frame
+	m_pFoodStore->Sync(m_pFoodVec);
+	m_pAgentStore->Sync(m_pAgentVec);
+}
+
+void App_AgarioGame_BT::UpdateAgents(float deltaTime)
+{
+	const int nrOfAgents{ int(m_pAgentVec.size()) };
+	m_AgentPositions.resize(nrOfAgents);
+	for (int i = 0; i < nrOfAgents; ++i)
+	{
+		m_pAgentVec[i]->UpdateBody();
+		m_AgentPositions[i] = m_pAgentVec[i]->GetPosition();
+	}
+
+	const Elite::Vector2 focusPoint{ m_pUberAgent->GetPosition() };
+	m_Scheduler.Schedule(deltaTime, m_AgentPositions.data(), nrOfAgents, &focusPoint, 1);
+	//The agents all run the same tree, so the ones that decide this frame do it together: the tree is walked once per leaf
+	//for all the agents at it. Only this app gives them their decision making, all of them BehaviorTreeInstances
+	m_pDecidingAgents.clear();
+	m_DecidingAgentIds.clear();
+	for (const UpdateScheduler::Tick& tick : m_Scheduler.GetDecisionTicks())
+	{
+		m_pDecidingAgents.push_back(static_cast<BehaviorTreeInstance*>(m_pAgentVec[tick.agent]->GetDecisionMaking()));
+		m_DecidingAgentIds.push_back(tick.agent);
+	}
+	m_pAgentBehaviorTree->UpdateBatch(m_pDecidingAgents.data(), m_DecidingAgentIds.data(), int(m_pDecidingAgents.size()));
+	for (const UpdateScheduler::Tick& tick : m_Scheduler.GetSteeringTicks())
+	{
+		m_pAgentVec[tick.agent]->UpdateSteering(tick.deltaT);
+	}
+}
+
+void App_AgarioGame_BT::ApplySpawnsAndRemovals()
+{
+	//Every agent that was eaten comes back out of the pool somewhere else, it keeps its decision making
+	for (AgarioAgent* pAgent : m_pAgentVec)
+	{
+		if (pAgent->CanBeDestroyed())
+			m_AgentPool.Spawn(randomVector2(m_SpawnRandom, -m_TrimWorldSize, m_TrimWorldSize));
+	}
+
+	m_FoodPool.Flush(m_pFoodVec);
+	m_AgentPool.Flush(m_pAgentVec);
+
+	//Backwards, so every index is still the one from before the flush
+	const std::vector<int>& removedAgents = m_AgentPool.GetRemovedIndices();
+	for (auto it = removedAgents.rbegin(); it != removedAgents.rend(); ++it)
+	{
+		m_Scheduler.RemoveAgent(*it);
 	}
 }
 
@@ -166,13 +261,16 @@ void App_AgarioGame_BT::Render(float deltaTime) const
 Blackboard* App_AgarioGame_BT::CreateBlackboard(AgarioAgent* a)
 {
 	Elite::Blackboard* pBlackboard = new Elite::Blackboard();
-	pBlackboard->AddData("Agent", a);
-	pBlackboard->AddData("AgentsVec", &m_pAgentVec);
-	pBlackboard->AddData("FoodVec", &m_pFoodVec);
-	pBlackboard->AddData("WorldSize", m_TrimWorldSize);
-	pBlackboard->AddData("Target", Elite::Vector2{});
-	pBlackboard->AddData("AgentFleeTarget", static_cast<AgarioAgent*>(nullptr)); // Needs the cast for the type
-	pBlackboard->AddData("Time", 0.0f); 
+	pBlackboard->AddData(AgarioKeys::Agent, a);
+	pBlackboard->AddData(AgarioKeys::AgentsVec, &m_pAgentVec);
+	pBlackboard->AddData(AgarioKeys::FoodVec, &m_pFoodVec);
+	pBlackboard->AddData(AgarioKeys::AgentsStore, m_pAgentStore);
+	pBlackboard->AddData(AgarioKeys::FoodStore, m_pFoodStore);
+	pBlackboard->AddData(AgarioKeys::WorldSize, m_TrimWorldSize);
+	pBlackboard->AddData(AgarioKeys::Target, Elite::Vector2{});
+	pBlackboard->AddData(AgarioKeys::AgentFleeTarget, static_cast<AgarioAgent*>(nullptr)); // Needs the cast for the type
+	pBlackboard->AddData(AgarioKeys::AgentFleeTargetGeneration, 0);
+	pBlackboard->AddData(AgarioKeys::Time, 0.0f); 
 
 	return pBlackboard;
 }
@@ -208,6 +306,7 @@ void App_AgarioGame_BT::UpdateImGui()
 		ImGui::Indent();
 		ImGui::Text("%.3f ms/frame", 1000.0f / ImGui::GetIO().Framerate);
 		ImGui::Text("%.1f FPS", ImGui::GetIO().Framerate);
+		ImGui::Text("%d/%d decisions", int(m_Scheduler.GetDecisionTicks().size()), int(m_pAgentVec.size()));
 		ImGui::Unindent();
 
 		ImGui::Spacing();
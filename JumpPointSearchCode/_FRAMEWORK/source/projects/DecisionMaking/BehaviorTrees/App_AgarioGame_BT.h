@@ -4,6 +4,8 @@
 // Includes & Forward Declarations
 //-----------------------------------------------------------------
 #include "framework/EliteInterfaces/EIApp.h"
+#include "projects/Shared/Agario/AgarioEntityStore.h"
+#include "projects/Shared/Agario/AgarioPool.h"
 
 class AgarioFood;
 class AgarioAgent;
@@ -26,6 +28,14 @@ private:
 
 	AgarioAgent* m_pUberAgent = nullptr;
 
+	//--Decision making--
+	//Compiled once, every agent runs the shared tree with its own state and blackboard
+	Elite::CompiledBehaviorTree* m_pAgentBehaviorTree = nullptr;
+	Elite::CompiledBehaviorTree* m_pUberBehaviorTree = nullptr;
+	//The agents that decide this frame, updated as one batch (the ids are the indices in m_pAgentVec)
+	std::vector<Elite::BehaviorTreeInstance*> m_pDecidingAgents{};
+	std::vector<int> m_DecidingAgentIds{};
+
 	const int m_AmountOfFood{ 40 };
 	const float m_FoodSpawnDelay{ 2.f };
 	float m_TimeSinceLastFoodSpawn{ 0.f };
@@ -36,9 +46,32 @@ private:
 
 	//--Level--
 	std::vector<NavigationColliderElement*> m_vNavigationColliders = {};
+
+	//--Random--
+	//Same seed, same game: the spawns draw from their own stream, the world seed is set when the game starts
+	const uint64_t m_RandomSeed{ 1 };
+	Elite::RandomStream m_SpawnRandom{};
+
+	//--Pools--
+	//Food and agents are recycled, the removals and spawns of a frame are applied at its end (ApplySpawnsAndRemovals)
+	AgarioPool<AgarioFood> m_FoodPool{};
+	AgarioPool<AgarioAgent> m_AgentPool{};
+
+	//--Entity stores--
+	//Used by the decision making to find the closest food/agents, the ids are the indices in m_pFoodVec and m_pAgentVec
+	const Elite::SpatialPartitionType m_PartitionType{ Elite::SpatialPartitionType::AABBTree }; //The agents cluster around the food and grow a lot
+	AgarioEntityStore* m_pFoodStore = nullptr;
+	AgarioEntityStore* m_pAgentStore = nullptr;
+
+	//--Update scheduling--
+	//The agents close to the uber agent decide and steer every frame, the others less often, in at most m_MaxDecisionsPerFrame
+	//decisions a frame. The agents are the indices in m_pAgentVec
+	Elite::UpdateScheduler m_Scheduler{};
+	const int m_MaxDecisionsPerFrame{ 10 };
+	std::vector<Elite::Vector2> m_AgentPositions{};
 private:	
-	template<class T_AgarioType>
-	void UpdateAgarioEntities(vector<T_AgarioType*>& entities, float deltaTime);
+	void UpdateAgents(float deltaTime);
+	void ApplySpawnsAndRemovals();
 
 	Elite::Blackboard* CreateBlackboard(AgarioAgent* a);
 	void UpdateImGui();
@@ -48,22 +81,4 @@ private:
 	App_AgarioGame_BT& operator=(const App_AgarioGame_BT&) {};
 };
 
-template<class T_AgarioType>
-inline void App_AgarioGame_BT::UpdateAgarioEntities(vector<T_AgarioType*>& entities, float deltaTime)
-{
-	for (auto& e : entities)
-	{
-		e->Update(deltaTime);
-
-		if (e->CanBeDestroyed())
-			SAFE_DELETE(e);
-	}
-
-	auto toRemoveEntityIt = std::remove_if(entities.begin(), entities.end(),
-		[](T_AgarioType* e) {return e == nullptr; });
-	if (toRemoveEntityIt != entities.end())
-	{
-		entities.erase(toRemoveEntityIt, entities.end());
-	}
-}
 #endif
\ No newline at end of file
@@ -13,6 +13,8 @@
 #include "projects/Shared/Agario/AgarioAgent.h"
 #include "projects/Shared/Agario/AgarioFood.h"
 #include "projects/Movement/SteeringBehaviors/Steering/SteeringBehaviors.h"
+#include "projects/Shared/Agario/AgarioEntityStore.h"
+#include "projects/Shared/Agario/AgarioBlackboardKeys.h"
 
 //-----------------------------------------------------------------
 // Behaviors
@@ -22,7 +24,7 @@
 Elite::BehaviorState ChangeToWander(Elite::Blackboard* pBlackboard)
 {
 	AgarioAgent* pAgent{ nullptr };
-	pBlackboard->GetData("Agent", pAgent);
+	pBlackboard->GetData(AgarioKeys::Agent, pAgent);
 
 	if (!pAgent)
 		return Elite::BehaviorState::Failure;
@@ -35,10 +37,10 @@ Elite::BehaviorState ChangeToWander(Elite::Blackboard* pBlackboard)
 Elite::BehaviorState ChangeToSeek(Elite::Blackboard* pBlackboard)
 {
 	AgarioAgent* pAgent{ nullptr };
-	pBlackboard->GetData("Agent", pAgent);
+	pBlackboard->GetData(AgarioKeys::Agent, pAgent);
 
 	Elite::Vector2 target;
-	pBlackboard->GetData("Target", target);
+	pBlackboard->GetData(AgarioKeys::Target, target);
 
 	if (!pAgent)
 		return Elite::BehaviorState::Failure;
@@ -51,12 +53,16 @@ Elite::BehaviorState ChangeToSeek(Elite::Blackboard* pBlackboard)
 Elite::BehaviorState ChangeToFlee(Elite::Blackboard* pBlackboard)
 {
 	AgarioAgent* pAgent{ nullptr };
-	pBlackboard->GetData("Agent", pAgent);
+	pBlackboard->GetData(AgarioKeys::Agent, pAgent);
 
-	AgarioAgent* target;
-	pBlackboard->GetData("AgentFleeTarget", target);
+	AgarioAgent* target{ nullptr };
+	pBlackboard->GetData(AgarioKeys::AgentFleeTarget, target);
 
-	if (!pAgent)
+	int targetGeneration{ 0 };
+	pBlackboard->GetData(AgarioKeys::AgentFleeTargetGeneration, targetGeneration);
+
+	//Eaten agents are recycled, the generation tells if the target is still the agent it was set to
+	if (!pAgent || !target || target->GetGeneration() != targetGeneration)
 		return Elite::BehaviorState::Failure;
 
 	pAgent->SetToFlee(target->GetPosition());
@@ -67,78 +73,117 @@ Elite::BehaviorState ChangeToFlee(Elite::Blackboard* pBlackboard)
 //CONDITIONALS
 bool IsCloseToFood(Elite::Blackboard* pBlackboard)
 {
-	std::vector<AgarioFood*>* foodVec;
-	pBlackboard->GetData("FoodVec", foodVec);
+	std::vector<AgarioFood*>* foodVec{ nullptr };
+	pBlackboard->GetData(AgarioKeys::FoodVec, foodVec);
+
+	AgarioEntityStore* pFoodStore{ nullptr };
+	pBlackboard->GetData(AgarioKeys::FoodStore, pFoodStore);
 
 	AgarioAgent* pAgent{ nullptr };
-	pBlackboard->GetData("Agent", pAgent);
+	pBlackboard->GetData(AgarioKeys::Agent, pAgent);
 
-	if (!pAgent || (*foodVec).size() < 1)
+	if (!pAgent || !foodVec || !pFoodStore)
 		return false;
 
-	AgarioFood* closestFood = (*foodVec)[0];
-	float closestDistanceSquared = DistanceSquared(closestFood->GetPosition(), pAgent->GetPosition());
-	for (size_t i = 1; i < (*foodVec).size(); i++)
-	{
-		float agentToFood = DistanceSquared((*foodVec)[i]->GetPosition(), pAgent->GetPosition());
-		if (closestDistanceSquared > agentToFood)
-		{
-			closestFood = (*foodVec)[i];
-			closestDistanceSquared = agentToFood;
-		}
-	}
+	const float closeToFoodRange{ 20.f };
+	const int closestFood = pFoodStore->QueryNearest(pAgent->GetPosition(), closeToFoodRange + pAgent->GetRadius());
+	if (closestFood == Elite::ISpatialPartition::InvalidId)
+		return false;
+
+	pBlackboard->ChangeData(AgarioKeys::Target, (*foodVec)[closestFood]->GetPosition());
+	return true;
+}
+
+//Batched: for the crowd agents that reach this conditional in the same update. The ids of the batch are the agent ids of
+//the agent store, so the agents are read from its SoA arrays (as of the last sync) instead of through their blackboards
+void IsCloseToFoodBatch(const Elite::BehaviorBatch& batch, bool* pResults)
+{
+	AgarioEntityStore* pFoodStore{ nullptr };
+	batch.ppBlackBoards[0]->GetData(AgarioKeys::FoodStore, pFoodStore);
+
+	AgarioEntityStore* pAgentStore{ nullptr };
+	batch.ppBlackBoards[0]->GetData(AgarioKeys::AgentsStore, pAgentStore);
 
 	const float closeToFoodRange{ 20.f };
-	if (closestDistanceSquared < (closeToFoodRange + pAgent->GetRadius()) * (closeToFoodRange + pAgent->GetRadius()))
+	for (int i = 0; i < batch.nrOfAgents; ++i)
 	{
-		pBlackboard->ChangeData("Target", closestFood->GetPosition());
-		return true;
-	}
+		pResults[i] = false;
+		const int agent{ batch.pAgents[i] };
+		if (!pFoodStore || !pAgentStore || agent >= pAgentStore->GetNrOfEntities() || !pAgentStore->IsAlive(agent))
+			continue;
 
-	return false;
+		const int closestFood = pFoodStore->QueryNearest(pAgentStore->GetPosition(agent), closeToFoodRange + pAgentStore->GetRadius(agent));
+		if (closestFood == Elite::ISpatialPartition::InvalidId)
+			continue;
+
+		batch.ppBlackBoards[i]->ChangeData(AgarioKeys::Target, pFoodStore->GetPosition(closestFood));
+		pResults[i] = true;
+	}
 }
 
 bool IsCloseToBiggerEnemy(Elite::Blackboard* pBlackboard)
 {
-	std::vector<AgarioAgent*>* agentVec;
-	pBlackboard->GetData("AgentsVec", agentVec);
+	std::vector<AgarioAgent*>* agentVec{ nullptr };
+	pBlackboard->GetData(AgarioKeys::AgentsVec, agentVec);
+
+	AgarioEntityStore* pAgentStore{ nullptr };
+	pBlackboard->GetData(AgarioKeys::AgentsStore, pAgentStore);
 
 	AgarioAgent* pAgent{ nullptr };
-	pBlackboard->GetData("Agent", pAgent);
+	pBlackboard->GetData(AgarioKeys::Agent, pAgent);
 
-	if (!pAgent || (*agentVec).size() < 1)
+	if (!pAgent || !agentVec || !pAgentStore)
 		return false;
 
-	AgarioAgent* closestAgent = (*agentVec)[0];
-	float closestDistanceSquared = DistanceSquared(closestAgent->GetPosition(), pAgent->GetPosition());
-	for (size_t i = 1; i < (*agentVec).size(); i++)
-	{
-		if (closestAgent->GetRadius() <= pAgent->GetRadius())
-		{
-			if ((*agentVec)[i]->GetRadius() > pAgent->GetRadius())
-			{
-				closestAgent = (*agentVec)[i];
-				closestDistanceSquared = DistanceSquared(closestAgent->GetPosition(), pAgent->GetPosition());
-			}
-		}
-		else
-		{
-			float agentToAgent = DistanceSquared((*agentVec)[i]->GetPosition(), pAgent->GetPosition());
-			if ((*agentVec)[i]->GetRadius() > pAgent->GetRadius() && closestDistanceSquared > agentToAgent)
-			{
-				closestAgent = (*agentVec)[i];
-				closestDistanceSquared = agentToAgent;
-			}
-		}
-	}
+	//The range grows with the enemy, so find the closest bigger enemy first and check the range after
+	const int closestEnemy = pAgentStore->QueryNearest(pAgent->GetPosition(), FLT_MAX, pAgent->GetRadius());
+	if (closestEnemy == Elite::ISpatialPartition::InvalidId)
+		return false;
 
+	AgarioAgent* closestAgent = (*agentVec)[closestEnemy];
 	const float closeToEnemyRange{ 40.f };
-	if (closestAgent->GetRadius() > pAgent->GetRadius() && closestDistanceSquared < (closeToEnemyRange + pAgent->GetRadius() + closestAgent->GetRadius()) * (closeToEnemyRange + pAgent->GetRadius() + closestAgent->GetRadius()))
+	const float reach{ closeToEnemyRange + pAgent->GetRadius() + closestAgent->GetRadius() };
+	if (DistanceSquared(closestAgent->GetPosition(), pAgent->GetPosition()) < reach * reach)
 	{
-		pBlackboard->ChangeData("AgentFleeTarget", closestAgent);
+		pBlackboard->ChangeData(AgarioKeys::AgentFleeTarget, closestAgent);
+		pBlackboard->ChangeData(AgarioKeys::AgentFleeTargetGeneration, closestAgent->GetGeneration());
 		return true;
 	}
 
 	return false;
 }
+
+//Batched, see IsCloseToFoodBatch
+void IsCloseToBiggerEnemyBatch(const Elite::BehaviorBatch& batch, bool* pResults)
+{
+	std::vector<AgarioAgent*>* agentVec{ nullptr };
+	batch.ppBlackBoards[0]->GetData(AgarioKeys::AgentsVec, agentVec);
+
+	AgarioEntityStore* pAgentStore{ nullptr };
+	batch.ppBlackBoards[0]->GetData(AgarioKeys::AgentsStore, pAgentStore);
+
+	const float closeToEnemyRange{ 40.f };
+	for (int i = 0; i < batch.nrOfAgents; ++i)
+	{
+		pResults[i] = false;
+		const int agent{ batch.pAgents[i] };
+		if (!agentVec || !pAgentStore || agent >= pAgentStore->GetNrOfEntities() || !pAgentStore->IsAlive(agent))
+			continue;
+
+		const Elite::Vector2 position{ pAgentStore->GetPosition(agent) };
+		const float radius{ pAgentStore->GetRadius(agent) };
+		const int closestEnemy = pAgentStore->QueryNearest(position, FLT_MAX, radius);
+		if (closestEnemy == Elite::ISpatialPartition::InvalidId)
+			continue;
+
+		const float reach{ closeToEnemyRange + radius + pAgentStore->GetRadius(closestEnemy) };
+		if (DistanceSquared(pAgentStore->GetPosition(closestEnemy), position) < reach * reach)
+		{
+			AgarioAgent* pEnemy{ (*agentVec)[closestEnemy] };
+			batch.ppBlackBoards[i]->ChangeData(AgarioKeys::AgentFleeTarget, pEnemy);
+			batch.ppBlackBoards[i]->ChangeData(AgarioKeys::AgentFleeTargetGeneration, pEnemy->GetGeneration());
+			pResults[i] = true;
+		}
+	}
+}
 #endif
\ No newline at end of file
@@ -29,6 +29,8 @@ App_AgarioGame::~App_AgarioGame()
 	m_pAgentVec.clear();
 
 	SAFE_DELETE(m_pContactListener);
+	SAFE_DELETE(m_pFoodStore);
+	SAFE_DELETE(m_pAgentStore);
 	SAFE_DELETE(m_pCustomAgent);
 	for (auto& s : m_pStates)
 	{
@@ -44,15 +46,32 @@ App_AgarioGame::~App_AgarioGame()
 
 void App_AgarioGame::Start()
 {
+	//Seeding the world before anything draws a random number
+	Elite::SetRandomSeed(m_RandomSeed);
+	m_SpawnRandom.Seed(Elite::CreateRandomStreamId());
+
 	//Creating the world contact listener that informs us of collisions
 	m_pContactListener = new AgarioContactListener();
 
-	//Create food items
-	m_pFoodVec.reserve(m_AmountOfFood);
+	//Creating the entity stores the decision making queries
+	const Elite::Vector2 worldMin{ -m_TrimWorldSize, -m_TrimWorldSize };
+	const Elite::Vector2 worldMax{ m_TrimWorldSize, m_TrimWorldSize };
+	m_pFoodStore = new AgarioEntityStore(m_PartitionType, worldMin, worldMax);
+	m_pAgentStore = new AgarioEntityStore(m_PartitionType, worldMin, worldMax);
+
+	//Every frame close to the custom agent, a few times a second further away
+	m_Scheduler.AddBucket(m_TrimWorldSize * 0.3f, 0.f, 0.f);
+	m_Scheduler.AddBucket(m_TrimWorldSize * 0.6f, 0.1f, 0.05f);
+	m_Scheduler.AddBucket(FLT_MAX, 0.25f, 0.1f);
+	m_Scheduler.SetMaxDecisionsPerFrame(m_MaxDecisionsPerFrame);
+
+	//Create food items, twice as many in the pool so the food spawned while it's eaten doesn't allocate
+	m_FoodPool.Preallocate(m_AmountOfFood * 2);
+	m_pFoodVec.reserve(m_AmountOfFood * 2);
 	for (int i = 0; i < m_AmountOfFood; i++)
 	{
-		Elite::Vector2 randomPos = randomVector2(-m_TrimWorldSize, m_TrimWorldSize);
-		m_pFoodVec.push_back(new AgarioFood(randomPos));
+		Elite::Vector2 randomPos = randomVector2(m_SpawnRandom, -m_TrimWorldSize, m_TrimWorldSize);
+		m_FoodPool.Acquire(m_pFoodVec, randomPos);
 	}
 
 	//Creating wander state
@@ -60,18 +79,18 @@ void App_AgarioGame::Start()
 	m_pStates.push_back(pWanderState); //Opkuis
 
 	//Create default agents
+	m_AgentPool.Preallocate(m_AmountOfAgents);
 	m_pAgentVec.reserve(m_AmountOfAgents);
 	for (int i = 0; i < m_AmountOfAgents; i++)
 	{
-		Elite::Vector2 randomPos = randomVector2(-m_TrimWorldSize*(2.0f / 3), m_TrimWorldSize * (2.0f / 3));
-		AgarioAgent* newAgent = new AgarioAgent(randomPos);
+		Elite::Vector2 randomPos = randomVector2(m_SpawnRandom, -m_TrimWorldSize*(2.0f / 3), m_TrimWorldSize * (2.0f / 3));
+		AgarioAgent* newAgent = m_AgentPool.Acquire(m_pAgentVec, randomPos);
 
 		//ACTIVATE THE BEHAVIOR FOR THE SIMPLE STUPID AGENTS
 
 		Elite::Blackboard* pB = CreateBlackboard(newAgent);
 		FiniteStateMachine* defaultMachine = new FiniteStateMachine(pWanderState, pB);
 		newAgent->SetDecisionMaking(defaultMachine);
-		m_pAgentVec.push_back(newAgent);
 	}
 
 	
@@ -79,13 +98,13 @@ void App_AgarioGame::Start()
 	//-------------------
 	//Create Custom Agent
 	//-------------------
-	Elite::Vector2 randomPos = randomVector2(-m_TrimWorldSize * (2.0f / 3), m_TrimWorldSize * (2.0f / 3));
+	Elite::Vector2 randomPos = randomVector2(m_SpawnRandom, -m_TrimWorldSize * (2.0f / 3), m_TrimWorldSize * (2.0f / 3));
 	Color customColor = Color{ 0.0f, 1.0f, 0.0f };
 	m_pCustomAgent = new AgarioAgent(randomPos, customColor);
 
 	//1. Create and add the necessary blackboard data
 	Elite::Blackboard* pB = CreateBlackboard(m_pCustomAgent);
-	//pB->ChangeData("FoodTarget", m_pFoodVec[0]);
+	//pB->ChangeData(AgarioKeys::FoodTarget, m_pFoodVec[0]);
 
 	//2. Create the different agent states
 	SeekState* pSeekState = new SeekState(); //State instance aanmaken
@@ -131,6 +150,9 @@ void App_AgarioGame::Start()
 
 	//6. Activate the decision making stucture on the custom agent by calling the SetDecisionMaking function
 	m_pCustomAgent->SetDecisionMaking(customMachine);
+
+	m_pFoodStore->Sync(m_pFoodVec);
+	m_pAgentStore->Sync(m_pAgentVec);
 }
 
 void App_AgarioGame::Update(float deltaTime)
@@ -149,8 +171,11 @@ void App_AgarioGame::Update(float deltaTime)
 	//m_pCustomAgent->TrimToWorld(m_TrimWorldSize);
 
 	//Update the other agents and food
-	UpdateAgarioEntities(m_pFoodVec, deltaTime);
-	UpdateAgarioEntities(m_pAgentVec, deltaTime);
+	for (AgarioFood* pFood : m_pFoodVec)
+	{
+		pFood->Update(deltaTime);
+	}
+	UpdateAgents(deltaTime);
 
 	
 	//Check if we need to spawn new food
@@ -158,7 +183,61 @@ void App_AgarioGame::Update(float deltaTime)
 	if (m_TimeSinceLastFoodSpawn > m_FoodSpawnDelay)
 	{
 		m_TimeSinceLastFoodSpawn = 0.f;
-		m_pFoodVec.push_back(new AgarioFood(randomVector2(-m_TrimWorldSize, m_TrimWorldSize)));
+		m_FoodPool.Spawn(randomVector2(m_SpawnRandom, -m_TrimWorldSize, m_TrimWorldSize));
+	}
+
+	//The food eaten and the agents killed this frame go back to their pool, the new food and agents come out of it
+	ApplySpawnsAndRemovals();
+
+	//Update the entity stores for the decision making of the next frame
+	m_pFoodStore->Sync(m_pFoodVec);
+	m_pAgentStore->Sync(m_pAgentVec);
+}
+
+void App_AgarioGame::UpdateAgents(float deltaTime)
+{
+	const int nrOfAgents{ int(m_pAgentVec.size()) };
+	m_AgentPositions.resize(nrOfAgents);
+	for (int i = 0; i < nrOfAgents; ++i)
+	{
+		m_pAgentVec[i]->UpdateBody();
+		m_AgentPositions[i] = m_pAgentVec[i]->GetPosition();
+	}
+
+	const Elite::Vector2 focusPoint{ m_pCustomAgent->GetPosition() };
+	m_Scheduler.Schedule(deltaTime, m_AgentPositions.data(), nrOfAgents, &focusPoint, 1);
+	for (const UpdateScheduler::Tick& tick : m_Scheduler.GetDecisionTicks())
+	{
+		m_pAgentVec[tick.agent]->UpdateDecisionMaking(tick.deltaT);
+	}
+	for (const UpdateScheduler::Tick& tick : m_Scheduler.GetSteeringTicks())
+	{
+		m_pAgentVec[tick.agent]->UpdateSteering(tick.deltaT);
+	}
+
+	for (AgarioAgent* pAgent : m_pAgentVec)
+	{
+		pAgent->LimitToWorld(m_TrimWorldSize);
+	}
+}
+
+void App_AgarioGame::ApplySpawnsAndRemovals()
+{
+	//Every agent that was eaten comes back out of the pool somewhere else, it keeps its decision making
+	for (AgarioAgent* pAgent : m_pAgentVec)
+	{
+		if (pAgent->CanBeDestroyed())
+			m_AgentPool.Spawn(randomVector2(m_SpawnRandom, -m_TrimWorldSize * (2.0f / 3), m_TrimWorldSize * (2.0f / 3)));
+	}
+
+	m_FoodPool.Flush(m_pFoodVec);
+	m_AgentPool.Flush(m_pAgentVec);
+
+	//Backwards, so every index is still the one from before the flush
+	const std::vector<int>& removedAgents = m_AgentPool.GetRemovedIndices();
+	for (auto it = removedAgents.rbegin(); it != removedAgents.rend(); ++it)
+	{
+		m_Scheduler.RemoveAgent(*it);
 	}
 }
 
@@ -189,13 +268,17 @@ void App_AgarioGame::Render(float deltaTime) const
 Blackboard* App_AgarioGame::CreateBlackboard(AgarioAgent* a)
 {
 	Elite::Blackboard* pBlackboard = new Elite::Blackboard();
-	pBlackboard->AddData("Agent", a);
-	pBlackboard->AddData("AgentsVec", &m_pAgentVec);
-	pBlackboard->AddData("FoodVec", &m_pFoodVec);
-	pBlackboard->AddData("WorldSize", m_TrimWorldSize);
-	pBlackboard->AddData("FoodTarget", static_cast<AgarioFood*>(nullptr)); // Needs the cast for the type
-	pBlackboard->AddData("AgentFleeTarget", static_cast<AgarioAgent*>(nullptr)); // Needs the cast for the type
-	pBlackboard->AddData("Time", 0.0f); 
+	pBlackboard->AddData(AgarioKeys::Agent, a);
+	pBlackboard->AddData(AgarioKeys::AgentsVec, &m_pAgentVec);
+	pBlackboard->AddData(AgarioKeys::FoodVec, &m_pFoodVec);
+	pBlackboard->AddData(AgarioKeys::AgentsStore, m_pAgentStore);
+	pBlackboard->AddData(AgarioKeys::FoodStore, m_pFoodStore);
+	pBlackboard->AddData(AgarioKeys::WorldSize, m_TrimWorldSize);
+	pBlackboard->AddData(AgarioKeys::FoodTarget, static_cast<AgarioFood*>(nullptr)); // Needs the cast for the type
+	pBlackboard->AddData(AgarioKeys::FoodTargetGeneration, 0);
+	pBlackboard->AddData(AgarioKeys::AgentFleeTarget, static_cast<AgarioAgent*>(nullptr)); // Needs the cast for the type
+	pBlackboard->AddData(AgarioKeys::AgentFleeTargetGeneration, 0);
+	pBlackboard->AddData(AgarioKeys::Time, 0.0f); 
 
 	return pBlackboard;
 }
@@ -231,6 +314,7 @@ void App_AgarioGame::UpdateImGui()
 		ImGui::Indent();
 		ImGui::Text("%.3f ms/frame", 1000.0f / ImGui::GetIO().Framerate);
 		ImGui::Text("%.1f FPS", ImGui::GetIO().Framerate);
+		ImGui::Text("%d/%d decisions", int(m_Scheduler.GetDecisionTicks().size()), int(m_pAgentVec.size()));
 		ImGui::Unindent();
 
 		ImGui::Spacing();
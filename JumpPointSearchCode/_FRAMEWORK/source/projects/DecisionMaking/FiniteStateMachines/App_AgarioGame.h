@@ -4,6 +4,8 @@
 // Includes & Forward Declarations
 //-----------------------------------------------------------------
 #include "framework/EliteInterfaces/EIApp.h"
+#include "projects/Shared/Agario/AgarioEntityStore.h"
+#include "projects/Shared/Agario/AgarioPool.h"
 
 class AgarioFood;
 class AgarioAgent;
@@ -36,9 +38,32 @@ private:
 	std::vector<Elite::FSMState*> m_pStates{};
 	std::vector<Elite::FSMTransition*> m_pTransitions{};
 
+	//--Random--
+	//Same seed, same game: the spawns draw from their own stream, the world seed is set when the game starts
+	const uint64_t m_RandomSeed{ 1 };
+	Elite::RandomStream m_SpawnRandom{};
+
+	//--Pools--
+	//Food and agents are recycled, the removals and spawns of a frame are applied at its end (ApplySpawnsAndRemovals)
+	AgarioPool<AgarioFood> m_FoodPool{};
+	AgarioPool<AgarioAgent> m_AgentPool{};
+
+	//--Entity stores--
+	//Used by the decision making to find the closest food/agents, the ids are the indices in m_pFoodVec and m_pAgentVec
+	const Elite::SpatialPartitionType m_PartitionType{ Elite::SpatialPartitionType::LooseQuadtree }; //Food and agents are spread over the whole world
+	AgarioEntityStore* m_pFoodStore = nullptr;
+	AgarioEntityStore* m_pAgentStore = nullptr;
+
+	//--Update scheduling--
+	//The agents close to the custom agent decide and steer every frame, the others less often, in at most m_MaxDecisionsPerFrame
+	//decisions a frame. The agents are the indices in m_pAgentVec
+	Elite::UpdateScheduler m_Scheduler{};
+	const int m_MaxDecisionsPerFrame{ 15 };
+	std::vector<Elite::Vector2> m_AgentPositions{};
+
 private:	
-	template<class T_AgarioType>
-	void UpdateAgarioEntities(vector<T_AgarioType*>& entities, float deltaTime);
+	void UpdateAgents(float deltaTime);
+	void ApplySpawnsAndRemovals();
 
 	Elite::Blackboard* CreateBlackboard(AgarioAgent* a);
 	void UpdateImGui();
@@ -48,34 +73,4 @@ private:
 	App_AgarioGame& operator=(const App_AgarioGame&) {};
 };
 
-template<class T_AgarioType>
-inline void App_AgarioGame::UpdateAgarioEntities(vector<T_AgarioType*>& entities, float deltaTime)
-{
-	for (auto& e : entities)
-	{
-		e->Update(deltaTime);
-
-	
-		auto agent = dynamic_cast<AgarioAgent*>(e);
-		if (agent)
-		{
-			//Limit agent to world bounds
-			agent->LimitToWorld(m_TrimWorldSize);
-
-			//Trim agent to world bounds
-			//agent->TrimToWorld(m_TrimWorldSize);
-		}
-			
-		if (e->CanBeDestroyed())
-			SAFE_DELETE(e);
-	}
-
-	auto toRemoveEntityIt = std::remove_if(entities.begin(), entities.end(),
-		[](T_AgarioType* e) {return e == nullptr; });
-	if (toRemoveEntityIt != entities.end())
-	{
-		entities.erase(toRemoveEntityIt, entities.end());
-	}
-}
-
 #endif
@@ -10,6 +10,29 @@
 #include "projects/Shared/Agario/AgarioFood.h"
 #include "projects/Movement/SteeringBehaviors/Steering/SteeringBehaviors.h"
 #include "framework/EliteAI/EliteData/EBlackboard.h"
+#include "projects/Shared/Agario/AgarioEntityStore.h"
+#include "projects/Shared/Agario/AgarioBlackboardKeys.h"
+
+//The agent to flee from or hunt, together with its generation: eaten agents are recycled, so the pointer alone can be
+//alive again as another agent
+inline void SetAgentTarget(Elite::Blackboard* pBlackboard, AgarioAgent* pTarget)
+{
+	pBlackboard->ChangeData(AgarioKeys::AgentFleeTarget, pTarget);
+	pBlackboard->ChangeData(AgarioKeys::AgentFleeTargetGeneration, pTarget ? pTarget->GetGeneration() : 0);
+}
+
+//nullptr when there's no target or it was eaten since it was set
+inline AgarioAgent* GetAgentTarget(Elite::Blackboard* pBlackboard)
+{
+	AgarioAgent* pTarget{ nullptr };
+	int targetGeneration{ 0 };
+	if (!pBlackboard->GetData(AgarioKeys::AgentFleeTarget, pTarget) || !pTarget ||
+		!pBlackboard->GetData(AgarioKeys::AgentFleeTargetGeneration, targetGeneration))
+		return nullptr;
+	if (pTarget->CanBeDestroyed() || pTarget->GetGeneration() != targetGeneration)
+		return nullptr;
+	return pTarget;
+}
 
 //------------
 //---STATES---
@@ -19,18 +42,13 @@ class WanderState : public Elite::FSMState
 public:
 	virtual void OnEnter(Elite::Blackboard* pBlackboard) override
 	{
-		std::cout << "entering wander" << std::endl;
 		AgarioAgent* pAgent{ nullptr };
-		bool success = pBlackboard->GetData("Agent", pAgent);
+		bool success = pBlackboard->GetData(AgarioKeys::Agent, pAgent);
 		if (!success)
 			return;
 
 		pAgent->SetToWander();
 	}
-	virtual void OnExit(Elite::Blackboard* pBlackboard) override
-	{
-		std::cout << "exiting wander" << std::endl << std::endl;
-	}
 };
 
 class SeekState : public Elite::FSMState
@@ -38,36 +56,29 @@ class SeekState : public Elite::FSMState
 public:
 	virtual void OnEnter(Elite::Blackboard* pBlackboard) override
 	{
-		std::cout << "entering seek" << std::endl;
 		AgarioAgent* pAgent{ nullptr };
-		bool success = pBlackboard->GetData("Agent", pAgent);
+		bool success = pBlackboard->GetData(AgarioKeys::Agent, pAgent);
 		if (!success)
 			return;
 		AgarioFood* foodTarget{ nullptr };
-		success = pBlackboard->GetData("FoodTarget", foodTarget);
+		success = pBlackboard->GetData(AgarioKeys::FoodTarget, foodTarget);
 		if (!success || !foodTarget)
 			return;
 
 		pAgent->SetToSeek(foodTarget->GetPosition());
 	}
-	virtual void OnExit(Elite::Blackboard* pBlackboard) override
-	{
-		std::cout << "exiting seek" << std::endl << std::endl;
-	}
 };
 class FleeState : public Elite::FSMState
 {
 public:
 	virtual void OnEnter(Elite::Blackboard* pBlackboard) override
 	{
-		std::cout << "entering flee" << std::endl;
 		AgarioAgent* pAgent{ nullptr };
-		bool success = pBlackboard->GetData("Agent", pAgent);
+		bool success = pBlackboard->GetData(AgarioKeys::Agent, pAgent);
 		if (!success)
 			return;
-		AgarioAgent* enemyTarget{ nullptr };
-		success = pBlackboard->GetData("AgentFleeTarget", enemyTarget);
-		if (!success || !enemyTarget)
+		AgarioAgent* enemyTarget{ GetAgentTarget(pBlackboard) };
+		if (!enemyTarget)
 			return;
 
 		pAgent->SetToFlee(enemyTarget->GetPosition());
@@ -75,24 +86,22 @@ public:
 	virtual void Update(Elite::Blackboard* pBlackboard, float deltaTime) override
 	{
 		AgarioAgent* pAgent{ nullptr };
-		bool success = pBlackboard->GetData("Agent", pAgent);
+		bool success = pBlackboard->GetData(AgarioKeys::Agent, pAgent);
 		if (!success)
 			return;
-		AgarioAgent* enemyTarget{ nullptr };
-		success = pBlackboard->GetData("AgentFleeTarget", enemyTarget);
-		if (!success || !enemyTarget)
+		AgarioAgent* enemyTarget{ GetAgentTarget(pBlackboard) };
+		if (!enemyTarget)
 			return;
 
 		pAgent->SetToFlee(enemyTarget->GetPosition());
 	}
 	virtual void OnExit(Elite::Blackboard* pBlackboard) override
 	{
-		std::cout << "exiting flee" << std::endl << std::endl;
 		AgarioAgent* pAgent{ nullptr };
-		bool success = pBlackboard->GetData("Agent", pAgent);
+		bool success = pBlackboard->GetData(AgarioKeys::Agent, pAgent);
 		if (!success)
 			return;
-		pBlackboard->ChangeData("AgentFleeTarget", nullptr);
+		SetAgentTarget(pBlackboard, nullptr);
 	}
 };
 
@@ -101,14 +110,12 @@ class HuntState : public Elite::FSMState
 public:
 	virtual void OnEnter(Elite::Blackboard* pBlackboard) override
 	{
-		std::cout << "entering hunt" << std::endl;
 		AgarioAgent* pAgent{ nullptr };
-		bool success = pBlackboard->GetData("Agent", pAgent);
+		bool success = pBlackboard->GetData(AgarioKeys::Agent, pAgent);
 		if (!success)
 			return;
-		AgarioAgent* enemyTarget{ nullptr };
-		success = pBlackboard->GetData("AgentFleeTarget", enemyTarget);
-		if (!success || !enemyTarget)
+		AgarioAgent* enemyTarget{ GetAgentTarget(pBlackboard) };
+		if (!enemyTarget)
 			return;
 
 		pAgent->SetToSeek(enemyTarget->GetPosition());
@@ -116,24 +123,22 @@ public:
 	virtual void Update(Elite::Blackboard* pBlackboard, float deltaTime) override
 	{
 		AgarioAgent* pAgent{ nullptr };
-		bool success = pBlackboard->GetData("Agent", pAgent);
+		bool success = pBlackboard->GetData(AgarioKeys::Agent, pAgent);
 		if (!success)
 			return;
-		AgarioAgent* enemyTarget{ nullptr };
-		success = pBlackboard->GetData("AgentFleeTarget", enemyTarget);
-		if (!success || enemyTarget->CanBeDestroyed())
+		AgarioAgent* enemyTarget{ GetAgentTarget(pBlackboard) };
+		if (!enemyTarget)
 			return;
 
 		pAgent->SetToSeek(enemyTarget->GetPosition());
 	}
 	virtual void OnExit(Elite::Blackboard* pBlackboard) override
 	{
-		std::cout << "exiting hunt" << std::endl << std::endl;
 		/*AgarioAgent* pAgent{ nullptr };
-		bool success = pBlackboard->GetData("Agent", pAgent);
+		bool success = pBlackboard->GetData(AgarioKeys::Agent, pAgent);
 		if (!success)
 			return;
-		pBlackboard->ChangeData("AgentFleeTarget", nullptr);*/
+		pBlackboard->ChangeData(AgarioKeys::AgentFleeTarget, nullptr);*/
 	}
 };
 //-----------------
@@ -145,26 +150,23 @@ public:
 	bool ToTransition(Elite::Blackboard* pBlackboard) const override
 	{
 		AgarioAgent* pAgent{ nullptr };
-		bool success = pBlackboard->GetData("Agent", pAgent);
+		bool success = pBlackboard->GetData(AgarioKeys::Agent, pAgent);
 		if (!success)
 			return false;
 		std::vector<AgarioFood*>* foodTarget{ nullptr };
-		success = pBlackboard->GetData("FoodVec", foodTarget);
+		success = pBlackboard->GetData(AgarioKeys::FoodVec, foodTarget);
 		if (!success || !foodTarget)
 			return false;
+		AgarioEntityStore* pFoodStore{ nullptr };
+		success = pBlackboard->GetData(AgarioKeys::FoodStore, pFoodStore);
+		if (!success || !pFoodStore)
+			return false;
 
-		AgarioFood* temp{};
-		for (auto food : *foodTarget)
-		{
-			if (temp && Distance(pAgent->GetPosition(), temp->GetPosition()) > Distance(pAgent->GetPosition(), food->GetPosition()))
-				temp = food;
-			else if (!temp)
-				temp = food;
-		}
-
-		if (Distance(temp->GetPosition(), pAgent->GetPosition()) > 40.f)
+		const int closestFood = pFoodStore->QueryNearest(pAgent->GetPosition(), 40.f);
+		if (closestFood == Elite::ISpatialPartition::InvalidId)
 			return false;
-		pBlackboard->ChangeData("FoodTarget", temp);
+		pBlackboard->ChangeData(AgarioKeys::FoodTarget, (*foodTarget)[closestFood]);
+		pBlackboard->ChangeData(AgarioKeys::FoodTargetGeneration, (*foodTarget)[closestFood]->GetGeneration());
 		return true;
 	}
 };
@@ -175,16 +177,21 @@ public:
 	bool ToTransition(Elite::Blackboard* pBlackboard) const override
 	{
 		AgarioAgent* pAgent{ nullptr };
-		bool success = pBlackboard->GetData("Agent", pAgent);
+		bool success = pBlackboard->GetData(AgarioKeys::Agent, pAgent);
 		if (!success)
 			return false;
 
 		AgarioFood* foodTarget{ nullptr };
-		success = pBlackboard->GetData("FoodTarget", foodTarget);
+		success = pBlackboard->GetData(AgarioKeys::FoodTarget, foodTarget);
+		if (!success)
+			return false;
+		int foodTargetGeneration{ 0 };
+		success = pBlackboard->GetData(AgarioKeys::FoodTargetGeneration, foodTargetGeneration);
 		if (!success)
 			return false;
 
-		return foodTarget->CanBeDestroyed();
+		//Eaten food is recycled, so it can be alive again as another food item
+		return foodTarget->CanBeDestroyed() || foodTarget->GetGeneration() != foodTargetGeneration;
 	}
 };
 
@@ -194,26 +201,24 @@ public:
 	bool ToTransition(Elite::Blackboard* pBlackboard) const override
 	{
 		AgarioAgent* pAgent{ nullptr };
-		bool success = pBlackboard->GetData("Agent", pAgent);
+		bool success = pBlackboard->GetData(AgarioKeys::Agent, pAgent);
 		if (!success)
 			return false;
 		std::vector<AgarioAgent*>* enemyTarget{ nullptr };
-		success = pBlackboard->GetData("AgentsVec", enemyTarget);
+		success = pBlackboard->GetData(AgarioKeys::AgentsVec, enemyTarget);
 		if (!success || !enemyTarget)
 			return false;
+		AgarioEntityStore* pAgentStore{ nullptr };
+		success = pBlackboard->GetData(AgarioKeys::AgentsStore, pAgentStore);
+		if (!success || !pAgentStore)
+			return false;
 
-		AgarioAgent* temp{};
-		for (auto enemy : *enemyTarget)
-		{
-			if (temp && enemy->GetRadius() > pAgent->GetRadius() && Distance(pAgent->GetPosition(), temp->GetPosition()) > Distance(pAgent->GetPosition(), enemy->GetPosition()))
-				temp = enemy;
-			else if (!temp && enemy->GetRadius() > pAgent->GetRadius())
-				temp = enemy;
-		}
-		if (!temp)
+		//Closest bigger enemy in range
+		const int closestEnemy = pAgentStore->QueryNearest(pAgent->GetPosition(), pAgent->GetRadius() + 15.f, pAgent->GetRadius());
+		if (closestEnemy == Elite::ISpatialPartition::InvalidId)
 			return false;
-		pBlackboard->ChangeData("AgentFleeTarget", temp);
-		return Distance(temp->GetPosition(), pAgent->GetPosition()) < pAgent->GetRadius() + 15.f;
+		SetAgentTarget(pBlackboard, (*enemyTarget)[closestEnemy]);
+		return true;
 	}
 };
 
@@ -223,14 +228,14 @@ public:
 	bool ToTransition(Elite::Blackboard* pBlackboard) const override
 	{
 		AgarioAgent* pAgent{ nullptr };
-		bool success = pBlackboard->GetData("Agent", pAgent);
+		bool success = pBlackboard->GetData(AgarioKeys::Agent, pAgent);
 		if (!success)
 			return false;
 
-		AgarioAgent* fleeTarget{ nullptr };
-		success = pBlackboard->GetData("AgentFleeTarget", fleeTarget);
-		if (!success)
-			return false;
+		//Nothing left to flee from when it was eaten
+		AgarioAgent* fleeTarget{ GetAgentTarget(pBlackboard) };
+		if (!fleeTarget)
+			return true;
 
 		return Distance(fleeTarget->GetPosition(), pAgent->GetPosition()) > pAgent->GetRadius() + 15.f;
 	}
@@ -242,26 +247,24 @@ public:
 	bool ToTransition(Elite::Blackboard* pBlackboard) const override
 	{
 		AgarioAgent* pAgent{ nullptr };
-		bool success = pBlackboard->GetData("Agent", pAgent);
+		bool success = pBlackboard->GetData(AgarioKeys::Agent, pAgent);
 		if (!success)
 			return false;
 		std::vector<AgarioAgent*>* enemyTarget{ nullptr };
-		success = pBlackboard->GetData("AgentsVec", enemyTarget);
+		success = pBlackboard->GetData(AgarioKeys::AgentsVec, enemyTarget);
 		if (!success || !enemyTarget)
 			return false;
+		AgarioEntityStore* pAgentStore{ nullptr };
+		success = pBlackboard->GetData(AgarioKeys::AgentsStore, pAgentStore);
+		if (!success || !pAgentStore)
+			return false;
 
-		AgarioAgent* temp{};
-		for (auto enemy : *enemyTarget)
-		{
-			if (temp && enemy->GetRadius() + 1.f < pAgent->GetRadius() && Distance(pAgent->GetPosition(), temp->GetPosition()) > Distance(pAgent->GetPosition(), enemy->GetPosition()))
-				temp = enemy;
-			else if (!temp && enemy->GetRadius() + 1.f < pAgent->GetRadius())
-				temp = enemy;
-		}
-		if (!temp)
+		//Closest smaller enemy in range
+		const int closestEnemy = pAgentStore->QueryNearest(pAgent->GetPosition(), pAgent->GetRadius() + 15.f, -FLT_MAX, pAgent->GetRadius() - 1.f);
+		if (closestEnemy == Elite::ISpatialPartition::InvalidId)
 			return false;
-		pBlackboard->ChangeData("AgentFleeTarget", temp);
-		return Distance(temp->GetPosition(), pAgent->GetPosition()) < pAgent->GetRadius() + 15.f;
+		SetAgentTarget(pBlackboard, (*enemyTarget)[closestEnemy]);
+		return true;
 	}
 };
 
@@ -271,16 +274,12 @@ public:
 	bool ToTransition(Elite::Blackboard* pBlackboard) const override
 	{
 		AgarioAgent* pAgent{ nullptr };
-		bool success = pBlackboard->GetData("Agent", pAgent);
-		if (!success)
-			return false;
-
-		AgarioAgent* enemyTarget{ nullptr };
-		success = pBlackboard->GetData("AgentFleeTarget", enemyTarget);
+		bool success = pBlackboard->GetData(AgarioKeys::Agent, pAgent);
 		if (!success)
 			return false;
 
-		return enemyTarget->CanBeDestroyed();
+		//Eaten, possibly already recycled as another agent
+		return GetAgentTarget(pBlackboard) == nullptr;
 	}
 };
 
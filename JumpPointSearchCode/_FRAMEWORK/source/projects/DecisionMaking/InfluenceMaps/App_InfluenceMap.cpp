@@ -6,6 +6,7 @@ using namespace Elite;
 #include "App_InfluenceMap.h"
 #include "projects/Movement/SteeringBehaviors/SteeringAgent.h"
 #include "projects/Movement/SteeringBehaviors/Steering/SteeringBehaviors.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\EAStar.h"
 
 //Destructor
 App_InfluenceMap::~App_InfluenceMap()
@@ -26,9 +27,11 @@ void App_InfluenceMap::Start()
 	m_pInfluenceGrid = new InfluenceMap<InfluenceGrid>(false);
 	m_pInfluenceGrid->InitializeGrid(10, 10, 10, false, true);
 	m_pInfluenceGrid->InitializeBuffer();
+	m_pInfluenceGrid->SetWorkerPool(&m_WorkerPool);
 
 	m_pInfluenceGraph2D = new InfluenceMap<InfluenceGraph>(false);
 	m_pInfluenceGraph2D->InitializeBuffer();
+	m_pInfluenceGraph2D->SetWorkerPool(&m_WorkerPool);
 
 	m_GraphRenderer.SetNumberPrintPrecision(0);
 }
@@ -57,9 +60,31 @@ void App_InfluenceMap::Update(float deltaTime)
 			AddInfluenceOnMouseClick(InputMouseButton::eRight, -100);
 	}
 
+	//Middle mouse moves the start or end of the safest path
+	if (m_ShowSafestPath && !m_UseWaypointGraph && INPUTMANAGER->IsMouseButtonUp(InputMouseButton::eMiddle))
+	{
+		auto mouseData = INPUTMANAGER->GetMouseData(Elite::InputType::eMouseButton, InputMouseButton::eMiddle);
+		auto mousePos = DEBUGRENDERER2D->GetActiveCamera()->ConvertScreenToWorld(Vector2{ (float)mouseData.X, (float)mouseData.Y });
+		int nodeIdx = m_pInfluenceGrid->GetNodeIdxAtWorldPos(mousePos);
+		if (nodeIdx != invalid_node_index)
+		{
+			if (m_PathStartSelected)
+				m_PathStartIdx = nodeIdx;
+			else
+				m_PathEndIdx = nodeIdx;
+			m_PathStartSelected = !m_PathStartSelected;
+		}
+	}
+
 	m_pInfluenceGraph2D->PropagateInfluence(deltaTime);
 	m_pInfluenceGrid->PropagateInfluence(deltaTime);
 
+	//The influence changes every step, so the path is recalculated every frame (cheap on this small grid)
+	if (m_ShowSafestPath && !m_UseWaypointGraph)
+		CalculateSafestPath();
+	else
+		m_vPath.clear();
+
 
 	UpdateUI();
 }
@@ -106,6 +131,9 @@ void App_InfluenceMap::UpdateUI()
 	ImGui::Checkbox("Use waypoint graph", &m_UseWaypointGraph);
 	ImGui::Checkbox("Enable graph editing", &m_EditGraphEnabled);
 	ImGui::Checkbox("Render as graph", &m_RenderAsGraph);
+	ImGui::Checkbox("Async propagation", &m_AsyncPropagation);
+	ImGui::Checkbox("Safest path (MMB)", &m_ShowSafestPath);
+	ImGui::SliderFloat("Path avoidance", &m_PathAvoidance, 0.f, 1.f, "%.2f");
 
 	auto momentum = m_pInfluenceGrid->GetMomentum();
 	auto decay = m_pInfluenceGrid->GetDecay();
@@ -120,6 +148,7 @@ void App_InfluenceMap::UpdateUI()
 	m_pInfluenceGrid->SetMomentum(momentum);
 	m_pInfluenceGrid->SetDecay(decay);
 	m_pInfluenceGrid->SetPropagationInterval(propagationInterval);
+	m_pInfluenceGrid->SetAsyncPropagation(m_AsyncPropagation);
 
 	m_pInfluenceGraph2D->SetMomentum(momentum);
 	m_pInfluenceGraph2D->SetDecay(decay);
@@ -146,6 +175,9 @@ void App_InfluenceMap::Render(float deltaTime) const
 			m_GraphRenderer.RenderGraph(m_pInfluenceGrid,true, true);
 		else
 			m_GraphRenderer.RenderGraph(m_pInfluenceGrid, true, false, false, true);
+
+		if (m_vPath.size() > 0)
+			m_GraphRenderer.HighlightNodes(m_pInfluenceGrid, m_vPath);
 	}
 
 }
@@ -160,3 +192,15 @@ void App_InfluenceMap::AddInfluenceOnMouseClick(Elite::InputMouseButton mouseBtn
 	else
 		m_pInfluenceGrid->SetInfluenceAtPosition(mousePos, inf);
 }
+
+void App_InfluenceMap::CalculateSafestPath()
+{
+	m_vPath.clear();
+	if (!m_pInfluenceGrid->IsNodeValid(m_PathStartIdx) || !m_pInfluenceGrid->IsNodeValid(m_PathEndIdx) || m_PathStartIdx == m_PathEndIdx)
+		return;
+
+	//Negative influence (right click) costs extra to walk through, positive influence is clamped to no extra cost
+	auto pathfinder = AStar<InfluenceNode, GraphConnection>(m_pInfluenceGrid, HeuristicFunctions::Chebyshev);
+	pathfinder.SetCostField(m_pInfluenceGrid->GetCostField(0, -m_PathAvoidance));
+	m_vPath = pathfinder.FindPath(m_pInfluenceGrid->GetNode(m_PathStartIdx), m_pInfluenceGrid->GetNode(m_PathEndIdx));
+}
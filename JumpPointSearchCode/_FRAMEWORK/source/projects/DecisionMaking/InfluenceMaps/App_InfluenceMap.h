@@ -44,12 +44,24 @@ private:
 	Elite::InfluenceMap<InfluenceGraph>* m_pInfluenceGraph2D = nullptr;
 	Elite::GraphEditor m_GridEditor{};
 	Elite::GraphRenderer m_GraphRenderer{};
+	//Shared by both maps, one pool sized to the cores instead of one per map (their steps run one after the other)
+	Elite::WorkerPool m_WorkerPool{};
 
 	bool m_UseWaypointGraph = true;
 	bool m_EditGraphEnabled = true;
 	bool m_RenderAsGraph = false;
+	bool m_AsyncPropagation = false;
+
+	//Path over the grid that avoids negative influence, the channel is used as cost field of the pathfinder
+	bool m_ShowSafestPath = false;
+	bool m_PathStartSelected = true;
+	float m_PathAvoidance = 0.1f;
+	int m_PathStartIdx = 0;
+	int m_PathEndIdx = 99;
+	std::vector<Elite::InfluenceNode*> m_vPath;
 
 	void AddInfluenceOnMouseClick(Elite::InputMouseButton mouseBtn, float inf);
+	void CalculateSafestPath();
 private:
 	//C++ make the class non-copyable
 	App_InfluenceMap(const App_InfluenceMap&) = delete;
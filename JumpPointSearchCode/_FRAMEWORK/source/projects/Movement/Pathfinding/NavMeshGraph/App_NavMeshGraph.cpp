@@ -11,6 +11,7 @@ using namespace Elite;
 
 
 #include "framework\EliteAI\EliteNavigation\Algorithms\ENavGraphPathfinding.h"
+#include "framework\EliteHelpers\EMappedFile.h"
 
 //Statics
 bool App_NavMeshGraph::sShowPolygon = true;
@@ -18,6 +19,8 @@ bool App_NavMeshGraph::sShowGraph = false;
 bool App_NavMeshGraph::sDrawPortals = false;
 bool App_NavMeshGraph::sDrawFinalPath = true;
 bool App_NavMeshGraph::sDrawNonOptimisedPath = false;
+//Baked navigation graph, rebaked when the level it was baked from changed (see NavGraph::HashSource)
+const std::string App_NavMeshGraph::sBakedNavGraphPath = "../data/NavMeshGraph.navgraph";
 
 //Destructor
 App_NavMeshGraph::~App_NavMeshGraph()
@@ -26,6 +29,7 @@ App_NavMeshGraph::~App_NavMeshGraph()
 		SAFE_DELETE(pNC);
 	m_vNavigationColliders.clear();
 
+	SAFE_DELETE(m_pNavMeshSearch);
 	SAFE_DELETE(m_pNavGraph);
 	SAFE_DELETE(m_pSeekBehavior);
 	SAFE_DELETE(m_pArriveBehavior);
@@ -50,7 +54,27 @@ void App_NavMeshGraph::Start()
 	std::list<Elite::Vector2> baseBox
 	{ { -60, 30 },{ -60, -30 },{ 60, -30 },{ 60, 30 } };
 
-	m_pNavGraph = new Elite::NavGraph(Elite::Polygon(baseBox), m_AgentRadius);
+	//No obstacle expansion, the agent radius is applied per query so the same mesh serves every agent size
+	const Elite::Polygon contour{ baseBox };
+	const float playerRadius = 0.f;
+	const uint64_t sourceHash = Elite::NavGraph::HashSource(contour, playerRadius);
+
+	Elite::MappedFile bakedFile{};
+	Elite::NavGraphBlob bakedGraph{};
+	if (bakedFile.Open(sBakedNavGraphPath) && bakedGraph.Open(bakedFile.GetData(), bakedFile.GetSize())
+		&& bakedGraph.GetHeader().sourceHash == sourceHash)
+	{
+		m_pNavGraph = new Elite::NavGraph(bakedGraph);
+	}
+	else
+	{
+		if (bakedGraph.IsValid())
+			printf("WARNING: baked navigation graph is out of date, rebaking \n");
+		bakedFile.Close(); //Can't overwrite the file while it's mapped
+		m_pNavGraph = new Elite::NavGraph(contour, playerRadius);
+		m_pNavGraph->Bake(sBakedNavGraphPath);
+	}
+	m_pNavMeshSearch = new Elite::NavMeshSearch(m_pNavGraph);
 
 	//----------- AGENT ------------
 	m_pSeekBehavior = new Seek();
@@ -74,9 +98,13 @@ void App_NavMeshGraph::Update(float deltaTime)
 		auto mouseData = INPUTMANAGER->GetMouseData(Elite::InputType::eMouseButton, Elite::InputMouseButton::eMiddle);
 		Elite::Vector2 mouseTarget = DEBUGRENDERER2D->GetActiveCamera()->ConvertScreenToWorld(
 			Elite::Vector2((float)mouseData.X, (float)mouseData.Y));
-		m_vPath = NavMeshPathfinding::FindPath(m_pAgent->GetPosition(), mouseTarget, m_pNavGraph, m_DebugNodePositions, m_Portals);
+		m_vPath = NavMeshPathfinding::FindPath(m_pAgent->GetPosition(), mouseTarget, *m_pNavMeshSearch, m_AgentRadius, m_DebugNodePositions, m_Portals);
 	}
 
+	//Lookahead: skip path points once a later one is directly reachable (e.g. after being pushed off the path)
+	while (m_vPath.size() > 1 && m_pNavGraph->HasLineOfSight(m_pAgent->GetPosition(), m_vPath[1], m_AgentRadius))
+		m_vPath.erase(m_vPath.begin());
+
 	//Check if a path exist and move to the following point
 	if (m_vPath.size() > 0)
 	{
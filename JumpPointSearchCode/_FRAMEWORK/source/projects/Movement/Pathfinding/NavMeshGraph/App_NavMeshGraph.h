@@ -8,6 +8,7 @@
 
 #include "framework\EliteAI\EliteGraphs\EliteGraphUtilities\EGraphRenderer.h"
 #include "framework\EliteAI\EliteNavigation\Algorithms\EPathSmoothing.h"
+#include "framework\EliteAI\EliteNavigation\Algorithms\ENavMeshSearch.h"
 
 class NavigationColliderElement;
 class SteeringAgent;
@@ -51,6 +52,7 @@ private:
 
 	// --Graph--
 	Elite::NavGraph* m_pNavGraph = nullptr;
+	Elite::NavMeshSearch* m_pNavMeshSearch = nullptr; //Reused for every path on m_pNavGraph
 	Elite::GraphRenderer m_GraphRenderer{};
 
 	// --Debug drawing information--
@@ -61,6 +63,7 @@ private:
 	static bool sDrawPortals;
 	static bool sDrawFinalPath;
 	static bool sDrawNonOptimisedPath;
+	static const std::string sBakedNavGraphPath;
 
 	void UpdateImGui();
 private:
@@ -3,7 +3,7 @@
 #include <algorithm>
 #include "../SteeringAgent.h"
 
-BlendedSteering::BlendedSteering(vector<WeightedBehavior> weightedBehaviors)
+BlendedSteering::BlendedSteering(const vector<WeightedBehavior>& weightedBehaviors)
 	:m_WeightedBehaviors(weightedBehaviors)
 {
 };
@@ -15,9 +15,9 @@ SteeringOutput BlendedSteering::CalculateSteering(float deltaT, SteeringAgent* p
 	SteeringOutput blendedSteering = {};
 	auto totalWeight = 0.f;
 
-	for (auto weightedBehavior : m_WeightedBehaviors)
+	for (const WeightedBehavior& weightedBehavior : m_WeightedBehaviors)
 	{
-		auto steering = weightedBehavior.pBehavior->CalculateSteering(deltaT, pAgent);
+		const SteeringOutput steering = weightedBehavior.pBehavior->CalculateSteering(deltaT, pAgent);
 		blendedSteering.LinearVelocity += weightedBehavior.weight * steering.LinearVelocity;
 		blendedSteering.AngularVelocity += weightedBehavior.weight * steering.AngularVelocity;
 
@@ -30,19 +30,41 @@ SteeringOutput BlendedSteering::CalculateSteering(float deltaT, SteeringAgent* p
 		blendedSteering *= scale;
 	}
 
-	if (pAgent->CanRenderBehavior())
-		DEBUGRENDERER2D->DrawDirection(pAgent->GetPosition(), blendedSteering.LinearVelocity, 7, { 0, 1, 1 }, 0.40f);
-
 	return blendedSteering;
 }
 
+void BlendedSteering::RenderDebug(const SteeringAgent* pAgent) const
+{
+	for (const WeightedBehavior& weightedBehavior : m_WeightedBehaviors)
+		weightedBehavior.pBehavior->RenderDebug(pAgent);
+}
+
+bool BlendedSteering::Compile(SteeringProgram& program, const float* pWeight) const
+{
+	//A blend inside of a blend would need its own normalization
+	if (program.IsBlending())
+		return false;
+
+	const bool isOwnStage{ !program.IsInStage() };
+	if (isOwnStage)
+		program.BeginStage(true);
+
+	bool isCompiled{ true };
+	for (const WeightedBehavior& weightedBehavior : m_WeightedBehaviors)
+		isCompiled = isCompiled && weightedBehavior.pBehavior->Compile(program, &weightedBehavior.weight);
+
+	if (isOwnStage)
+		program.EndStage();
+	return isCompiled;
+}
+
 //*****************
 //PRIORITY STEERING
 SteeringOutput PrioritySteering::CalculateSteering(float deltaT, SteeringAgent* pAgent)
 {
 	SteeringOutput steering = {};
 
-	for (auto pBehavior : m_PriorityBehaviors)
+	for (ISteeringBehavior* pBehavior : m_PriorityBehaviors)
 	{
 		steering = pBehavior->CalculateSteering(deltaT, pAgent);
 
@@ -52,4 +74,24 @@ SteeringOutput PrioritySteering::CalculateSteering(float deltaT, SteeringAgent*
 
 	//If non of the behavior return a valid output, last behavior is returned
 	return steering;
-}
\ No newline at end of file
+}
+
+void PrioritySteering::RenderDebug(const SteeringAgent* pAgent) const
+{
+	for (const ISteeringBehavior* pBehavior : m_PriorityBehaviors)
+		pBehavior->RenderDebug(pAgent);
+}
+
+bool PrioritySteering::Compile(SteeringProgram& program, const float* pWeight) const
+{
+	//Every behavior is a stage of the program, so a priority can't be part of a stage itself
+	if (program.IsInStage())
+		return false;
+
+	for (const ISteeringBehavior* pBehavior : m_PriorityBehaviors)
+	{
+		if (!pBehavior->Compile(program, nullptr))
+			return false;
+	}
+	return true;
+}
@@ -19,10 +19,12 @@ public:
 		{};
 	};
 
-	BlendedSteering(vector<WeightedBehavior> weightedBehaviors);
+	BlendedSteering(const vector<WeightedBehavior>& weightedBehaviors);
 
-	void AddBehaviour(WeightedBehavior weightedBehavior) { m_WeightedBehaviors.push_back(weightedBehavior); }
+	void AddBehaviour(const WeightedBehavior& weightedBehavior) { m_WeightedBehaviors.push_back(weightedBehavior); }
 	SteeringOutput CalculateSteering(float deltaT, SteeringAgent* pAgent) override;
+	void RenderDebug(const SteeringAgent* pAgent) const override;
+	bool Compile(SteeringProgram& program, const float* pWeight) const override;
 
 	// returns a reference to the weighted behaviors, can be used to adjust weighting. Is not intended to alter the behaviors themselves.
 	vector<WeightedBehavior>& GetWeightedBehaviorsRef() { return m_WeightedBehaviors; }
@@ -36,12 +38,14 @@ private:
 class PrioritySteering final: public ISteeringBehavior
 {
 public:
-	PrioritySteering(vector<ISteeringBehavior*> priorityBehaviors) 
+	PrioritySteering(const vector<ISteeringBehavior*>& priorityBehaviors) 
 		:m_PriorityBehaviors(priorityBehaviors) 
 	{}
 
 	void AddBehaviour(ISteeringBehavior* pBehavior) { m_PriorityBehaviors.push_back(pBehavior); }
 	SteeringOutput CalculateSteering(float deltaT, SteeringAgent* pAgent) override;
+	void RenderDebug(const SteeringAgent* pAgent) const override;
+	bool Compile(SteeringProgram& program, const float* pWeight) const override;
 
 private:
 	vector<ISteeringBehavior*> m_PriorityBehaviors = {};
@@ -32,6 +32,7 @@ private:
 	
 	float m_TrimWorldSize = 200.f;
 	int m_FlockSize = 6000;
+	uint64_t m_RandomSeed = 1; //Set as the world seed on start, the same seed gives the same flock
 
 	Flock* m_pFlock = nullptr;
 
@@ -0,0 +1,166 @@
+#include "stdafx.h"
+#include "FlockKernel.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FLOCK_KERNEL_AVX2
+#elif defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define FLOCK_KERNEL_SSE2
+#endif
+
+namespace
+{
+	// Sums over the neighbors of one agent
+	struct NeighborSums
+	{
+		float positionX = 0.f;
+		float positionY = 0.f;
+		float velocityX = 0.f;
+		float velocityY = 0.f;
+		float separationX = 0.f; // Sum of (agent - neighbor) / distance^2
+		float separationY = 0.f;
+	};
+
+#if defined(FLOCK_KERNEL_AVX2)
+	float HorizontalSum(__m256 v)
+	{
+		__m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+		return _mm_cvtss_f32(sum);
+	}
+#elif defined(FLOCK_KERNEL_SSE2)
+	float HorizontalSum(__m128 v)
+	{
+		__m128 sum = _mm_add_ps(v, _mm_movehl_ps(v, v));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+		return _mm_cvtss_f32(sum);
+	}
+
+	__m128 Gather(const float* pData, const int* pIndices)
+	{
+		return _mm_set_ps(pData[pIndices[3]], pData[pIndices[2]], pData[pIndices[1]], pData[pIndices[0]]);
+	}
+#endif
+}
+
+void FlockKernel::Resize(int nrOfAgents)
+{
+	m_PositionsX.resize(nrOfAgents, 0.f);
+	m_PositionsY.resize(nrOfAgents, 0.f);
+	m_VelocitiesX.resize(nrOfAgents, 0.f);
+	m_VelocitiesY.resize(nrOfAgents, 0.f);
+}
+
+void FlockKernel::SetAgent(int idx, const Elite::Vector2& position, const Elite::Vector2& velocity)
+{
+	m_PositionsX[idx] = position.x;
+	m_PositionsY[idx] = position.y;
+	m_VelocitiesX[idx] = velocity.x;
+	m_VelocitiesY[idx] = velocity.y;
+}
+
+Elite::Vector2 FlockKernel::CalculateSteering(int agentIdx, const int* pNeighbors, int nrOfNeighbors, float maxSpeed, const Weights& weights) const
+{
+	const float* pPositionsX = m_PositionsX.data();
+	const float* pPositionsY = m_PositionsY.data();
+	const float* pVelocitiesX = m_VelocitiesX.data();
+	const float* pVelocitiesY = m_VelocitiesY.data();
+	const float x = pPositionsX[agentIdx];
+	const float y = pPositionsY[agentIdx];
+
+	NeighborSums sums{};
+	int i = 0;
+#if defined(FLOCK_KERNEL_AVX2)
+	const __m256 agentX = _mm256_set1_ps(x);
+	const __m256 agentY = _mm256_set1_ps(y);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.f);
+	__m256 positionX = zero, positionY = zero, velocityX = zero, velocityY = zero, separationX = zero, separationY = zero;
+	for (; i + 8 <= nrOfNeighbors; i += 8)
+	{
+		const __m256i indices = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pNeighbors + i));
+		const __m256 neighborX = _mm256_i32gather_ps(pPositionsX, indices, 4);
+		const __m256 neighborY = _mm256_i32gather_ps(pPositionsY, indices, 4);
+		positionX = _mm256_add_ps(positionX, neighborX);
+		positionY = _mm256_add_ps(positionY, neighborY);
+		velocityX = _mm256_add_ps(velocityX, _mm256_i32gather_ps(pVelocitiesX, indices, 4));
+		velocityY = _mm256_add_ps(velocityY, _mm256_i32gather_ps(pVelocitiesY, indices, 4));
+
+		// Neighbors on top of the agent have no direction to push in and are skipped
+		const __m256 deltaX = _mm256_sub_ps(agentX, neighborX);
+		const __m256 deltaY = _mm256_sub_ps(agentY, neighborY);
+		const __m256 distanceSquared = _mm256_add_ps(_mm256_mul_ps(deltaX, deltaX), _mm256_mul_ps(deltaY, deltaY));
+		const __m256 isApart = _mm256_cmp_ps(distanceSquared, zero, _CMP_GT_OQ);
+		const __m256 inverse = _mm256_and_ps(isApart, _mm256_div_ps(one, distanceSquared));
+		separationX = _mm256_add_ps(separationX, _mm256_mul_ps(deltaX, inverse));
+		separationY = _mm256_add_ps(separationY, _mm256_mul_ps(deltaY, inverse));
+	}
+	sums.positionX = HorizontalSum(positionX);
+	sums.positionY = HorizontalSum(positionY);
+	sums.velocityX = HorizontalSum(velocityX);
+	sums.velocityY = HorizontalSum(velocityY);
+	sums.separationX = HorizontalSum(separationX);
+	sums.separationY = HorizontalSum(separationY);
+#elif defined(FLOCK_KERNEL_SSE2)
+	const __m128 agentX = _mm_set1_ps(x);
+	const __m128 agentY = _mm_set1_ps(y);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.f);
+	__m128 positionX = zero, positionY = zero, velocityX = zero, velocityY = zero, separationX = zero, separationY = zero;
+	for (; i + 4 <= nrOfNeighbors; i += 4)
+	{
+		const __m128 neighborX = Gather(pPositionsX, pNeighbors + i);
+		const __m128 neighborY = Gather(pPositionsY, pNeighbors + i);
+		positionX = _mm_add_ps(positionX, neighborX);
+		positionY = _mm_add_ps(positionY, neighborY);
+		velocityX = _mm_add_ps(velocityX, Gather(pVelocitiesX, pNeighbors + i));
+		velocityY = _mm_add_ps(velocityY, Gather(pVelocitiesY, pNeighbors + i));
+
+		// Neighbors on top of the agent have no direction to push in and are skipped
+		const __m128 deltaX = _mm_sub_ps(agentX, neighborX);
+		const __m128 deltaY = _mm_sub_ps(agentY, neighborY);
+		const __m128 distanceSquared = _mm_add_ps(_mm_mul_ps(deltaX, deltaX), _mm_mul_ps(deltaY, deltaY));
+		const __m128 isApart = _mm_cmpgt_ps(distanceSquared, zero);
+		const __m128 inverse = _mm_and_ps(isApart, _mm_div_ps(one, distanceSquared));
+		separationX = _mm_add_ps(separationX, _mm_mul_ps(deltaX, inverse));
+		separationY = _mm_add_ps(separationY, _mm_mul_ps(deltaY, inverse));
+	}
+	sums.positionX = HorizontalSum(positionX);
+	sums.positionY = HorizontalSum(positionY);
+	sums.velocityX = HorizontalSum(velocityX);
+	sums.velocityY = HorizontalSum(velocityY);
+	sums.separationX = HorizontalSum(separationX);
+	sums.separationY = HorizontalSum(separationY);
+#endif
+	for (; i < nrOfNeighbors; ++i)
+	{
+		const int neighbor = pNeighbors[i];
+		sums.positionX += pPositionsX[neighbor];
+		sums.positionY += pPositionsY[neighbor];
+		sums.velocityX += pVelocitiesX[neighbor];
+		sums.velocityY += pVelocitiesY[neighbor];
+
+		const float deltaX = x - pPositionsX[neighbor];
+		const float deltaY = y - pPositionsY[neighbor];
+		const float distanceSquared = deltaX * deltaX + deltaY * deltaY;
+		if (distanceSquared > 0.f)
+		{
+			sums.separationX += deltaX / distanceSquared;
+			sums.separationY += deltaY / distanceSquared;
+		}
+	}
+
+	// Same as the behaviors: averages are zero without neighbors (so cohesion heads for the origin)
+	// and the separation average is only normalized, so it doesn't need the division
+	const float inverseNrOfNeighbors = nrOfNeighbors > 0 ? 1.f / nrOfNeighbors : 0.f;
+	Elite::Vector2 separation{ sums.separationX, sums.separationY };
+	Elite::Vector2 cohesion{ sums.positionX * inverseNrOfNeighbors - x, sums.positionY * inverseNrOfNeighbors - y };
+	Elite::Vector2 velocityMatch{ sums.velocityX * inverseNrOfNeighbors, sums.velocityY * inverseNrOfNeighbors };
+	separation.Normalize();
+	cohesion.Normalize();
+	velocityMatch.Normalize();
+
+	return maxSpeed * (weights.separation * separation + weights.cohesion * cohesion + weights.velocityMatch * velocityMatch);
+}
@@ -0,0 +1,36 @@
+#pragma once
+// FlockKernel.h: Separation, Cohesion and VelocityMatch of a whole flock fused in one pass.
+// Positions and velocities are stored as SoA (one float array per component), every agent's neighbors are summed
+// with SIMD (AVX2 gathers or SSE2 when available) and the three forces are blended right away, without going through
+// the flocking behaviors.
+#include <vector>
+#include "framework\EliteMath\EVector2.h"
+
+class FlockKernel final
+{
+public:
+	struct Weights
+	{
+		float separation = 0.f;
+		float cohesion = 0.f;
+		float velocityMatch = 0.f;
+	};
+
+	FlockKernel() = default;
+
+	void Resize(int nrOfAgents);
+	int GetNrOfAgents() const { return int(m_PositionsX.size()); }
+
+	void SetAgent(int idx, const Elite::Vector2& position, const Elite::Vector2& velocity);
+	Elite::Vector2 GetPosition(int idx) const { return { m_PositionsX[idx], m_PositionsY[idx] }; }
+	Elite::Vector2 GetVelocity(int idx) const { return { m_VelocitiesX[idx], m_VelocitiesY[idx] }; }
+
+	// Weighted sum (not divided by the total weight) of the three forces, each scaled to maxSpeed like the behaviors do
+	Elite::Vector2 CalculateSteering(int agentIdx, const int* pNeighbors, int nrOfNeighbors, float maxSpeed, const Weights& weights) const;
+
+private:
+	std::vector<float> m_PositionsX;
+	std::vector<float> m_PositionsY;
+	std::vector<float> m_VelocitiesX;
+	std::vector<float> m_VelocitiesY;
+};
@@ -4,25 +4,37 @@
 #include "../SteeringAgent.h"
 #include "../SteeringHelpers.h"
 
+namespace
+{
+	bool CompileExternal(SteeringProgram& program, const float* pWeight)
+	{
+		SteeringProgram::Entry entry{};
+		entry.kind = SteeringProgram::Kind::External;
+		entry.pWeight = pWeight;
+		program.AddEntry(entry);
+		return true;
+	}
+}
+
 //*******************
 //COHESION (FLOCKING)
 SteeringOutput Cohesion::CalculateSteering(float deltaT, SteeringAgent* pAgent)
 {
 	SteeringOutput steering{};
 
-	m_Target = m_pFlock->GetAverageNeighborPos();
-
-	steering.LinearVelocity = m_Target.Position - pAgent->GetPosition();
+	// Called for many agents at once, so the target is not stored
+	steering.LinearVelocity = m_pFlock->GetAverageNeighborPos() - pAgent->GetPosition();
 	steering.LinearVelocity.Normalize();
 	steering.LinearVelocity *= pAgent->GetMaxLinearSpeed();
 
-	// Debug rendering
-	if (pAgent->CanRenderBehavior())
-		DEBUGRENDERER2D->DrawDirection(pAgent->GetPosition(), steering.LinearVelocity, 5.f, { 0, 1, 0, 0.5f }, 0.4f);
-
 	return steering;
 }
 
+bool Cohesion::Compile(SteeringProgram& program, const float* pWeight) const
+{
+	return CompileExternal(program, pWeight);
+}
+
 
 //*********************
 //SEPARATION (FLOCKING)
@@ -31,9 +43,9 @@ SteeringOutput Separation::CalculateSteering(float deltaT, SteeringAgent* pAgent
 	Elite::Vector2 vectorSum{};
 	SteeringOutput steering{};
 
-	for (size_t i{0}; i < (size_t)m_pFlock->GetNrOfNeighbors(); ++i)
+	for (int i{0}; i < m_pFlock->GetNrOfNeighbors(); ++i)
 	{
-		Elite::Vector2 target{ pAgent->GetPosition() - m_pFlock->GetNeighbors()[i]->GetPosition() };
+		Elite::Vector2 target{ pAgent->GetPosition() - m_pFlock->GetNeighborPosition(i) };
 		float inverse{ 1.f / target.Magnitude() };
 		inverse *= inverse;
 
@@ -47,13 +59,14 @@ SteeringOutput Separation::CalculateSteering(float deltaT, SteeringAgent* pAgent
 	steering.LinearVelocity.Normalize();
 	steering.LinearVelocity *= pAgent->GetMaxLinearSpeed();
 
-	// Debug rendering
-	if (pAgent->CanRenderBehavior())
-		DEBUGRENDERER2D->DrawDirection(pAgent->GetPosition(), steering.LinearVelocity, 5.f, { 0, 1, 0, 0.5f }, 0.4f);
-
 	return steering;
 }
 
+bool Separation::Compile(SteeringProgram& program, const float* pWeight) const
+{
+	return CompileExternal(program, pWeight);
+}
+
 
 //*************************
 //VELOCITY MATCH (FLOCKING)
@@ -67,9 +80,10 @@ SteeringOutput VelocityMatch::CalculateSteering(float deltaT, SteeringAgent* pAg
 	steering.LinearVelocity.Normalize();
 	steering.LinearVelocity *= pAgent->GetMaxLinearSpeed();
 
-	// Debug rendering
-	if (pAgent->CanRenderBehavior())
-		DEBUGRENDERER2D->DrawDirection(pAgent->GetPosition(), steering.LinearVelocity, 5.f, { 0, 1, 0, 0.5f }, 0.4f);
-
 	return steering;
 }
+
+bool VelocityMatch::Compile(SteeringProgram& program, const float* pWeight) const
+{
+	return CompileExternal(program, pWeight);
+}
@@ -11,6 +11,8 @@ public:
 
 	//Cohesion Behavior
 	SteeringOutput CalculateSteering(float deltaT, SteeringAgent* pAgent) override;
+	//Calculated by the flock kernel, the program gets it as external steering
+	bool Compile(SteeringProgram& program, const float* pWeight) const override;
 
 private:
 	Flock* m_pFlock = nullptr;
@@ -26,6 +28,8 @@ public:
 
 	//Cohesion Behavior
 	SteeringOutput CalculateSteering(float deltaT, SteeringAgent* pAgent) override;
+	//Calculated by the flock kernel, the program gets it as external steering
+	bool Compile(SteeringProgram& program, const float* pWeight) const override;
 
 private:
 	Flock* m_pFlock = nullptr;
@@ -41,7 +45,10 @@ public:
 
 	//Cohesion Behavior
 	SteeringOutput CalculateSteering(float deltaT, SteeringAgent* pAgent) override;
+	//Calculated by the flock kernel, the program gets it as external steering
+	bool Compile(SteeringProgram& program, const float* pWeight) const override;
 
 private:
 	Flock* m_pFlock = nullptr;
 };
+
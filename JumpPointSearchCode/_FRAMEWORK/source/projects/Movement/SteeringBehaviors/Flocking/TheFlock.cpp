@@ -5,6 +5,8 @@
 #include "../Steering/SteeringBehaviors.h"
 #include "../CombinedSteering/CombinedSteeringBehaviors.h"
 
+thread_local Flock::Neighborhood Flock::s_Neighborhood{};
+
 //Constructor & Destructor
 Flock::Flock(
 	int flockSize /*= 50*/, 
@@ -17,7 +19,6 @@ Flock::Flock(
 	, m_TrimWorld { trimWorld }
 	, m_pAgentToEvade{pAgentToEvade}
 	, m_NeighborhoodRadius{ 5 }
-	, m_NrOfNeighbors{0}
 {
 	m_Agents.resize(m_FlockSize);
 
@@ -28,7 +29,9 @@ Flock::Flock(
 	m_pSeekBehavior = new Seek();
 	m_pWanderBehavior = new Wander();
 	m_pWanderBehavior->SetWanderOffset(20);
-	m_pBlendedSteering = new BlendedSteering({ {m_pSeparationBehavior, 0.7f}, {m_pCohesionBehavior, 0.5f}, {m_pVelMatchBehavior, 0.5f}, {m_pSeekBehavior, 0.f}, {m_pWanderBehavior, 0.5f} });
+	m_pFlockWanderBehavior = new Wander();
+	m_pFlockWanderBehavior->SetWanderOffset(20);
+	m_pBlendedSteering = new BlendedSteering({ {m_pSeparationBehavior, 0.7f}, {m_pCohesionBehavior, 0.5f}, {m_pVelMatchBehavior, 0.5f}, {m_pSeekBehavior, 0.f}, {m_pFlockWanderBehavior, 0.5f} });
 	m_pEvadeBehavior = new Evade();
 	m_pEvadeBehavior->SetEvadeRadius(15.f);
 	m_pPrioritySteering = new PrioritySteering({ m_pEvadeBehavior, m_pBlendedSteering });
@@ -42,6 +45,7 @@ Flock::Flock(
 
 	m_pCellSpace = new CellSpace(m_WorldSize * 2, m_WorldSize * 2, 25, 25, m_FlockSize);
 
+	Elite::RandomStream spawnRandom{};
 	for (size_t i{ 0 }; i < (size_t)m_FlockSize; ++i)
 	{
 		m_Agents[i] = new SteeringAgent();
@@ -54,13 +58,20 @@ Flock::Flock(
 		//m_Agents[i]->SetMaxLinearSpeed(15.f);
 		//m_Agents[i]->SetMass(1.f);
 		m_Agents[i]->SetAutoOrient(true);
-		m_Agents[i]->SetPosition({ float(rand() % int(m_WorldSize*2.f)) - m_WorldSize, float(rand() % int(m_WorldSize * 2.f)) - m_WorldSize });
+		m_Agents[i]->SetPosition({ float(spawnRandom.NextInt(int(m_WorldSize * 2.f))) - m_WorldSize, float(spawnRandom.NextInt(int(m_WorldSize * 2.f))) - m_WorldSize });
 
 		m_pCellSpace->AddAgent(m_Agents[i]);
-		m_OldPositions.push_back(m_Agents[i]->GetPosition());
 	}
+	m_pCellSpace->UpdateBins();
+
+	m_Kernel.Resize(m_FlockSize);
+	m_Steering.resize(m_FlockSize);
+	m_FlockSteering.resize(m_FlockSize);
 
-	m_Neighbors.resize(m_FlockSize);
+	// Weights and targets are read live, so only a new behavior needs a new compile
+	if (!m_Program.Compile(m_pPrioritySteering))
+		printf("WARNING: flock steering can't be compiled to a steering program \n");
+	m_Program.SetNrOfAgents(m_FlockSize);
 }
 
 Flock::~Flock()
@@ -75,9 +86,11 @@ Flock::~Flock()
 	SAFE_DELETE(m_pVelMatchBehavior);
 	SAFE_DELETE(m_pSeekBehavior);
 	SAFE_DELETE(m_pWanderBehavior);
+	SAFE_DELETE(m_pFlockWanderBehavior);
 	SAFE_DELETE(m_pEvadeBehavior);
 	SAFE_DELETE(m_pAgentToEvade);
 	SAFE_DELETE(m_pCellSpace);
+	SAFE_DELETE(m_pPartition);
 
 	for(auto pAgent: m_Agents)
 	{
@@ -88,11 +101,9 @@ Flock::~Flock()
 
 void Flock::Update(float deltaT)
 {
-	// TODO: update the flock
-	// loop over all the agents
-		// register its neighbors	(-> memory pool is filled with neighbors of the currently evaluated agent)
-		// update it				(-> the behaviors can use the neighbors stored in the pool, next iteration they will be the next agent's neighbors)
-		// trim it to the world
+	// The update has two phases:
+		// calculate the steering of every agent from a snapshot of the flock (in parallel, nothing moves yet)
+		// apply the steering to every agent and trim it to the world
 	m_pAgentToEvade->Update(deltaT);
 
 	TargetData evadeTarget;
@@ -101,59 +112,80 @@ void Flock::Update(float deltaT)
 
 	m_pEvadeBehavior->SetTarget(evadeTarget);
 
-	for (size_t i{ 0 }; i<m_Agents.size(); ++i)
+	const int nrOfAgents{ int(m_Agents.size()) };
+	for (int i{ 0 }; i < nrOfAgents; ++i)
+		m_Kernel.SetAgent(i, m_Agents[i]->GetPosition(), m_Agents[i]->GetLinearVelocity());
+
+	if (m_UseSpacePar)
 	{
-		if (!m_UseSpacePar)
+		if (m_pPartition)
 		{
-			RegisterNeighbors(m_Agents[i]);
+			for (int i{ 0 }; i < nrOfAgents; ++i)
+				m_pPartition->Move(i, m_Kernel.GetPosition(i), 0.f);
 		}
 		else
 		{
-			m_pCellSpace->RegisterNeighbors(m_Agents[i], m_NeighborhoodRadius);
-			m_Neighbors = m_pCellSpace->GetNeighbors();
-			m_NrOfNeighbors = m_pCellSpace->GetNrOfNeighbors();
+			m_pCellSpace->UpdateBins();
 		}
-		m_Agents[i]->Update(deltaT);
+	}
+
+	FlockKernel::Weights flockWeights{};
+	flockWeights.separation = *GetWeight(m_pSeparationBehavior);
+	flockWeights.cohesion = *GetWeight(m_pCohesionBehavior);
+	flockWeights.velocityMatch = *GetWeight(m_pVelMatchBehavior);
+
+	m_WorkerPool.ParallelFor(nrOfAgents, [this, deltaT, &flockWeights](int first, int end) { CalculateSteering(first, end, deltaT, flockWeights); });
+
+	for (int i{ 0 }; i < nrOfAgents; ++i)
+	{
+		m_Agents[i]->ApplySteering(m_Steering[i], deltaT);
 
 		if (m_TrimWorld)
 			m_Agents[i]->TrimToWorld(m_WorldSize);
 
-		if (m_UseSpacePar)
-		{
-			m_pCellSpace->UpdateAgentCell(m_Agents[i], m_OldPositions[i]);
-			m_OldPositions[i] = m_Agents[i]->GetPosition();
-		}
+		m_Agents[i]->SetBodyColor(Elite::Color{ 1,1,0 });
+	}
 
-		// Debug Update
-		if (m_CanDebugRender)
-		{
-			if (i != 0)
-			{
-				m_Agents[i]->SetBodyColor(Elite::Color{ 1,1,0 });
-				for (size_t j{ 0 }; j < (size_t)m_NrOfNeighbors; ++j)
-				{
-					if (m_Neighbors[j] == m_Agents[0])
-					{
-						m_Agents[i]->SetBodyColor(Elite::Color{ 0,1,0 });
-						break;
-					}
-				}
-			}
-			else
-			{
-				AverageNeighborPosDebug = GetAverageNeighborPos();
-				AverageNeighborVelDebug = GetAverageNeighborVelocity();
-				m_pCellSpace->SetDebugValues(m_Agents[i], m_NeighborhoodRadius);
-			}
-		}
-		else
-			m_Agents[i]->SetBodyColor(Elite::Color{ 1,1,0 });
+	// Debug Update
+	if (m_CanDebugRender && nrOfAgents > 0)
+	{
+		for (int neighbor : m_DebugNeighbors)
+			m_Agents[neighbor]->SetBodyColor(Elite::Color{ 0,1,0 });
+
+		if (!m_pPartition)
+			m_pCellSpace->SetDebugValues(m_Agents[0], m_NeighborhoodRadius);
 	}
 
 	if (m_TrimWorld)
 		m_pAgentToEvade->TrimToWorld(m_WorldSize);
 }
 
+void Flock::CalculateSteering(int firstAgent, int endAgent, float deltaT, const FlockKernel::Weights& flockWeights)
+{
+	// The flocking part of the blend is done by the kernel and passed to the program, which runs the priority steering
+	// Scratch of this chunk, the neighborhood is thread local so the behaviors of other chunks don't see it
+	std::vector<CellSpace::Neighbor> nearest;
+	std::vector<int> neighbors;
+	for (int i{ firstAgent }; i < endAgent; ++i)
+	{
+		neighbors.clear();
+		FindNeighbors(i, nearest, neighbors);
+		s_Neighborhood = { i, neighbors.data(), int(neighbors.size()) };
+
+		m_FlockSteering[i] = m_Kernel.CalculateSteering(i, neighbors.data(), int(neighbors.size()), m_Agents[i]->GetMaxLinearSpeed(), flockWeights);
+
+		if (i == 0 && m_CanDebugRender)
+		{
+			m_DebugNeighbors = neighbors;
+			AverageNeighborPosDebug = GetAverageNeighborPos();
+			AverageNeighborVelDebug = GetAverageNeighborVelocity();
+		}
+	}
+	s_Neighborhood = {};
+
+	m_Program.Evaluate(deltaT, m_Agents.data(), firstAgent, endAgent, m_Steering.data(), m_FlockSteering.data());
+}
+
 void Flock::Render(float deltaT)
 {
 	if (m_TrimWorld)
@@ -174,7 +206,9 @@ void Flock::Render(float deltaT)
 	{
 		DEBUGRENDERER2D->DrawCircle(m_Agents[0]->GetPosition(), m_NeighborhoodRadius, Elite::Color{ 1,0,0,1 }, 0.4f);
 		DEBUGRENDERER2D->DrawDirection(m_Agents[0]->GetPosition(), m_Agents[0]->GetLinearVelocity(), 4.f, Elite::Color{ 0,1,0,1 }, 0.4f);
-		m_pCellSpace->RenderCells();
+		m_Program.RenderDebug(m_Agents[0], 0, m_Steering[0]);
+		if (m_UseSpacePar && !m_pPartition)
+			m_pCellSpace->RenderCells();
 	}
 
 	/*for (auto pAgent : m_Agents)
@@ -183,16 +217,67 @@ void Flock::Render(float deltaT)
 	}*/
 }
 
-void Flock::RegisterNeighbors(SteeringAgent* pAgent)
+void Flock::FindNeighbors(int agentIdx, std::vector<CellSpace::Neighbor>& nearest, std::vector<int>& neighbors) const
 {
-	m_NrOfNeighbors = 0;
-	for (auto neighbor : m_Agents)
+	const Elite::Vector2 agentPos{ m_Kernel.GetPosition(agentIdx) };
+	const float radiusSquared{ m_NeighborhoodRadius * m_NeighborhoodRadius };
+
+	if (m_UseSpacePar && m_pPartition)
 	{
-		if (neighbor != pAgent && (pAgent->GetPosition() - neighbor->GetPosition()).Magnitude() <= m_NeighborhoodRadius)
+		m_pPartition->QueryRadius(agentPos, m_NeighborhoodRadius, neighbors);
+		neighbors.erase(std::remove(neighbors.begin(), neighbors.end(), agentIdx), neighbors.end());
+		if (m_MaxNeighbors > 0 && int(neighbors.size()) > m_MaxNeighbors)
 		{
-			m_Neighbors[m_NrOfNeighbors] = neighbor;
-			++m_NrOfNeighbors;
+			nearest.clear();
+			for (int neighbor : neighbors)
+				nearest.push_back({ neighbor, Elite::DistanceSquared(agentPos, m_Kernel.GetPosition(neighbor)) });
+
+			std::nth_element(nearest.begin(), nearest.begin() + m_MaxNeighbors, nearest.end());
+			neighbors.clear();
+			for (int i{ 0 }; i < m_MaxNeighbors; ++i)
+				neighbors.push_back(nearest[i].id);
 		}
+		return;
+	}
+
+	if (m_MaxNeighbors > 0)
+	{
+		if (m_UseSpacePar)
+		{
+			m_pCellSpace->QueryNearestNeighbors(agentPos, m_NeighborhoodRadius, m_MaxNeighbors, agentIdx, nearest);
+		}
+		else
+		{
+			nearest.clear();
+			for (int i{ 0 }; i < m_Kernel.GetNrOfAgents(); ++i)
+			{
+				const float distanceSquared{ Elite::DistanceSquared(agentPos, m_Kernel.GetPosition(i)) };
+				if (i != agentIdx && distanceSquared <= radiusSquared)
+					nearest.push_back({ i, distanceSquared });
+			}
+
+			if (int(nearest.size()) > m_MaxNeighbors)
+			{
+				std::nth_element(nearest.begin(), nearest.begin() + m_MaxNeighbors, nearest.end());
+				nearest.resize(m_MaxNeighbors);
+			}
+		}
+
+		for (const CellSpace::Neighbor& neighbor : nearest)
+			neighbors.push_back(neighbor.id);
+		return;
+	}
+
+	if (m_UseSpacePar)
+	{
+		m_pCellSpace->QueryNeighbors(agentPos, m_NeighborhoodRadius, agentIdx, neighbors);
+		return;
+	}
+
+	for (int i{ 0 }; i < m_Kernel.GetNrOfAgents(); ++i)
+	{
+		if (i != agentIdx && Elite::DistanceSquared(agentPos, m_Kernel.GetPosition(i)) <= radiusSquared)
+			neighbors.push_back(i);
 	}
 }
 
@@ -238,6 +323,13 @@ void Flock::UpdateAndRenderUI()
 	ImGui::Checkbox("Debug Rendering", &m_CanDebugRender);
 	//ImGui::Checkbox("Trim World", &m_TrimWorld);
 	ImGui::Checkbox("Spacial partitioning", &m_UseSpacePar);
+	if (m_UseSpacePar)
+	{
+		int selectedPartition{ m_SelectedPartition };
+		ImGui::Combo("Partition", &selectedPartition, "Cell space\0Loose quadtree\0AABB tree", 3);
+		if (selectedPartition != m_SelectedPartition)
+			SetPartition(selectedPartition);
+	}
 	//if (m_TrimWorld)
 	//{
 	//	ImGui::SliderFloat("Trim Size", &m_WorldSize, 0.f, 500.f, "%1.");
@@ -246,6 +338,7 @@ void Flock::UpdateAndRenderUI()
 	ImGui::Spacing();
 	ImGui::Text("Parameters");
 	ImGui::SliderFloat("NeighborRadius", &m_NeighborhoodRadius, 0.f, 50.f, ".%2");
+	ImGui::SliderInt("Max neighbors", &m_MaxNeighbors, 0, 64, m_MaxNeighbors > 0 ? "%.0f" : "All");
 
 	ImGui::Spacing();
 	ImGui::Text("Behaviors");
@@ -264,11 +357,11 @@ void Flock::UpdateAndRenderUI()
 Elite::Vector2 Flock::GetAverageNeighborPos() const
 {
 	Elite::Vector2 totalPos{};
-	for (size_t i{ 0 }; i < (size_t)m_NrOfNeighbors; ++i)
-		totalPos += m_Neighbors[i]->GetPosition();
+	for (int i{ 0 }; i < GetNrOfNeighbors(); ++i)
+		totalPos += GetNeighborPosition(i);
 
-	if (m_NrOfNeighbors > 0)
-		totalPos /= (float)m_NrOfNeighbors;
+	if (GetNrOfNeighbors() > 0)
+		totalPos /= (float)GetNrOfNeighbors();
 
 	return totalPos;
 }
@@ -276,15 +369,24 @@ Elite::Vector2 Flock::GetAverageNeighborPos() const
 Elite::Vector2 Flock::GetAverageNeighborVelocity() const
 {
 	Elite::Vector2 totalVel{};
-	for (size_t i{ 0 }; i < (size_t)m_NrOfNeighbors; ++i)
-		totalVel += m_Neighbors[i]->GetLinearVelocity();
+	for (int i{ 0 }; i < GetNrOfNeighbors(); ++i)
+		totalVel += GetNeighborVelocity(i);
 
-	if(m_NrOfNeighbors > 0)
-		totalVel /= (float)m_NrOfNeighbors;
+	if(GetNrOfNeighbors() > 0)
+		totalVel /= (float)GetNrOfNeighbors();
 
 	return totalVel;
 }
 
+void Flock::SetPartition(int selectedPartition)
+{
+	// The agents are (re)inserted by the next update
+	m_SelectedPartition = selectedPartition;
+	SAFE_DELETE(m_pPartition);
+	if (m_SelectedPartition > 0)
+		m_pPartition = Elite::CreateSpatialPartition(Elite::SpatialPartitionType(m_SelectedPartition - 1), { -m_WorldSize, -m_WorldSize }, { m_WorldSize, m_WorldSize });
+}
+
 void Flock::SetSeekTarget(TargetData target)
 {
 	// TODO: set target for Seek behavior
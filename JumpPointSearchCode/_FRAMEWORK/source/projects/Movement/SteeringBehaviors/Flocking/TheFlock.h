@@ -1,7 +1,10 @@
 #pragma once
 #include "../SteeringHelpers.h"
 #include "FlockingSteeringBehaviors.h"
+#include "FlockKernel.h"
 #include "../SpacePartitioning/SpacePartitioning.h"
+#include "framework\EliteHelpers\EWorkerPool.h"
+#include "framework\EliteGeometry\ESpatialPartition.h"
 
 class ISteeringBehavior;
 class SteeringAgent;
@@ -26,9 +29,11 @@ public:
 	void UpdateAndRenderUI() ;
 	void Render(float deltaT);
 
-	void RegisterNeighbors(SteeringAgent* pAgent);
-	int GetNrOfNeighbors() const { return m_NrOfNeighbors; }
-	const vector<SteeringAgent*>& GetNeighbors() const { return m_Neighbors; }
+	// Neighborhood of the agent whose steering is calculated on the calling thread (used by the flocking behaviors)
+	// Positions and velocities come from the snapshot taken at the start of Update
+	int GetNrOfNeighbors() const { return s_Neighborhood.nrOfNeighbors; }
+	Elite::Vector2 GetNeighborPosition(int neighbor) const { return m_Kernel.GetPosition(s_Neighborhood.pNeighbors[neighbor]); }
+	Elite::Vector2 GetNeighborVelocity(int neighbor) const { return m_Kernel.GetVelocity(s_Neighborhood.pNeighbors[neighbor]); }
 
 	Elite::Vector2 GetAverageNeighborPos() const;
 	Elite::Vector2 GetAverageNeighborVelocity() const;
@@ -40,14 +45,32 @@ private:
 	//Datamembers
 	int m_FlockSize = 0;
 	vector<SteeringAgent*> m_Agents;
-	vector<SteeringAgent*> m_Neighbors;
+
+	// Snapshot the steering of every agent is calculated from, so the agents that already moved don't influence the others
+	// Separation, cohesion and velocity match are calculated by the kernel, the flocking behaviors only hold their weights
+	// The other behaviors run as a program compiled from the priority steering, evaluated for a whole chunk of agents at once
+	FlockKernel m_Kernel;
+	SteeringProgram m_Program;
+	std::vector<Elite::Vector2> m_FlockSteering;
+	std::vector<SteeringOutput> m_Steering;
+
+	struct Neighborhood
+	{
+		int agentIdx = -1;
+		const int* pNeighbors = nullptr;
+		int nrOfNeighbors = 0;
+	};
+	static thread_local Neighborhood s_Neighborhood;
+
+	Elite::WorkerPool m_WorkerPool{};
+	std::vector<int> m_DebugNeighbors;
 
 	bool m_CanDebugRender = false;
 	bool m_TrimWorld = false;
 	float m_WorldSize = 0.f;
 
 	float m_NeighborhoodRadius = 10.f;
-	int m_NrOfNeighbors = 0;
+	int m_MaxNeighbors = 0; // Only the K nearest neighbors are used when > 0, bounds the cost per agent in dense flocks
 
 	SteeringAgent* m_pAgentToEvade = nullptr;
 	
@@ -57,13 +80,16 @@ private:
 	VelocityMatch* m_pVelMatchBehavior = nullptr;
 	Seek* m_pSeekBehavior = nullptr;
 	Wander* m_pWanderBehavior = nullptr;
+	Wander* m_pFlockWanderBehavior = nullptr;
 	Evade* m_pEvadeBehavior = nullptr;
 	//Evade* m_pEvadeBehavior = nullptr;
 
 	CellSpace* m_pCellSpace = nullptr;
 	bool m_UseSpacePar = true;
 
-	std::vector<Elite::Vector2> m_OldPositions;
+	// Partition used when spatial partitioning is on: 0 is the cell space, the others are 1 + Elite::SpatialPartitionType
+	int m_SelectedPartition = 0;
+	Elite::ISpatialPartition* m_pPartition = nullptr;
 
 	// Debug Values
 	Elite::Vector2 AverageNeighborPosDebug = {0,0};
@@ -73,6 +99,9 @@ private:
 	PrioritySteering* m_pPrioritySteering = nullptr;
 
 	float* GetWeight(ISteeringBehavior* pBehaviour);
+	void SetPartition(int selectedPartition);
+	void FindNeighbors(int agentIdx, std::vector<CellSpace::Neighbor>& nearest, std::vector<int>& neighbors) const;
+	void CalculateSteering(int firstAgent, int endAgent, float deltaT, const FlockKernel::Weights& flockWeights);
 
 private:
 	Flock(const Flock& other);
@@ -46,20 +46,48 @@ CellSpace::CellSpace(float width, float height, int rows, int cols, int maxEntit
 	{
 		m_Cells.push_back(Cell{ float(m_CellWidth * (i % cols)) - m_SpaceWidth * 0.5f, -float(m_CellHeight * floor((i) / cols)) + m_SpaceHeight * 0.5f - m_CellHeight, m_CellWidth, m_CellHeight });
 	}
+
+	m_CellStarts.resize(m_Cells.size() + 1, 0);
+	m_CellCursors.resize(m_Cells.size(), 0);
+	m_Agents.reserve(maxEntities);
 }
 
 void CellSpace::AddAgent(SteeringAgent* agent)
 {
-	m_Cells[PositionToIndex(agent->GetPosition())].agents.push_back(agent);
+	m_Agents.push_back(agent);
+	if (m_Neighbors.size() < m_Agents.size())
+		m_Neighbors.resize(m_Agents.size());
 }
 
-void CellSpace::UpdateAgentCell(SteeringAgent* agent, Elite::Vector2 oldPos)
+void CellSpace::UpdateBins()
 {
-	auto oldPosIdx = PositionToIndex(oldPos);
-	if (oldPosIdx != PositionToIndex(agent->GetPosition()))
+	const int nrOfAgents = int(m_Agents.size());
+	const int nrOfCells = int(m_Cells.size());
+	m_AgentCells.resize(nrOfAgents);
+	m_BinnedIds.resize(nrOfAgents);
+	m_BinnedPositions.resize(nrOfAgents);
+
+	// Count the agents per cell (shifted by one so the prefix sum gives the start of every cell)
+	std::fill(m_CellStarts.begin(), m_CellStarts.end(), 0);
+	for (int i{ 0 }; i < nrOfAgents; ++i)
 	{
-		m_Cells[oldPosIdx].agents.remove(agent);
-		AddAgent(agent);
+		const int cellIdx = PositionToIndex(m_Agents[i]->GetPosition());
+		m_AgentCells[i] = cellIdx;
+		++m_CellStarts[cellIdx + 1];
+	}
+
+	for (int i{ 0 }; i < nrOfCells; ++i)
+	{
+		m_CellStarts[i + 1] += m_CellStarts[i];
+		m_CellCursors[i] = m_CellStarts[i];
+	}
+
+	// Scatter the agents into their cell ranges
+	for (int i{ 0 }; i < nrOfAgents; ++i)
+	{
+		const int binIdx = m_CellCursors[m_AgentCells[i]]++;
+		m_BinnedIds[binIdx] = i;
+		m_BinnedPositions[binIdx] = m_Agents[i]->GetPosition();
 	}
 }
 
@@ -67,37 +95,102 @@ void CellSpace::RegisterNeighbors(SteeringAgent* agent, float queryRadius)
 {
 	m_NrOfNeighbors = 0;
 
-	int topLeftIndex, topRightIndex, botLeftIndex;
+	// The query skips by id, the agent itself is skipped here
+	m_NeighborIds.clear();
+	QueryNeighbors(agent->GetPosition(), queryRadius, -1, m_NeighborIds);
+
+	for (int id : m_NeighborIds)
+	{
+		if (m_Agents[id] != agent)
+		{
+			m_Neighbors[m_NrOfNeighbors] = m_Agents[id];
+			++m_NrOfNeighbors;
+		}
+	}
+}
+
+void CellSpace::QueryNeighbors(const Elite::Vector2& pos, float queryRadius, int ignoreId, std::vector<int>& neighbors) const
+{
+	const float radiusSquared{ queryRadius * queryRadius };
 
-	GetCellsToCheck(topLeftIndex, topRightIndex, botLeftIndex, agent, queryRadius);
+	int firstRow, lastRow;
+	GetRowsToCheck(pos, queryRadius, firstRow, lastRow);
+	for (int row{ firstRow }; row <= lastRow; ++row)
+	{
+		int firstCol, lastCol;
+		if (!GetColumnsToCheck(row, pos, queryRadius, firstCol, lastCol))
+			continue;
 
-	int colAmount{ topRightIndex - topLeftIndex + 1 };
+		// The cells of one row are adjacent in the bins, so their agents are one contiguous range
+		const int binEnd{ m_CellStarts[row * m_NrOfCols + lastCol + 1] };
+		for (int k{ m_CellStarts[row * m_NrOfCols + firstCol] }; k < binEnd; ++k)
+		{
+			if (m_BinnedIds[k] != ignoreId && Elite::DistanceSquared(pos, m_BinnedPositions[k]) <= radiusSquared)
+				neighbors.push_back(m_BinnedIds[k]);
+		}
+	}
+}
 
-	int rowAmount{ botLeftIndex - topLeftIndex };
-	rowAmount /= m_NrOfCols;
-	rowAmount += 1;
+void CellSpace::QueryNearestNeighbors(const Elite::Vector2& pos, float queryRadius, int maxNeighbors, int ignoreId, std::vector<Neighbor>& neighbors) const
+{
+	neighbors.clear();
+	const float radiusSquared{ queryRadius * queryRadius };
+	const bool isCapped{ maxNeighbors > 0 };
 
-	for (int i{ topLeftIndex }; i <= topRightIndex; ++i)
+	// While capped, neighbors is a max heap so the furthest of the nearest is at the front
+	int firstRow, lastRow;
+	GetRowsToCheck(pos, queryRadius, firstRow, lastRow);
+	for (int row{ firstRow }; row <= lastRow; ++row)
 	{
-		for (int j{ 0 }; j < rowAmount; ++j)
+		int firstCol, lastCol;
+		if (!GetColumnsToCheck(row, pos, queryRadius, firstCol, lastCol))
+			continue;
+
+		for (int col{ firstCol }; col <= lastCol; ++col)
 		{
-			for (auto neighbor : m_Cells[i+j*m_NrOfCols].agents)
+			// Once full, a cell further away than the furthest neighbor can't hold a nearer one
+			const bool isFull{ isCapped && int(neighbors.size()) == maxNeighbors };
+			if (isFull && GetCellDistanceSquared(row, col, pos) > neighbors.front().distanceSquared)
+				continue;
+
+			const int cellIdx{ row * m_NrOfCols + col };
+			for (int k{ m_CellStarts[cellIdx] }; k < m_CellStarts[cellIdx + 1]; ++k)
 			{
-				if (neighbor != agent && (agent->GetPosition() - neighbor->GetPosition()).Magnitude() <= queryRadius)
+				const float distanceSquared{ Elite::DistanceSquared(pos, m_BinnedPositions[k]) };
+				if (m_BinnedIds[k] == ignoreId || distanceSquared > radiusSquared)
+					continue;
+
+				if (!isCapped)
+				{
+					neighbors.push_back({ m_BinnedIds[k], distanceSquared });
+				}
+				else if (int(neighbors.size()) < maxNeighbors)
+				{
+					neighbors.push_back({ m_BinnedIds[k], distanceSquared });
+					std::push_heap(neighbors.begin(), neighbors.end());
+				}
+				else if (distanceSquared < neighbors.front().distanceSquared)
 				{
-					m_Neighbors[m_NrOfNeighbors] = neighbor;
-					++m_NrOfNeighbors;
+					std::pop_heap(neighbors.begin(), neighbors.end());
+					neighbors.back() = { m_BinnedIds[k], distanceSquared };
+					std::push_heap(neighbors.begin(), neighbors.end());
 				}
 			}
 		}
 	}
+
+	if (isCapped)
+		std::sort_heap(neighbors.begin(), neighbors.end());
+	else
+		std::sort(neighbors.begin(), neighbors.end());
 }
 
 void CellSpace::RenderCells() const
 {
-	for (auto cell : m_Cells)
+	for (int i{ 0 }; i < int(m_Cells.size()); ++i)
 	{
-		std::string amount{ std::to_string(cell.agents.size()) };
+		const Cell& cell{ m_Cells[i] };
+		std::string amount{ std::to_string(GetNrOfAgentsInCell(i)) };
 		const char * pAmount{ amount.c_str() };
 
 		Elite::Vector2 bottomLeft{ cell.boundingBox.bottomLeft };
@@ -121,66 +214,101 @@ void CellSpace::RenderCells() const
 	};
 	DEBUGRENDERER2D->DrawPolygon(&rectPoints[0], rectPoints.size(), Elite::Color(1, 0, 0), 0.4f);
 
-	int colAmount{ m_TopRightIdx - m_TopLeftIdx + 1 };
-
-	int rowAmount{ m_BotLeftIdx - m_TopLeftIdx };
-	rowAmount /= m_NrOfCols;
-	rowAmount += 1;
-	for (int i{ m_TopLeftIdx }; i <= m_TopRightIdx; ++i)
+	for (int cellIdx : m_cellsToCheck)
 	{
-		for (int j{ 0 }; j < rowAmount; ++j)
-		{
-			DEBUGRENDERER2D->DrawSolidPolygon(&m_Cells[i + j * m_NrOfCols].GetRectPoints()[0], m_Cells[i + j * m_NrOfCols].GetRectPoints().size(), Elite::Color(1, 0, 0), 0.4f);
-		}
+		DEBUGRENDERER2D->DrawSolidPolygon(&m_Cells[cellIdx].GetRectPoints()[0], m_Cells[cellIdx].GetRectPoints().size(), Elite::Color(1, 0, 0), 0.4f);
 	}
 }
 
 void CellSpace::SetDebugValues(SteeringAgent* agent, float queryRadius)
 {
 	m_OverlapRect = Elite::Rect{ Elite::Vector2(agent->GetPosition().x - queryRadius, agent->GetPosition().y - queryRadius), queryRadius * 2.f, queryRadius * 2.f };
-	GetCellsToCheck(m_TopLeftIdx, m_TopRightIdx, m_BotLeftIdx, agent, queryRadius);
+
+	m_cellsToCheck.clear();
+	int firstRow, lastRow;
+	GetRowsToCheck(agent->GetPosition(), queryRadius, firstRow, lastRow);
+	for (int row{ firstRow }; row <= lastRow; ++row)
+	{
+		int firstCol, lastCol;
+		if (!GetColumnsToCheck(row, agent->GetPosition(), queryRadius, firstCol, lastCol))
+			continue;
+
+		for (int col{ firstCol }; col <= lastCol; ++col)
+			m_cellsToCheck.push_back(row * m_NrOfCols + col);
+	}
+}
+
+int CellSpace::PositionToIndex(const Elite::Vector2 pos) const
+{
+	return PositionToColumn(pos.x) + PositionToRow(pos.y) * m_NrOfCols;
 }
 
-void CellSpace::GetCellsToCheck(int& topLeftIdx, int& topRightIdx, int& botLeftIdx, SteeringAgent* agent, float queryRadius)
+int CellSpace::PositionToColumn(float x) const
 {
-	Elite::Vector2 topLeft{ agent->GetPosition() };
-	topLeft.x -= queryRadius;
-	topLeft.y += queryRadius;
-	if (topLeft.x < -m_SpaceWidth * 0.5f)
-		topLeft.x = -m_SpaceWidth * 0.5f;
-	topLeftIdx = PositionToIndex(topLeft);
+	// Clamped before the conversion, positions outside of the space belong to the border cells
+	const float col{ (x + m_SpaceWidth * 0.5f) / m_CellWidth };
+	if (col < 0.f)
+		return 0;
+	if (col >= float(m_NrOfCols))
+		return m_NrOfCols - 1;
+	return int(col);
+}
 
-	Elite::Vector2 topRight{ agent->GetPosition() };
-	topRight.x += queryRadius;
-	topRight.y += queryRadius;
-	if (topRight.x > m_SpaceWidth * 0.5f)
-		topRight.x = m_SpaceWidth * 0.5f;
-	topRightIdx = PositionToIndex(topRight);
+int CellSpace::PositionToRow(float y) const
+{
+	const float row{ (m_SpaceHeight * 0.5f - y) / m_CellHeight };
+	if (row < 0.f)
+		return 0;
+	if (row >= float(m_NrOfRows))
+		return m_NrOfRows - 1;
+	return int(row);
+}
 
-	Elite::Vector2 botLeft{ agent->GetPosition() };
-	botLeft.x -= queryRadius;
-	botLeft.y -= queryRadius;
-	if (botLeft.y < -m_SpaceWidth * 0.5f)
-		botLeft.y = -m_SpaceWidth * 0.5f;
-	botLeftIdx = PositionToIndex(botLeft);
+void CellSpace::GetRowsToCheck(const Elite::Vector2& pos, float queryRadius, int& firstRow, int& lastRow) const
+{
+	// Rows go from top to bottom
+	firstRow = PositionToRow(pos.y + queryRadius);
+	lastRow = PositionToRow(pos.y - queryRadius);
 }
 
-int CellSpace::PositionToIndex(const Elite::Vector2 pos) const
+bool CellSpace::GetColumnsToCheck(int row, const Elite::Vector2& pos, float queryRadius, int& firstCol, int& lastCol) const
 {
-	int index{};
-	int col = int((pos.x + m_SpaceWidth * 0.5f) / m_CellWidth);
+	const float top{ row == 0 ? FLT_MAX : m_SpaceHeight * 0.5f - row * m_CellHeight };
+	const float bottom{ row == m_NrOfRows - 1 ? -FLT_MAX : m_SpaceHeight * 0.5f - (row + 1) * m_CellHeight };
 
-	if (col >= m_NrOfCols)
-		col = m_NrOfCols - 1;
-	if (col < 0)
-		col = 0;
+	float deltaY{ 0.f };
+	if (pos.y > top)
+		deltaY = pos.y - top;
+	else if (pos.y < bottom)
+		deltaY = bottom - pos.y;
+	if (deltaY > queryRadius)
+		return false;
 
-	int row = int((m_SpaceWidth * 0.5f - pos.y) / (m_CellHeight));
-	if (row >= m_NrOfRows)
-		row = m_NrOfRows - 1;
-	if (row < 0)
-		row = 0;
+	// Width of the circle at the closest edge of the row
+	const float halfWidth{ sqrtf(queryRadius * queryRadius - deltaY * deltaY) };
+	firstCol = PositionToColumn(pos.x - halfWidth);
+	lastCol = PositionToColumn(pos.x + halfWidth);
+	return true;
+}
+
+float CellSpace::GetCellDistanceSquared(int row, int col, const Elite::Vector2& pos) const
+{
+	const float left{ col == 0 ? -FLT_MAX : col * m_CellWidth - m_SpaceWidth * 0.5f };
+	const float right{ col == m_NrOfCols - 1 ? FLT_MAX : (col + 1) * m_CellWidth - m_SpaceWidth * 0.5f };
+	const float top{ row == 0 ? FLT_MAX : m_SpaceHeight * 0.5f - row * m_CellHeight };
+	const float bottom{ row == m_NrOfRows - 1 ? -FLT_MAX : m_SpaceHeight * 0.5f - (row + 1) * m_CellHeight };
 
-	index = int(col + (row * m_NrOfCols));
-	return index;
-}
\ No newline at end of file
+	float deltaX{ 0.f };
+	if (pos.x < left)
+		deltaX = left - pos.x;
+	else if (pos.x > right)
+		deltaX = pos.x - right;
+
+	float deltaY{ 0.f };
+	if (pos.y > top)
+		deltaY = pos.y - top;
+	else if (pos.y < bottom)
+		deltaY = bottom - pos.y;
+
+	return deltaX * deltaX + deltaY * deltaY;
+}
@@ -3,14 +3,14 @@
 // Authors: Yosha Vandaele
 /*=============================================================================*/
 // SpacePartitioning.h: Contains Cell and Cellspace which are used to partition a space in segments.
-// Cells contain pointers to all the agents within.
+// The agents are binned per cell with a counting sort once per frame: one contiguous array holds the agents (and their
+// positions) sorted by cell and every cell stores where its range starts, so a query walks linear memory.
 // These are used to avoid unnecessary distance comparisons to agents that are far away.
 
 // Heavily based on chapter 3 of "Programming Game AI by Example" - Mat Buckland
 /*=============================================================================*/
 
 #pragma once
-#include <list>
 #include <vector>
 #include <iterator>
 #include "framework\EliteMath\EVector2.h"
@@ -25,9 +25,7 @@ struct Cell
 	Cell(float left, float bottom, float width, float height);
 
 	std::vector<Elite::Vector2> GetRectPoints() const;
-	
-	// all the agents currently in this cell
-	std::list<SteeringAgent*> agents;
+
 	Elite::Rect boundingBox;
 };
 
@@ -38,10 +36,26 @@ class CellSpace
 public:
 	CellSpace(float width, float height, int rows, int cols, int maxEntities);
 
+	// Added agents are only found after the next UpdateBins
 	void AddAgent(SteeringAgent* agent);
-	void UpdateAgentCell(SteeringAgent* agent, Elite::Vector2 oldPos);
+	// Re-bins all agents on their current position, call once per frame before querying
+	void UpdateBins();
+	int GetNrOfAgentsInCell(int cellIdx) const { return m_CellStarts[cellIdx + 1] - m_CellStarts[cellIdx]; }
+
+	struct Neighbor
+	{
+		int id;
+		float distanceSquared;
+		bool operator<(const Neighbor& other) const { return distanceSquared < other.distanceSquared; }
+	};
 
 	void RegisterNeighbors(SteeringAgent* agent, float queryRadius);
+	// The queries are const, so they can be called from several threads. They only visit the cells that intersect the
+	// query circle and compare squared distances. Ids are the order in which the agents were added.
+	// Radius query: appends the ids of the agents within queryRadius of pos to neighbors, except ignoreId
+	void QueryNeighbors(const Elite::Vector2& pos, float queryRadius, int ignoreId, std::vector<int>& neighbors) const;
+	// K nearest query: fills neighbors (cleared first) with at most maxNeighbors agents within queryRadius, closest first
+	void QueryNearestNeighbors(const Elite::Vector2& pos, float queryRadius, int maxNeighbors, int ignoreId, std::vector<Neighbor>& neighbors) const;
 	const std::vector<SteeringAgent*>& GetNeighbors() const { return m_Neighbors; }
 	int GetNrOfNeighbors() const { return m_NrOfNeighbors; }
 
@@ -63,18 +77,31 @@ private:
 	float m_CellWidth;
 	float m_CellHeight;
 
+	// Bins, agents of cell i are at [m_CellStarts[i], m_CellStarts[i + 1]) of m_BinnedIds/m_BinnedPositions
+	std::vector<SteeringAgent*> m_Agents;
+	std::vector<int> m_AgentCells;
+	std::vector<int> m_CellStarts; // Nr of cells + 1
+	std::vector<int> m_CellCursors;
+	std::vector<int> m_BinnedIds; // Index in m_Agents
+	std::vector<Elite::Vector2> m_BinnedPositions; // Positions at the last UpdateBins
+
 	// Members to avoid memory allocation on every frame
 	vector<SteeringAgent*> m_Neighbors;
 	int m_NrOfNeighbors;
+	std::vector<int> m_NeighborIds;
 
 	// Debug render values
 	Elite::Rect m_OverlapRect;
-	int m_TopLeftIdx;
-	int m_TopRightIdx;
-	int m_BotLeftIdx;
 	std::vector<int> m_cellsToCheck;
 
 	// Helper functions
 	int PositionToIndex(const Elite::Vector2 pos) const;
-	void GetCellsToCheck(int& topLeftIdx, int& topRightIdx, int& botLeftIdx, SteeringAgent* agent, float queryRadius);
+	int PositionToColumn(float x) const;
+	int PositionToRow(float y) const;
+	// Rows that intersect the query circle
+	void GetRowsToCheck(const Elite::Vector2& pos, float queryRadius, int& firstRow, int& lastRow) const;
+	// Columns of a row that intersect the query circle, false if there are none
+	bool GetColumnsToCheck(int row, const Elite::Vector2& pos, float queryRadius, int& firstCol, int& lastCol) const;
+	// Squared distance from pos to a cell, the border cells extend to infinity as they hold the agents outside of the space
+	float GetCellDistanceSquared(int row, int col, const Elite::Vector2& pos) const;
 };
@@ -76,6 +76,11 @@ App_SteeringBehaviors::ImGui_Agent App_SteeringBehaviors::AddAgent(BehaviorTypes
 //Functions
 void App_SteeringBehaviors::Start()
 {
+	//The walls are there from the start, the obstacles are added to the index as they're placed
+	m_ObstacleIndex.AddPolygons(PHYSICSWORLD->GetAllStaticShapesInWorld(PhysicsFlags::NavigationCollider));
+	m_ObstacleAvoidance.SetObstacleIndex(&m_ObstacleIndex);
+	CompileObstacleAvoidance();
+
 	AddAgent(BehaviorTypes::Seek, -1);
 	m_AgentVec[0].pAgent->SetRenderBehavior(true);
 
@@ -163,6 +168,16 @@ void App_SteeringBehaviors::Update(float deltaTime)
 		if (ImGui::Button("Add Obstacle"))
 			AddObstacle();
 
+		ImGui::Checkbox("Avoid Obstacles", &m_AvoidObstacles);
+		if (m_AvoidObstacles)
+		{
+			//The program copies them when it's compiled
+			bool isChanged = ImGui::SliderFloat("Feeler Length", &m_FeelerLength, 0.f, 10.f, "%.1f");
+			isChanged = ImGui::SliderFloat("Look Ahead", &m_LookAheadTime, 0.f, 3.f, "%.2f") || isChanged;
+			if (isChanged)
+				CompileObstacleAvoidance();
+		}
+
 		ImGui::Spacing();
 		ImGui::Separator();
 
@@ -270,11 +285,29 @@ void App_SteeringBehaviors::Update(float deltaTime)
 #pragma endregion
 #endif
 
-	for (auto a : m_AgentVec)
+	//Obstacle avoidance for all agents at once, it's only valid for the agents whose feeler hits an obstacle: the others
+	//follow their own behavior
+	m_SteeringAgents.clear();
+	for (const auto& a : m_AgentVec)
+	{
+		if (a.pAgent)
+			m_SteeringAgents.push_back(a.pAgent);
+	}
+	const int nrOfAgents = int(m_SteeringAgents.size());
+	m_AvoidanceSteering.assign(nrOfAgents, SteeringOutput(ZeroVector2, 0.f, false));
+	if (m_AvoidObstacles)
+	{
+		m_AvoidanceProgram.SetNrOfAgents(nrOfAgents);
+		m_AvoidanceProgram.Evaluate(deltaTime, m_SteeringAgents.data(), 0, nrOfAgents, m_AvoidanceSteering.data());
+	}
+
+	int agentIdx = 0;
+	for (auto& a : m_AgentVec)
 	{
 		if (a.pAgent)
 		{
-			a.pAgent->Update(deltaTime);
+			const SteeringOutput& avoidance = m_AvoidanceSteering[agentIdx++];
+			a.pAgent->ApplySteering(avoidance.IsValid ? avoidance : a.pAgent->CalculateSteering(deltaTime), deltaTime);
 
 			if (m_TrimWorld)
 				a.pAgent->TrimToWorld(m_TrimWorldSize);
@@ -294,6 +327,16 @@ void App_SteeringBehaviors::Render(float deltaTime) const
 		}
 	}
 
+	if (m_AvoidObstacles)
+	{
+		m_ObstacleIndex.RenderDebug();
+		for (int i = 0; i < int(m_SteeringAgents.size()); ++i)
+		{
+			if (m_SteeringAgents[i]->CanRenderBehavior())
+				m_AvoidanceProgram.RenderDebug(m_SteeringAgents[i], i, m_AvoidanceSteering[i]);
+		}
+	}
+
 	if (m_TrimWorld)
 	{
 		vector<Elite::Vector2> points =
@@ -387,7 +430,18 @@ void App_SteeringBehaviors::AddObstacle()
 	auto pos = GetRandomObstaclePosition(radius, positionFound);
 
 	if (positionFound)
+	{
 		m_Obstacles.push_back(new Obstacle(pos, radius));
+		m_ObstacleIndex.AddCircle({ pos, radius });
+	}
+}
+
+void App_SteeringBehaviors::CompileObstacleAvoidance()
+{
+	m_ObstacleAvoidance.SetFeelerLength(m_FeelerLength);
+	m_ObstacleAvoidance.SetLookAheadTime(m_LookAheadTime);
+	if (!m_AvoidanceProgram.Compile(&m_ObstacleAvoidance))
+		printf("WARNING: obstacle avoidance can't be compiled to a steering program \n");
 }
 
 Elite::Vector2 App_SteeringBehaviors::GetRandomObstaclePosition(float newRadius, bool& positionFound)
@@ -397,22 +451,11 @@ Elite::Vector2 App_SteeringBehaviors::GetRandomObstaclePosition(float newRadius,
 	int tries = 0;
 	int maxTries = 200;
 
+	//Only the obstacles overlapping the new one grown by the minimum distance are in the way
 	while (positionFound == false && tries < maxTries)
 	{
-		positionFound = true;
 		pos = randomVector2(m_TrimWorldSize);
-
-		for (const auto& obstacle : m_Obstacles)
-		{
-			auto radiusSum = newRadius + obstacle->GetRadius();
-			auto distance = Distance(pos, obstacle->GetCenter());
-
-			if (distance < radiusSum + m_MinObstacleDistance)
-			{
-				positionFound = false;
-				break;
-			}
-		}
+		positionFound = !m_ObstacleIndex.IsOverlapping(pos, newRadius + m_MinObstacleDistance);
 		++tries;
 	}
 
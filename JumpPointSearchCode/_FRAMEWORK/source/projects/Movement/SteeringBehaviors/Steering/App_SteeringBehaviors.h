@@ -5,6 +5,8 @@
 //-----------------------------------------------------------------
 #include "framework/EliteInterfaces/EIApp.h"
 #include "SteeringBehaviors.h"
+#include "SteeringProgram.h"
+#include "framework/EliteGeometry/EObstacleIndex.h"
 class SteeringAgent;
 class Obstacle;
 
@@ -61,6 +63,17 @@ private:
 	const float m_MaxObstacleRadius = 5.f;
 	const float m_MinObstacleRadius = 1.f;
 	const float m_MinObstacleDistance = 10.f;
+	//Static obstacles (the walls of the navigation colliders and the obstacles), also used to place new obstacles
+	Elite::ObstacleIndex m_ObstacleIndex;
+
+	//Obstacle avoidance of all agents compiled into one program, so the feelers of all agents are queried at once
+	ObstacleAvoidance m_ObstacleAvoidance;
+	SteeringProgram m_AvoidanceProgram;
+	bool m_AvoidObstacles = true;
+	float m_FeelerLength = 3.f;
+	float m_LookAheadTime = 1.f;
+	std::vector<SteeringAgent*> m_SteeringAgents = {}; //The agents of m_AgentVec, in the order of the program
+	std::vector<SteeringOutput> m_AvoidanceSteering = {};
 
 	//Interface Functions
 	void RemoveAgent(UINT index);
@@ -70,6 +83,7 @@ private:
 	void UpdateTargetLabel();
 
 	void AddObstacle();
+	void CompileObstacleAvoidance();
 	Elite::Vector2 GetRandomObstaclePosition(float obstacleRadius, bool& positionFound);
 
 	//C++ make the class non-copyable
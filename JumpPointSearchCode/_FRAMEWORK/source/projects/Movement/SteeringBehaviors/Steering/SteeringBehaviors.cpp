@@ -8,118 +8,114 @@
 #include "framework\EliteMath\EMatrix2x3.h"
 #include <cmath>
 
+namespace
+{
+	//Program entry of a behavior with a target
+	SteeringProgram::Entry CreateEntry(SteeringProgram::Kind kind, const float* pWeight, const TargetData& target)
+	{
+		SteeringProgram::Entry entry{};
+		entry.kind = kind;
+		entry.pWeight = pWeight;
+		entry.pTarget = &target;
+		return entry;
+	}
+}
+
 //SEEK
 //****
 SteeringOutput Seek::CalculateSteering(float deltaT, SteeringAgent* pAgent)
 {
 	SteeringOutput steering{};
-
-	steering.LinearVelocity = m_Target.Position - pAgent->GetPosition();
-	steering.LinearVelocity.Normalize();
-	steering.LinearVelocity *= pAgent->GetMaxLinearSpeed();
-
-	// Debug rendering
-	if (pAgent->CanRenderBehavior())
-		DEBUGRENDERER2D->DrawDirection(pAgent->GetPosition(), steering.LinearVelocity, 5.f, { 0, 1, 0, 0.5f }, 0.4f);
-
+	steering.LinearVelocity = SteeringMath::Seek(pAgent->GetPosition(), m_Target.Position, pAgent->GetMaxLinearSpeed());
 	return steering;
 }
 
+bool Seek::Compile(SteeringProgram& program, const float* pWeight) const
+{
+	program.AddEntry(CreateEntry(SteeringProgram::Kind::Seek, pWeight, m_Target));
+	return true;
+}
+
 //FLEE
 //****
 SteeringOutput Flee::CalculateSteering(float deltaT, SteeringAgent* pAgent)
 {
 	SteeringOutput steering{};
-
-	steering.LinearVelocity = pAgent->GetPosition() - m_Target.Position;
-	steering.LinearVelocity.Normalize();
-	steering.LinearVelocity *= pAgent->GetMaxLinearSpeed();
-
-	// Debug rendering
-	if (pAgent->CanRenderBehavior())
-		DEBUGRENDERER2D->DrawDirection(pAgent->GetPosition(), steering.LinearVelocity, 5.f, { 0, 1, 0, 0.5f }, 0.4f);
-
-
+	steering.LinearVelocity = -SteeringMath::Seek(pAgent->GetPosition(), m_Target.Position, pAgent->GetMaxLinearSpeed());
 	return steering;
 }
 
+bool Flee::Compile(SteeringProgram& program, const float* pWeight) const
+{
+	program.AddEntry(CreateEntry(SteeringProgram::Kind::Flee, pWeight, m_Target));
+	return true;
+}
+
 //ARRIVE
 //****
 SteeringOutput Arrive::CalculateSteering(float deltaT, SteeringAgent* pAgent)
 {
 	SteeringOutput steering{};
-
-	Elite::Vector2 toTarget = m_Target.Position - pAgent->GetPosition();
-	const float distance = toTarget.Magnitude();
-
-	steering.LinearVelocity = toTarget;
-	steering.LinearVelocity.Normalize();
-	if (distance < m_SlowRadius)
-		steering.LinearVelocity *= pAgent->GetMaxLinearSpeed() * distance / m_SlowRadius;
-	else
-		steering.LinearVelocity *= pAgent->GetMaxLinearSpeed();
-
-	// Debug rendering
-	if (pAgent->CanRenderBehavior())
-		DEBUGRENDERER2D->DrawDirection(pAgent->GetPosition(), steering.LinearVelocity, 5.f, { 0, 1, 0, 0.5f }, 0.4f);
-
+	steering.LinearVelocity = SteeringMath::Arrive(pAgent->GetPosition(), m_Target.Position, pAgent->GetMaxLinearSpeed(), m_SlowRadius);
 	return steering;
 }
 
+bool Arrive::Compile(SteeringProgram& program, const float* pWeight) const
+{
+	SteeringProgram::Entry entry{ CreateEntry(SteeringProgram::Kind::Arrive, pWeight, m_Target) };
+	entry.radius = m_SlowRadius;
+	program.AddEntry(entry);
+	return true;
+}
+
 //FACE
 //****
 SteeringOutput Face::CalculateSteering(float deltaT, SteeringAgent* pAgent)
 {
 	SteeringOutput steering{};
-	Elite::Vector2 toTarget = (m_Target.Position - pAgent->GetPosition()).GetNormalized();
-	const float finalRotation = atan2(toTarget.y, toTarget.x);
-
-	float rotation = finalRotation - pAgent->GetRotation() + (float)E_PI_2;
-	while (rotation > E_PI) rotation -= 2.f * (float)E_PI;
-	while (rotation < -E_PI) rotation += 2.f * (float)E_PI;
 
 	pAgent->SetAutoOrient(false);
-	pAgent->SetAngularVelocity( Elite::Clamp(Elite::ToDegrees(rotation), -pAgent->GetMaxAngularSpeed(), pAgent->GetMaxAngularSpeed()) );
-	//pAgent->SetAngularVelocity( rotation );
+	pAgent->SetAngularVelocity(SteeringMath::Face(pAgent->GetPosition(), pAgent->GetRotation(), m_Target.Position, pAgent->GetMaxAngularSpeed()));
 	steering.AngularVelocity = pAgent->GetAngularVelocity();
 
-	// Debug rendering
-	if (pAgent->CanRenderBehavior())
-		DEBUGRENDERER2D->DrawDirection(pAgent->GetPosition(), steering.LinearVelocity, 5.f, { 0, 1, 0, 0.5f }, 0.4f);
-
 	return steering;
 }
 
+bool Face::Compile(SteeringProgram& program, const float* pWeight) const
+{
+	program.AddEntry(CreateEntry(SteeringProgram::Kind::Face, pWeight, m_Target));
+	return true;
+}
+
 //WANDER
 //****
 SteeringOutput Wander::CalculateSteering(float deltaT, SteeringAgent* pAgent)
 {
 	SteeringOutput steering{};
-	float agentRotation = pAgent->GetRotation() - (float)M_PI * 0.5f;
-	Elite::Vector2 circleCenter{cosf(agentRotation), sinf(agentRotation)};
-	circleCenter *= m_OffsetDistance;
-	circleCenter += pAgent->GetPosition();
-
-	float angleChange{ (rand() % (int)(m_MaxAngleChange * 200.f + 1.f)) / 100.f - m_MaxAngleChange };
-	m_WanderAngle += angleChange;
 
-	Elite::Vector2 target{ cosf(m_WanderAngle), sinf(m_WanderAngle) };
-	target *= m_Radius;
-	target += circleCenter;
+	m_WanderAngle += SteeringMath::GetWanderAngleChange(m_Random, m_MaxAngleChange);
+	const Elite::Vector2 circleCenter{ SteeringMath::GetWanderCircleCenter(pAgent->GetPosition(), pAgent->GetRotation(), m_OffsetDistance) };
+	const Elite::Vector2 target{ SteeringMath::GetWanderTarget(circleCenter, m_Radius, m_WanderAngle) };
+	steering.LinearVelocity = SteeringMath::Seek(pAgent->GetPosition(), target, pAgent->GetMaxLinearSpeed());
 
-	m_Target = TargetData(target);
+	return steering;
+}
 
-	steering.LinearVelocity = m_Target.Position - pAgent->GetPosition();
-	steering.LinearVelocity.Normalize();
-	steering.LinearVelocity *= pAgent->GetMaxLinearSpeed();
+void Wander::RenderDebug(const SteeringAgent* pAgent) const
+{
+	const Elite::Vector2 circleCenter{ SteeringMath::GetWanderCircleCenter(pAgent->GetPosition(), pAgent->GetRotation(), m_OffsetDistance) };
+	DEBUGRENDERER2D->DrawCircle(circleCenter, m_Radius, { 0, 0, 1, 0.5f }, 0.4f);
+	DEBUGRENDERER2D->DrawPoint(SteeringMath::GetWanderTarget(circleCenter, m_Radius, m_WanderAngle), 4.f, { 1, 0, 0, 0.5f }, 0.4f);
+}
 
-	if (pAgent->CanRenderBehavior())
-	{
-		DEBUGRENDERER2D->DrawDirection(pAgent->GetPosition(), steering.LinearVelocity, 5.f, { 0, 1, 0, 0.5f }, 0.4f);
-		DEBUGRENDERER2D->DrawCircle(circleCenter, m_Radius, { 0, 0, 1, 0.5f }, 0.4f);
-		DEBUGRENDERER2D->DrawPoint(target, 4.f, { 1, 0, 0, 0.5f }, 0.4f);
-	}
-	return steering;
+bool Wander::Compile(SteeringProgram& program, const float* pWeight) const
+{
+	SteeringProgram::Entry entry{ CreateEntry(SteeringProgram::Kind::Wander, pWeight, m_Target) };
+	entry.radius = m_Radius;
+	entry.offset = m_OffsetDistance;
+	entry.maxAngleChange = m_MaxAngleChange;
+	program.AddEntry(entry);
+	return true;
 }
 
 //PURSUIT
@@ -128,63 +124,96 @@ SteeringOutput Pursuit::CalculateSteering(float deltaT, SteeringAgent* pAgent)
 {
 	SteeringOutput steering{};
 
-	const float maxDistance{20.f};
-	float amplifier{};
-	auto distanceToTarget = Distance(pAgent->GetPosition(), m_Target.Position);
-	amplifier = distanceToTarget;
-	if (amplifier > maxDistance)
-		amplifier = maxDistance;
-
-	Elite::Vector2 distanceAheadOfTarget{ (m_Target.GetDirection() + m_Target.LinearVelocity) };
-	distanceAheadOfTarget.Normalize();
-	distanceAheadOfTarget *= amplifier;
+	const Elite::Vector2 pursuitPoint{ SteeringMath::GetPursuitPoint(pAgent->GetPosition(), m_Target) };
+	if (pursuitPoint != m_Target.Position)
+		m_Target = TargetData(pursuitPoint);
 
-	distanceAheadOfTarget += m_Target.Position;
+	steering.LinearVelocity = SteeringMath::Seek(pAgent->GetPosition(), m_Target.Position, pAgent->GetMaxLinearSpeed());
+	return steering;
+}
 
-	if(TargetData(distanceAheadOfTarget).Position.Distance(m_Target.Position) < TargetData(distanceAheadOfTarget).Position.Distance(pAgent->GetPosition()))
-		m_Target = TargetData(distanceAheadOfTarget);
+void Pursuit::RenderDebug(const SteeringAgent* pAgent) const
+{
+	DEBUGRENDERER2D->DrawPoint(m_Target.Position, 5.f, { 1, 0, 0, 0.5f }, 0.4f);
+}
 
-	steering.LinearVelocity = (m_Target.Position - pAgent->GetPosition());
-	//steering.LinearVelocity = (m_Target.Position - pAgent->GetPosition()) + (m_Target.GetDirection() + m_Target.LinearVelocity);
-	steering.LinearVelocity.Normalize();
-	steering.LinearVelocity *= pAgent->GetMaxLinearSpeed();
+bool Pursuit::Compile(SteeringProgram& program, const float* pWeight) const
+{
+	program.AddEntry(CreateEntry(SteeringProgram::Kind::Pursuit, pWeight, m_Target));
+	return true;
+}
 
-	// Debug rendering
-	if (pAgent->CanRenderBehavior())
+//EVADE
+//****
+SteeringOutput Evade::CalculateSteering(float deltaT, SteeringAgent* pAgent)
+{
+	if (Distance(pAgent->GetPosition(), m_Target.Position) > m_EvadeRadius)
 	{
-		DEBUGRENDERER2D->DrawDirection(pAgent->GetPosition(), steering.LinearVelocity, 5.f, { 0, 1, 0, 0.5f }, 0.4f);
-		DEBUGRENDERER2D->DrawPoint(m_Target.Position, 5.f, { 1, 0, 0, 0.5f }, 0.4f);
-		//DEBUGRENDERER2D->DrawPoint(m_Target.Position + (m_Target.GetDirection() + m_Target.LinearVelocity), 5.f, { 1, 0, 0, 0.5f }, 0.4f);
+		return SteeringOutput(Elite::ZeroVector2, 0.f, false);
 	}
 
+	SteeringOutput steering{};
+	steering.LinearVelocity = -SteeringMath::Seek(pAgent->GetPosition(), m_Target.Position, pAgent->GetMaxLinearSpeed());
 	return steering;
 }
 
-//EVADE
-//****
-SteeringOutput Evade::CalculateSteering(float deltaT, SteeringAgent* pAgent)
+void Evade::RenderDebug(const SteeringAgent* pAgent) const
 {
-	auto distanceToTarget = Distance(pAgent->GetPosition(), m_Target.Position);
+	const float distanceToTarget{ Distance(pAgent->GetPosition(), m_Target.Position) };
 	if (distanceToTarget > m_EvadeRadius)
-	{
+		return;
+
+	DEBUGRENDERER2D->DrawPoint(m_Target.Position - m_Target.GetDirection() + m_Target.LinearVelocity * distanceToTarget / m_EvadeRadius, 5.f, { 1, 0, 0, 0.5f }, 0.4f);
+}
+
+bool Evade::Compile(SteeringProgram& program, const float* pWeight) const
+{
+	SteeringProgram::Entry entry{ CreateEntry(SteeringProgram::Kind::Evade, pWeight, m_Target) };
+	entry.radius = m_EvadeRadius;
+	program.AddEntry(entry);
+	return true;
+}
+
+//OBSTACLE AVOIDANCE
+//****
+SteeringOutput ObstacleAvoidance::CalculateSteering(float deltaT, SteeringAgent* pAgent)
+{
+	if (!m_pObstacleIndex)
+		return SteeringOutput(Elite::ZeroVector2, 0.f, false);
+
+	const Elite::ObstacleIndex::Feeler feeler{ SteeringMath::GetFeeler(pAgent->GetPosition(), pAgent->GetLinearVelocity(), pAgent->GetRotation(), pAgent->GetRadius(), m_FeelerLength, m_LookAheadTime) };
+	const Elite::ObstacleIndex::FeelerHit hit{ m_pObstacleIndex->QueryFeeler(feeler) };
+	if (!hit.isHit)
 		return SteeringOutput(Elite::ZeroVector2, 0.f, false);
-	}
 
 	SteeringOutput steering{};
+	steering.LinearVelocity = SteeringMath::AvoidObstacle(feeler.direction, hit, pAgent->GetMaxLinearSpeed());
+	return steering;
+}
 
-	//steering.LinearVelocity = (-(m_Target.Position - pAgent->GetPosition()) + m_Target.GetDirection() + (m_Target.LinearVelocity)*(distanceToTarget)/m_EvadeRadius);
-	//steering.LinearVelocity = (-(m_Target.Position - pAgent->GetPosition())*(distanceToTarget)/m_EvadeRadius);
-	steering.LinearVelocity = (-(m_Target.Position - pAgent->GetPosition()));
-	steering.LinearVelocity.Normalize();
-	steering.LinearVelocity *= pAgent->GetMaxLinearSpeed();
+void ObstacleAvoidance::RenderDebug(const SteeringAgent* pAgent) const
+{
+	const Elite::ObstacleIndex::Feeler feeler{ SteeringMath::GetFeeler(pAgent->GetPosition(), pAgent->GetLinearVelocity(), pAgent->GetRotation(), pAgent->GetRadius(), m_FeelerLength, m_LookAheadTime) };
+	DEBUGRENDERER2D->DrawSegment(feeler.origin, feeler.origin + feeler.direction * feeler.length, { 1, 0.5f, 0, 0.5f }, 0.4f);
+	if (!m_pObstacleIndex)
+		return;
 
-	// Debug rendering
-	if (pAgent->CanRenderBehavior())
+	const Elite::ObstacleIndex::FeelerHit hit{ m_pObstacleIndex->QueryFeeler(feeler) };
+	if (hit.isHit)
 	{
-		DEBUGRENDERER2D->DrawDirection(pAgent->GetPosition(), steering.LinearVelocity, 5.f, { 0, 1, 0, 0.5f }, 0.4f);
-		//DEBUGRENDERER2D->DrawDirection(pAgent->GetPosition(), -steering.LinearVelocity, 5.f, { 0, 1, 0, 0.5f }, 0.4f);
-		DEBUGRENDERER2D->DrawPoint(m_Target.Position - m_Target.GetDirection() + (m_Target.LinearVelocity) * (distanceToTarget) / m_EvadeRadius, 5.f, { 1, 0, 0, 0.5f }, 0.4f);
+		DEBUGRENDERER2D->DrawCircle(hit.point, feeler.radius, { 1, 0, 0, 0.5f }, 0.4f);
+		DEBUGRENDERER2D->DrawDirection(hit.point, hit.normal, 3.f, { 1, 0, 0, 0.5f }, 0.4f);
 	}
+}
 
-	return steering;
-}
\ No newline at end of file
+bool ObstacleAvoidance::Compile(SteeringProgram& program, const float* pWeight) const
+{
+	SteeringProgram::Entry entry{};
+	entry.kind = SteeringProgram::Kind::AvoidObstacles;
+	entry.pWeight = pWeight;
+	entry.radius = m_FeelerLength;
+	entry.offset = m_LookAheadTime;
+	entry.pObstacles = m_pObstacleIndex;
+	program.AddEntry(entry);
+	return true;
+}
@@ -11,6 +11,7 @@
 // Includes & Forward Declarations
 //-----------------------------------------------------------------
 #include "../SteeringHelpers.h"
+#include "SteeringProgram.h"
 class SteeringAgent;
 class Obstacle;
 
@@ -23,8 +24,15 @@ public:
 
 	virtual SteeringOutput CalculateSteering(float deltaT, SteeringAgent* pAgent) = 0;
 
+	//Debug pass, called by the agent when it renders, so CalculateSteering never has to check for it
+	virtual void RenderDebug(const SteeringAgent* pAgent) const {}
+
+	//Adds the behavior to a SteeringProgram (pWeight is its weight in a blend), false when it has no program version
+	virtual bool Compile(SteeringProgram& program, const float* pWeight) const { return false; }
+
 	//Seek Functions
 	void SetTarget(const TargetData& target) { m_Target = target; }
+	const TargetData& GetTarget() const { return m_Target; }
 
 	template<class T, typename std::enable_if<std::is_base_of<ISteeringBehavior, T>::value>::type* = nullptr>
 	T* As()
@@ -46,6 +54,7 @@ public:
 
 	//Seek Behaviour
 	SteeringOutput CalculateSteering(float deltaT, SteeringAgent* pAgent) override;
+	bool Compile(SteeringProgram& program, const float* pWeight) const override;
 };
 
 /////////////////////////
@@ -59,6 +68,7 @@ public:
 
 	//Seek Behavior
 	SteeringOutput CalculateSteering(float deltaT, SteeringAgent* pAgent) override;
+	bool Compile(SteeringProgram& program, const float* pWeight) const override;
 };
 
 /////////////////////////
@@ -74,6 +84,7 @@ public:
 
 	//Seek Behavior
 	SteeringOutput CalculateSteering(float deltaT, SteeringAgent* pAgent) override;
+	bool Compile(SteeringProgram& program, const float* pWeight) const override;
 protected:
 	float m_SlowRadius = 15.f;
 	float m_TargetRadius;
@@ -90,6 +101,7 @@ public:
 
 	//Seek Behavior
 	SteeringOutput CalculateSteering(float deltaT, SteeringAgent* pAgent) override;
+	bool Compile(SteeringProgram& program, const float* pWeight) const override;
 };
 
 /////////////////////////
@@ -103,6 +115,8 @@ public:
 
 	//Wander Behavior
 	SteeringOutput CalculateSteering(float deltaT, SteeringAgent* pAgent) override;
+	void RenderDebug(const SteeringAgent* pAgent) const override;
+	bool Compile(SteeringProgram& program, const float* pWeight) const override;
 
 	void SetWanderOffset(float offset) { m_OffsetDistance = offset; };
 	void SetWanderRadius(float radius) { m_Radius = radius; };
@@ -113,6 +127,7 @@ protected:
 	float m_Radius = 10.f;
 	float m_MaxAngleChange = Elite::ToRadians(25);
 	float m_WanderAngle = 0.f;
+	Elite::RandomStream m_Random = {};
 };
 
 /////////////////////////
@@ -126,6 +141,8 @@ public:
 
 	//Seek Behavior
 	SteeringOutput CalculateSteering(float deltaT, SteeringAgent* pAgent) override;
+	void RenderDebug(const SteeringAgent* pAgent) const override;
+	bool Compile(SteeringProgram& program, const float* pWeight) const override;
 };
 
 /////////////////////////
@@ -139,11 +156,37 @@ public:
 
 	//Seek Behavior
 	SteeringOutput CalculateSteering(float deltaT, SteeringAgent* pAgent) override;
+	void RenderDebug(const SteeringAgent* pAgent) const override;
+	bool Compile(SteeringProgram& program, const float* pWeight) const override;
 
 	void SetEvadeRadius(float evadeRadius) { m_EvadeRadius = evadeRadius; };
 private:
 	float m_EvadeRadius = 20.f;
 };
+
+/////////////////////////
+//OBSTACLE AVOIDANCE
+//****
+class ObstacleAvoidance : public ISteeringBehavior
+{
+public:
+	ObstacleAvoidance() = default;
+	virtual ~ObstacleAvoidance() = default;
+
+	//Only valid when the feeler hits an obstacle, so it goes first in a PrioritySteering
+	SteeringOutput CalculateSteering(float deltaT, SteeringAgent* pAgent) override;
+	void RenderDebug(const SteeringAgent* pAgent) const override;
+	bool Compile(SteeringProgram& program, const float* pWeight) const override;
+
+	void SetObstacleIndex(const Elite::ObstacleIndex* pObstacleIndex) { m_pObstacleIndex = pObstacleIndex; };
+	void SetFeelerLength(float length) { m_FeelerLength = length; };
+	void SetLookAheadTime(float time) { m_LookAheadTime = time; };
+
+private:
+	const Elite::ObstacleIndex* m_pObstacleIndex = nullptr;
+	float m_FeelerLength = 5.f; //When standing still
+	float m_LookAheadTime = 1.f; //Added to the length per unit of speed
+};
 #endif
 
 
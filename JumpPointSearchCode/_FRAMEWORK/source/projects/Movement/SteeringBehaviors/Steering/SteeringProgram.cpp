@@ -0,0 +1,290 @@
+#include "stdafx.h"
+#include "SteeringProgram.h"
+
+#include "SteeringBehaviors.h"
+#include "../SteeringAgent.h"
+
+namespace
+{
+	// Scratch of one Evaluate call, per thread so ranges can be evaluated in parallel
+	struct Batch
+	{
+		std::vector<Elite::Vector2> positions;
+		std::vector<Elite::Vector2> velocities;
+		std::vector<float> rotations;
+		std::vector<float> radii;
+		std::vector<float> maxSpeeds;
+		std::vector<Elite::Vector2> linear;
+		std::vector<float> angular;
+		std::vector<float> totalWeights;
+		std::vector<char> isValid;
+		std::vector<int> pending; // Agents (relative to the first one) without a valid steering yet
+		std::vector<Elite::ObstacleIndex::Feeler> feelers; // Of the pending agents
+		std::vector<Elite::ObstacleIndex::FeelerHit> feelerHits;
+	};
+
+	const TargetData s_NoTarget{};
+
+	Batch& GetBatch(int nrOfAgents)
+	{
+		static thread_local Batch batch{};
+		batch.positions.resize(nrOfAgents);
+		batch.velocities.resize(nrOfAgents);
+		batch.rotations.resize(nrOfAgents);
+		batch.radii.resize(nrOfAgents);
+		batch.maxSpeeds.resize(nrOfAgents);
+		batch.linear.resize(nrOfAgents);
+		batch.angular.resize(nrOfAgents);
+		batch.totalWeights.resize(nrOfAgents);
+		batch.isValid.resize(nrOfAgents);
+		batch.pending.clear();
+		return batch;
+	}
+}
+
+bool SteeringProgram::Compile(const ISteeringBehavior* pRoot)
+{
+	Clear();
+	if (!pRoot || !pRoot->Compile(*this, nullptr))
+	{
+		Clear();
+		return false;
+	}
+
+	SetNrOfAgents(m_NrOfAgents);
+	return true;
+}
+
+void SteeringProgram::Clear()
+{
+	m_Entries.clear();
+	m_Stages.clear();
+	m_IsInStage = false;
+	m_NrOfWanderEntries = 0;
+}
+
+void SteeringProgram::BeginStage(bool isBlended)
+{
+	Stage stage{};
+	stage.firstEntry = int(m_Entries.size());
+	stage.endEntry = stage.firstEntry;
+	stage.isBlended = isBlended;
+	m_Stages.push_back(stage);
+	m_IsInStage = true;
+}
+
+void SteeringProgram::EndStage()
+{
+	m_Stages.back().endEntry = int(m_Entries.size());
+	m_IsInStage = false;
+}
+
+void SteeringProgram::AddEntry(Entry entry)
+{
+	// A behavior on its own is a stage of one entry
+	const bool isOwnStage{ !m_IsInStage };
+	if (isOwnStage)
+		BeginStage(false);
+
+	if (entry.kind == Kind::Wander)
+		entry.wanderSlot = m_NrOfWanderEntries++;
+	m_Entries.push_back(entry);
+
+	if (isOwnStage)
+		EndStage();
+}
+
+void SteeringProgram::SetNrOfAgents(int nrOfAgents)
+{
+	m_NrOfAgents = nrOfAgents;
+	m_WanderAngles.resize(m_NrOfAgents * m_NrOfWanderEntries, 0.f);
+	m_ActiveStages.resize(m_NrOfAgents, 0);
+
+	if (int(m_RandomStreams.size()) > m_NrOfAgents)
+		m_RandomStreams.erase(m_RandomStreams.begin() + m_NrOfAgents, m_RandomStreams.end());
+	for (int i{ int(m_RandomStreams.size()) }; i < m_NrOfAgents; ++i)
+		m_RandomStreams.emplace_back(m_RandomStreamId, uint64_t(i));
+}
+
+void SteeringProgram::Evaluate(float deltaT, SteeringAgent* const* pAgents, int firstAgent, int endAgent, SteeringOutput* pOutputs, const Elite::Vector2* pExternalSteering)
+{
+	const int nrOfAgents{ endAgent - firstAgent };
+	if (nrOfAgents <= 0 || m_Stages.empty())
+		return;
+
+	Batch& batch{ GetBatch(nrOfAgents) };
+	for (int i{ 0 }; i < nrOfAgents; ++i)
+	{
+		const SteeringAgent* pAgent{ pAgents[firstAgent + i] };
+		batch.positions[i] = pAgent->GetPosition();
+		batch.velocities[i] = pAgent->GetLinearVelocity();
+		batch.rotations[i] = pAgent->GetRotation();
+		batch.radii[i] = pAgent->GetRadius();
+		batch.maxSpeeds[i] = pAgent->GetMaxLinearSpeed();
+		batch.pending.push_back(i);
+	}
+
+	for (int stageIdx{ 0 }; stageIdx < int(m_Stages.size()) && !batch.pending.empty(); ++stageIdx)
+	{
+		const Stage& stage{ m_Stages[stageIdx] };
+		for (int i : batch.pending)
+		{
+			batch.linear[i] = Elite::ZeroVector2;
+			batch.angular[i] = 0.f;
+			batch.totalWeights[i] = 0.f;
+			batch.isValid[i] = true;
+		}
+
+		// One kind at a time over all pending agents
+		bool hasExternalSteering{ false };
+		for (int entryIdx{ stage.firstEntry }; entryIdx < stage.endEntry; ++entryIdx)
+		{
+			const Entry& entry{ m_Entries[entryIdx] };
+			const float weight{ entry.pWeight ? *entry.pWeight : 1.f };
+			const TargetData& target{ entry.pTarget ? *entry.pTarget : s_NoTarget };
+			switch (entry.kind)
+			{
+			case Kind::Seek:
+				for (int i : batch.pending)
+					batch.linear[i] += weight * SteeringMath::Seek(batch.positions[i], target.Position, batch.maxSpeeds[i]);
+				break;
+			case Kind::Flee:
+				for (int i : batch.pending)
+					batch.linear[i] -= weight * SteeringMath::Seek(batch.positions[i], target.Position, batch.maxSpeeds[i]);
+				break;
+			case Kind::Arrive:
+				for (int i : batch.pending)
+					batch.linear[i] += weight * SteeringMath::Arrive(batch.positions[i], target.Position, batch.maxSpeeds[i], entry.radius);
+				break;
+			case Kind::Face:
+				for (int i : batch.pending)
+				{
+					SteeringAgent* pAgent{ pAgents[firstAgent + i] };
+					pAgent->SetAutoOrient(false);
+					batch.angular[i] += weight * SteeringMath::Face(batch.positions[i], batch.rotations[i], target.Position, pAgent->GetMaxAngularSpeed());
+				}
+				break;
+			case Kind::Wander:
+				for (int i : batch.pending)
+				{
+					float& wanderAngle{ m_WanderAngles[(firstAgent + i) * m_NrOfWanderEntries + entry.wanderSlot] };
+					wanderAngle += SteeringMath::GetWanderAngleChange(m_RandomStreams[firstAgent + i], entry.maxAngleChange);
+
+					const Elite::Vector2 circleCenter{ SteeringMath::GetWanderCircleCenter(batch.positions[i], batch.rotations[i], entry.offset) };
+					const Elite::Vector2 wanderTarget{ SteeringMath::GetWanderTarget(circleCenter, entry.radius, wanderAngle) };
+					batch.linear[i] += weight * SteeringMath::Seek(batch.positions[i], wanderTarget, batch.maxSpeeds[i]);
+				}
+				break;
+			case Kind::Pursuit:
+				for (int i : batch.pending)
+				{
+					const Elite::Vector2 pursuitPoint{ SteeringMath::GetPursuitPoint(batch.positions[i], target) };
+					batch.linear[i] += weight * SteeringMath::Seek(batch.positions[i], pursuitPoint, batch.maxSpeeds[i]);
+				}
+				break;
+			case Kind::Evade:
+				for (int i : batch.pending)
+				{
+					if (DistanceSquared(batch.positions[i], target.Position) > entry.radius * entry.radius)
+						batch.isValid[i] = false;
+					else
+						batch.linear[i] -= weight * SteeringMath::Seek(batch.positions[i], target.Position, batch.maxSpeeds[i]);
+				}
+				break;
+			case Kind::AvoidObstacles:
+			{
+				// Invalid when no feeler hits, so the next stage steers
+				const int nrOfPending{ int(batch.pending.size()) };
+				batch.feelers.resize(nrOfPending);
+				batch.feelerHits.resize(nrOfPending);
+				for (int p{ 0 }; p < nrOfPending; ++p)
+				{
+					const int i{ batch.pending[p] };
+					batch.feelers[p] = SteeringMath::GetFeeler(batch.positions[i], batch.velocities[i], batch.rotations[i], batch.radii[i], entry.radius, entry.offset);
+				}
+				if (entry.pObstacles)
+					entry.pObstacles->QueryFeelers(batch.feelers.data(), nrOfPending, batch.feelerHits.data());
+
+				for (int p{ 0 }; p < nrOfPending; ++p)
+				{
+					const int i{ batch.pending[p] };
+					const Elite::ObstacleIndex::FeelerHit& hit{ batch.feelerHits[p] };
+					if (entry.pObstacles && hit.isHit)
+						batch.linear[i] += weight * SteeringMath::AvoidObstacle(batch.feelers[p].direction, hit, batch.maxSpeeds[i]);
+					else
+						batch.isValid[i] = false;
+				}
+				break;
+			}
+			case Kind::External:
+				// The caller blends all the external steering of a stage, it's added once
+				if (pExternalSteering && !hasExternalSteering)
+				{
+					for (int i : batch.pending)
+						batch.linear[i] += pExternalSteering[firstAgent + i];
+				}
+				hasExternalSteering = true;
+				break;
+			}
+
+			for (int i : batch.pending)
+				batch.totalWeights[i] += weight;
+		}
+
+		// A blend is always valid, a single behavior only when it says so: the others try the next stage
+		// When no stage is valid, the steering of the last one is kept
+		int nrOfPending{ 0 };
+		for (int i : batch.pending)
+		{
+			SteeringOutput& steering{ pOutputs[firstAgent + i] };
+			steering.LinearVelocity = batch.linear[i];
+			steering.AngularVelocity = batch.angular[i];
+			steering.IsValid = stage.isBlended || batch.isValid[i];
+			if (stage.isBlended && batch.totalWeights[i] > 0.f)
+				steering *= 1.f / batch.totalWeights[i];
+
+			m_ActiveStages[firstAgent + i] = stageIdx;
+			if (!steering.IsValid)
+				batch.pending[nrOfPending++] = i;
+		}
+		batch.pending.resize(nrOfPending);
+	}
+}
+
+void SteeringProgram::RenderDebug(const SteeringAgent* pAgent, int agentIdx, const SteeringOutput& steering) const
+{
+	DEBUGRENDERER2D->DrawDirection(pAgent->GetPosition(), steering.LinearVelocity, 7.f, { 0, 1, 1 }, 0.4f);
+	if (m_Stages.empty() || agentIdx < 0 || agentIdx >= m_NrOfAgents)
+		return;
+
+	const Stage& stage{ m_Stages[m_ActiveStages[agentIdx]] };
+	for (int entryIdx{ stage.firstEntry }; entryIdx < stage.endEntry; ++entryIdx)
+	{
+		const Entry& entry{ m_Entries[entryIdx] };
+		switch (entry.kind)
+		{
+		case Kind::Wander:
+		{
+			const Elite::Vector2 circleCenter{ SteeringMath::GetWanderCircleCenter(pAgent->GetPosition(), pAgent->GetRotation(), entry.offset) };
+			const float wanderAngle{ m_WanderAngles[agentIdx * m_NrOfWanderEntries + entry.wanderSlot] };
+			DEBUGRENDERER2D->DrawCircle(circleCenter, entry.radius, { 0, 0, 1, 0.5f }, 0.4f);
+			DEBUGRENDERER2D->DrawPoint(SteeringMath::GetWanderTarget(circleCenter, entry.radius, wanderAngle), 4.f, { 1, 0, 0, 0.5f }, 0.4f);
+			break;
+		}
+		case Kind::Pursuit:
+			DEBUGRENDERER2D->DrawPoint(SteeringMath::GetPursuitPoint(pAgent->GetPosition(), *entry.pTarget), 5.f, { 1, 0, 0, 0.5f }, 0.4f);
+			break;
+		case Kind::Evade:
+			DEBUGRENDERER2D->DrawCircle(entry.pTarget->Position, entry.radius, { 1, 0, 0, 0.5f }, 0.4f);
+			break;
+		case Kind::AvoidObstacles:
+		{
+			const Elite::ObstacleIndex::Feeler feeler{ SteeringMath::GetFeeler(pAgent->GetPosition(), pAgent->GetLinearVelocity(), pAgent->GetRotation(), pAgent->GetRadius(), entry.radius, entry.offset) };
+			DEBUGRENDERER2D->DrawSegment(feeler.origin, feeler.origin + feeler.direction * feeler.length, { 1, 0.5f, 0, 0.5f }, 0.4f);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
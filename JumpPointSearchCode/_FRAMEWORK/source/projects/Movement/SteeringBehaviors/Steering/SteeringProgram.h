@@ -0,0 +1,156 @@
+#pragma once
+// SteeringProgram.h: steering behaviors compiled into a flat list of (kind, weight, params) entries.
+// The program is a priority list of stages, every stage blends its entries. It's evaluated for a whole range of agents
+// at once, one kind at a time, so there is no virtual call per behavior and agent, and the per agent state (e.g. the
+// wander angle) lives in the program. Debug drawing is a separate pass (RenderDebug) the evaluation never checks for.
+#include <vector>
+#include "../SteeringHelpers.h"
+#include "framework/EliteGeometry/EObstacleIndex.h"
+
+class ISteeringBehavior;
+class SteeringAgent;
+
+class SteeringProgram final
+{
+public:
+	enum class Kind
+	{
+		Seek,
+		Flee,
+		Arrive,
+		Face,
+		Wander,
+		Pursuit,
+		Evade,
+		AvoidObstacles, //All pending agents' feelers are queried in one batch
+		External //Steering calculated by the caller (e.g. the flocking kernel), passed to Evaluate already weighted
+	};
+
+	struct Entry
+	{
+		Kind kind = Kind::Seek;
+		const float* pWeight = nullptr; //Weight in the blend, read when evaluating so it can be changed live (nullptr is 1)
+		const TargetData* pTarget = nullptr; //Target of the behavior, read when evaluating
+		float radius = 0.f; //Arrive: slow radius, Wander: circle radius, Evade: evade radius, AvoidObstacles: min feeler length
+		float offset = 0.f; //Wander: distance of the circle in front of the agent, AvoidObstacles: look ahead time
+		const Elite::ObstacleIndex* pObstacles = nullptr; //AvoidObstacles
+		float maxAngleChange = 0.f; //Wander
+		int wanderSlot = -1; //Wander: index of the angle of this entry in the angles of an agent
+	};
+
+	SteeringProgram() = default;
+
+	//Compiles a behavior and everything it combines, false if it can't be flattened (e.g. a priority inside of a blend), the program is empty then
+	//Weights and targets are read from the behaviors when evaluating, other parameters are copied: compile again when they change
+	bool Compile(const ISteeringBehavior* pRoot);
+	void Clear();
+
+	//Used by the behaviors to compile themselves
+	void BeginStage(bool isBlended);
+	void EndStage();
+	bool IsInStage() const { return m_IsInStage; }
+	bool IsBlending() const { return m_IsInStage && m_Stages.back().isBlended; }
+	void AddEntry(Entry entry);
+
+	//Per agent state, the agent index is the index in the agents passed to Evaluate
+	//Every agent draws from its own random stream, so the result doesn't depend on how the agents are split over threads
+	void SetNrOfAgents(int nrOfAgents);
+
+	//Calculates the steering of the agents [firstAgent, endAgent) into their index of pOutputs
+	//Different ranges can be evaluated at the same time (e.g. on a worker pool)
+	void Evaluate(float deltaT, SteeringAgent* const* pAgents, int firstAgent, int endAgent, SteeringOutput* pOutputs, const Elite::Vector2* pExternalSteering = nullptr);
+
+	//Debug pass: draws the steering of an agent and the helpers of the stage it used last
+	void RenderDebug(const SteeringAgent* pAgent, int agentIdx, const SteeringOutput& steering) const;
+
+private:
+	struct Stage
+	{
+		int firstEntry = 0;
+		int endEntry = 0;
+		bool isBlended = false; //A blend is always valid, a single behavior is valid when its steering is (e.g. evade)
+	};
+
+	std::vector<Entry> m_Entries;
+	std::vector<Stage> m_Stages;
+	bool m_IsInStage = false;
+	int m_NrOfWanderEntries = 0;
+
+	int m_NrOfAgents = 0;
+	std::vector<float> m_WanderAngles; //m_NrOfWanderEntries per agent
+	std::vector<int> m_ActiveStages; //Stage of the last steering of every agent
+	uint64_t m_RandomStreamId = Elite::CreateRandomStreamId();
+	std::vector<Elite::RandomStream> m_RandomStreams; //Sub streams of m_RandomStreamId, one per agent
+};
+
+//The steering of the behaviors, shared by the behaviors and the program
+namespace SteeringMath
+{
+	inline Elite::Vector2 Seek(const Elite::Vector2& position, const Elite::Vector2& target, float maxSpeed)
+	{
+		return (target - position).GetNormalized() * maxSpeed;
+	}
+
+	inline Elite::Vector2 Arrive(const Elite::Vector2& position, const Elite::Vector2& target, float maxSpeed, float slowRadius)
+	{
+		const Elite::Vector2 toTarget{ target - position };
+		const float distance{ toTarget.Magnitude() };
+		return toTarget.GetNormalized() * (distance < slowRadius ? maxSpeed * distance / slowRadius : maxSpeed);
+	}
+
+	//Angular velocity (in degrees, clamped) that turns an agent with the given rotation to the target
+	inline float Face(const Elite::Vector2& position, float rotation, const Elite::Vector2& target, float maxAngularSpeed)
+	{
+		const Elite::Vector2 toTarget{ (target - position).GetNormalized() };
+		float angle{ atan2f(toTarget.y, toTarget.x) - rotation + float(E_PI_2) };
+		while (angle > E_PI) angle -= 2.f * float(E_PI);
+		while (angle < -E_PI) angle += 2.f * float(E_PI);
+		return Elite::Clamp(Elite::ToDegrees(angle), -maxAngularSpeed, maxAngularSpeed);
+	}
+
+	inline Elite::Vector2 GetWanderCircleCenter(const Elite::Vector2& position, float rotation, float offset)
+	{
+		const float heading{ rotation - float(E_PI) * 0.5f };
+		return position + offset * Elite::Vector2{ cosf(heading), sinf(heading) };
+	}
+
+	inline Elite::Vector2 GetWanderTarget(const Elite::Vector2& circleCenter, float radius, float wanderAngle)
+	{
+		return circleCenter + radius * Elite::Vector2{ cosf(wanderAngle), sinf(wanderAngle) };
+	}
+
+	inline float GetWanderAngleChange(Elite::RandomStream& random, float maxAngleChange)
+	{
+		return random.NextFloat(-maxAngleChange, maxAngleChange);
+	}
+
+	//Point ahead of the target to chase, or the target itself when the agent is closer to that point than the target is
+	inline Elite::Vector2 GetPursuitPoint(const Elite::Vector2& position, const TargetData& target)
+	{
+		const float maxDistance{ 20.f };
+		const float aheadDistance{ min(Distance(position, target.Position), maxDistance) };
+		const Elite::Vector2 ahead{ target.Position + (target.GetDirection() + target.LinearVelocity).GetNormalized() * aheadDistance };
+		return Distance(ahead, target.Position) < Distance(ahead, position) ? ahead : target.Position;
+	}
+
+	//Lookahead ray of an agent: along its velocity (or its heading when it stands still), longer when it goes faster
+	inline Elite::ObstacleIndex::Feeler GetFeeler(const Elite::Vector2& position, const Elite::Vector2& velocity, float rotation, float agentRadius, float minLength, float lookAheadTime)
+	{
+		const float speed{ velocity.Magnitude() };
+		Elite::ObstacleIndex::Feeler feeler{};
+		feeler.origin = position;
+		feeler.direction = speed > 0.f ? velocity / speed : Elite::OrientationToVector(rotation);
+		feeler.length = minLength + speed * lookAheadTime;
+		feeler.radius = agentRadius;
+		return feeler;
+	}
+
+	//Slides along the obstacle that was hit and pushes away from it, harder the closer it is
+	inline Elite::Vector2 AvoidObstacle(const Elite::Vector2& direction, const Elite::ObstacleIndex::FeelerHit& hit, float maxSpeed)
+	{
+		Elite::Vector2 tangent{ direction - hit.normal * direction.Dot(hit.normal) };
+		if (tangent.MagnitudeSquared() < 0.0001f) //Head on: pick a side
+			tangent = { -hit.normal.y, hit.normal.x };
+		return (tangent.GetNormalized() + hit.avoidance).GetNormalized() * maxSpeed;
+	}
+}
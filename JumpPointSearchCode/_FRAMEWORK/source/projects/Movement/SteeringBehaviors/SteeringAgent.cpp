@@ -3,10 +3,24 @@
 #include "Steering/SteeringBehaviors.h"
 
 void SteeringAgent::Update(float dt)
+{
+	ApplySteering(CalculateSteering(dt), dt);
+}
+
+SteeringOutput SteeringAgent::CalculateSteering(float dt)
+{
+	if (!m_pSteeringBehavior)
+		return SteeringOutput(Elite::ZeroVector2, 0.f, false);
+
+	return m_pSteeringBehavior->CalculateSteering(dt, this);
+}
+
+void SteeringAgent::ApplySteering(const SteeringOutput& steering, float dt)
 {
 	if(m_pSteeringBehavior)
 	{
-		auto output = m_pSteeringBehavior->CalculateSteering(dt, this);
+		m_LastSteering = steering;
+		auto output = steering;
 
 		//Linear Movement
 		//***************
@@ -14,11 +28,6 @@ void SteeringAgent::Update(float dt)
 		auto steeringForce = output.LinearVelocity - linVel;
 		auto acceleration = steeringForce / GetMass();		
 
-		if(m_RenderBehavior)
-		{
-			//DEBUGRENDERER2D->DrawDirection(GetPosition(), acceleration, acceleration.Magnitude(), { 0, 1, 1 ,0.5f }, 0.40f);
-			//DEBUGRENDERER2D->DrawDirection(GetPosition(), linVel, linVel.Magnitude(), { 1, 0, 1 ,0.5f }, 0.40f);
-		}
 		SetLinearVelocity(linVel + (acceleration*dt));
 
 		//Angular Movement
@@ -41,4 +50,11 @@ void SteeringAgent::Render(float dt)
 {
 	//Use Default Agent Rendering
 	BaseAgent::Render(dt);
+
+	//Debug pass of the behavior, the steering calculation itself never draws
+	if (m_RenderBehavior && m_pSteeringBehavior)
+	{
+		DEBUGRENDERER2D->DrawDirection(GetPosition(), m_LastSteering.LinearVelocity, 5.f, { 0, 1, 0, 0.5f }, 0.4f);
+		m_pSteeringBehavior->RenderDebug(this);
+	}
 }
\ No newline at end of file
@@ -26,6 +26,10 @@ public:
 	void Update(float dt) override;
 	void Render(float dt) override;
 
+	//Update split in two, so the steering of many agents can be calculated (in parallel) before any of them moves
+	SteeringOutput CalculateSteering(float dt);
+	void ApplySteering(const SteeringOutput& output, float dt);
+
 	float GetMaxLinearSpeed() const { return m_MaxLinearSpeed; }
 	void SetMaxLinearSpeed(float maxLinSpeed) { m_MaxLinearSpeed = maxLinSpeed; }
 
@@ -53,5 +57,6 @@ protected:
 	float m_MaxAngularSpeed = 10.f;
 	bool m_AutoOrient = false;
 	bool m_RenderBehavior = false;
+	SteeringOutput m_LastSteering = {}; //Drawn by Render when the behavior is rendered
 };
 #endif
\ No newline at end of file
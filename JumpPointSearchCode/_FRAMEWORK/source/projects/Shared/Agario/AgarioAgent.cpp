@@ -4,8 +4,10 @@
 #include "AgarioData.h"
 
 using namespace Elite;
+const float AgarioAgent::m_SpawnRadius{ 2.f };
+
 AgarioAgent::AgarioAgent(Elite::Vector2 pos, Color color)
-	: SteeringAgent(2.0f)
+	: SteeringAgent(m_SpawnRadius)
 {
 	m_BodyColor = color;
 	SetPosition(pos);
@@ -17,6 +19,8 @@ AgarioAgent::AgarioAgent(Elite::Vector2 pos, Color color)
 	m_pWander = new Wander();
 	m_pSeek = new Seek();
 	m_pFlee = new Flee();
+
+	m_SpawnMaxLinearSpeed = GetMaxLinearSpeed();
 }
 
 AgarioAgent::AgarioAgent(Elite::Vector2 pos)
@@ -33,16 +37,29 @@ AgarioAgent::~AgarioAgent()
 }
 
 void AgarioAgent::Update(float dt)
+{
+	UpdateBody();
+	UpdateDecisionMaking(dt);
+	UpdateSteering(dt);
+}
+
+void AgarioAgent::UpdateBody()
 {
 	if (m_ToUpgrade > 0.0f)
 	{
 		OnUpgrade(m_ToUpgrade);
 		m_ToUpgrade = 0.0f;
 	}
+}
 
+void AgarioAgent::UpdateDecisionMaking(float dt)
+{
 	if(m_DecisionMaking)
 		m_DecisionMaking->Update(dt);
+}
 
+void AgarioAgent::UpdateSteering(float dt)
+{
 	SteeringAgent::Update(dt);
 }
 
@@ -68,9 +85,33 @@ bool AgarioAgent::CanBeDestroyed()
 
 void AgarioAgent::SetDecisionMaking(Elite::IDecisionMaking* decisionMakingStructure)
 {
+	//A pooled agent can get a new one
+	if (m_DecisionMaking != decisionMakingStructure)
+		SAFE_DELETE(m_DecisionMaking);
 	m_DecisionMaking = decisionMakingStructure;
 }
 
+void AgarioAgent::Despawn()
+{
+	m_pRigidBody->SetActive(false);
+}
+
+void AgarioAgent::Respawn(const Elite::Vector2& pos)
+{
+	m_ToDestroy = false;
+	m_ToUpgrade = 0.f;
+	++m_Generation;
+	if (m_Radius != m_SpawnRadius)
+		SetRadius(m_SpawnRadius);
+	SetMaxLinearSpeed(m_SpawnMaxLinearSpeed);
+
+	SetPosition(pos);
+	SetLinearVelocity(Elite::ZeroVector2);
+	SetAngularVelocity(0.f);
+	SetToWander();
+	m_pRigidBody->SetActive(true);
+}
+
 void AgarioAgent::SetToWander()
 {
 	SetSteeringBehavior(m_pWander);
@@ -90,18 +131,17 @@ void AgarioAgent::SetToFlee(Elite::Vector2 fleePos)
 
 void AgarioAgent::OnUpgrade(float amountOfFood)
 {
-	float prevMass = GetMass();
-	m_Radius += amountOfFood;
-	
-	//Remove existing shapes
-	m_pRigidBody->RemoveAllShapes();
+	SetRadius(m_Radius + amountOfFood);
+	SetMaxLinearSpeed(m_SpeedBase / sqrt(m_Radius));
+}
 
-	//Add a new shape
-	Elite::EPhysicsCircleShape shape;
-	shape.radius = m_Radius;
-	m_pRigidBody->AddShape(&shape);
+void AgarioAgent::SetRadius(float radius)
+{
+	m_Radius = radius;
+
+	//Same fixture, no Box2D fixture is destroyed and created when the agent grows or respawns
+	m_pRigidBody->SetCircleRadius(m_Radius);
 	m_pRigidBody->SetMass(0.f);
-	SetMaxLinearSpeed(m_SpeedBase / sqrt(m_Radius));
 }
 
 
@@ -20,7 +20,12 @@ public:
 	virtual ~AgarioAgent();
 
 	//--- Agent Functions ---
+	//Everything at once: UpdateBody, UpdateDecisionMaking and UpdateSteering
 	virtual void Update(float dt) override;
+	//Split up so a scheduler can decide and steer less often than every frame, UpdateBody has to run every frame
+	void UpdateBody();
+	void UpdateDecisionMaking(float dt);
+	void UpdateSteering(float dt);
 	virtual void Render(float dt) override;
 
 	//-- Agario Functions --
@@ -28,6 +33,15 @@ public:
 	void MarkForDestroy();
 	bool CanBeDestroyed();
 	void SetDecisionMaking(Elite::IDecisionMaking* decisionMakingStructure);
+	Elite::IDecisionMaking* GetDecisionMaking() const { return m_DecisionMaking; }
+
+	//-- Pooling (see AgarioPool.h) --
+	//Takes the body out of the simulation, the agent keeps its decision making
+	void Despawn();
+	//Back in the simulation at the start size, as if it was just created
+	void Respawn(const Elite::Vector2& pos);
+	//Changes every respawn, so a stored pointer can tell the agent it pointed at was eaten even when the object is reused
+	int GetGeneration() const { return m_Generation; }
 	
 	void SetToWander();
 	void SetToSeek(Elite::Vector2 seekPos);
@@ -37,7 +51,10 @@ private:
 	Elite::IDecisionMaking* m_DecisionMaking = nullptr;
 	float m_ToUpgrade = 0.0f;
 	bool m_ToDestroy = false;
+	int m_Generation = 0;
 	float m_SpeedBase = 25.f;
+	float m_SpawnMaxLinearSpeed = 0.f;
+	static const float m_SpawnRadius;
 
 	ISteeringBehavior* m_pWander = nullptr;
 	ISteeringBehavior* m_pSeek = nullptr;
@@ -45,6 +62,7 @@ private:
 	
 private:
 	void OnUpgrade(float amountOfFood);
+	void SetRadius(float radius);
 
 private:
 	//C++ make the class non-copyable
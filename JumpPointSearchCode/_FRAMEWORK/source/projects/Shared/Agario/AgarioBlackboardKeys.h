@@ -0,0 +1,22 @@
+#pragma once
+// AgarioBlackboardKeys.h: the blackboard keys of the Agario agents, used by the FSM and BT versions.
+// Registered once, so the states, transitions and behaviors look their data up by index instead of by name.
+#include "framework/EliteAI/EliteData/EBlackboard.h"
+
+namespace AgarioKeys
+{
+	const Elite::BlackboardKey Agent{ "Agent" };
+	const Elite::BlackboardKey AgentsVec{ "AgentsVec" };
+	const Elite::BlackboardKey FoodVec{ "FoodVec" };
+	const Elite::BlackboardKey AgentsStore{ "AgentsStore" };
+	const Elite::BlackboardKey FoodStore{ "FoodStore" };
+	const Elite::BlackboardKey WorldSize{ "WorldSize" };
+	const Elite::BlackboardKey Time{ "Time" };
+
+	//Targets of the decision making
+	const Elite::BlackboardKey Target{ "Target" };
+	const Elite::BlackboardKey FoodTarget{ "FoodTarget" };
+	const Elite::BlackboardKey FoodTargetGeneration{ "FoodTargetGeneration" };
+	const Elite::BlackboardKey AgentFleeTarget{ "AgentFleeTarget" };
+	const Elite::BlackboardKey AgentFleeTargetGeneration{ "AgentFleeTargetGeneration" };
+}
@@ -0,0 +1,142 @@
+#include "stdafx.h"
+#include "AgarioEntityStore.h"
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define AGARIO_ENTITY_STORE_SSE2
+#endif
+
+namespace
+{
+	//Candidates of a query, per thread so agents can decide in parallel
+	std::vector<int>& GetCandidates()
+	{
+		static thread_local std::vector<int> candidates{};
+		candidates.clear();
+		return candidates;
+	}
+
+#if defined(AGARIO_ENTITY_STORE_SSE2)
+	__m128 Gather(const float* pData, const int* pIndices)
+	{
+		return _mm_set_ps(pData[pIndices[3]], pData[pIndices[2]], pData[pIndices[1]], pData[pIndices[0]]);
+	}
+
+	__m128 GatherMask(const int* pData, const int* pIndices)
+	{
+		return _mm_castsi128_ps(_mm_set_epi32(pData[pIndices[3]], pData[pIndices[2]], pData[pIndices[1]], pData[pIndices[0]]));
+	}
+#endif
+}
+
+AgarioEntityStore::AgarioEntityStore(Elite::SpatialPartitionType partitionType, const Elite::Vector2& worldMin, const Elite::Vector2& worldMax)
+	: m_pPartition{ Elite::CreateSpatialPartition(partitionType, worldMin, worldMax) }
+{
+}
+
+AgarioEntityStore::~AgarioEntityStore()
+{
+	SAFE_DELETE(m_pPartition);
+}
+
+void AgarioEntityStore::Resize(int nrOfEntities)
+{
+	m_PositionsX.resize(nrOfEntities);
+	m_PositionsY.resize(nrOfEntities);
+	m_Radii.resize(nrOfEntities);
+	m_IsAlive.resize(nrOfEntities);
+}
+
+void AgarioEntityStore::UpdatePartition()
+{
+	//Every entity is moved to its current index and the ids past the end are removed
+	const int nrOfEntities{ GetNrOfEntities() };
+	for (int i = 0; i < nrOfEntities; ++i)
+	{
+		m_pPartition->Move(i, GetPosition(i), m_Radii[i]);
+	}
+
+	for (int i = nrOfEntities; m_pPartition->Contains(i); ++i)
+	{
+		m_pPartition->Remove(i);
+	}
+}
+
+int AgarioEntityStore::QueryNearest(const Elite::Vector2& pos, float maxDistance, float minRadius, float maxRadius) const
+{
+	//Unbounded: a box query would return every entity, let the partition's nearest search prune on distance instead
+	if (maxDistance == FLT_MAX)
+	{
+		return m_pPartition->QueryNearest(pos, maxDistance, [this, minRadius, maxRadius](int id)
+			{
+				return m_IsAlive[id] && m_Radii[id] > minRadius && m_Radii[id] < maxRadius;
+			});
+	}
+
+	//Broad phase: the box around the query circle
+	std::vector<int>& candidates{ GetCandidates() };
+	const Elite::Vector2 extents{ maxDistance, maxDistance };
+	m_pPartition->QueryRange(pos - extents, pos + extents, candidates);
+
+	const int nrOfCandidates{ int(candidates.size()) };
+	const float maxDistanceSquared{ maxDistance * maxDistance };
+	float nearestDistanceSquared{ FLT_MAX };
+	int nearest{ Elite::ISpatialPartition::InvalidId };
+	int i{ 0 };
+#if defined(AGARIO_ENTITY_STORE_SSE2)
+	const __m128 posX{ _mm_set1_ps(pos.x) };
+	const __m128 posY{ _mm_set1_ps(pos.y) };
+	const __m128 minRadii{ _mm_set1_ps(minRadius) };
+	const __m128 maxRadii{ _mm_set1_ps(maxRadius) };
+	const __m128 maxDistancesSquared{ _mm_set1_ps(maxDistanceSquared) };
+	const __m128 noHit{ _mm_set1_ps(FLT_MAX) };
+	for (; i + 4 <= nrOfCandidates; i += 4)
+	{
+		const int* pIds{ candidates.data() + i };
+		const __m128 deltaX{ _mm_sub_ps(Gather(m_PositionsX.data(), pIds), posX) };
+		const __m128 deltaY{ _mm_sub_ps(Gather(m_PositionsY.data(), pIds), posY) };
+		const __m128 distanceSquared{ _mm_add_ps(_mm_mul_ps(deltaX, deltaX), _mm_mul_ps(deltaY, deltaY)) };
+
+		const __m128 radius{ Gather(m_Radii.data(), pIds) };
+		__m128 isValid{ _mm_and_ps(GatherMask(m_IsAlive.data(), pIds), _mm_cmple_ps(distanceSquared, maxDistancesSquared)) };
+		isValid = _mm_and_ps(isValid, _mm_and_ps(_mm_cmpgt_ps(radius, minRadii), _mm_cmplt_ps(radius, maxRadii)));
+
+		float distances[4];
+		_mm_storeu_ps(distances, _mm_or_ps(_mm_and_ps(isValid, distanceSquared), _mm_andnot_ps(isValid, noHit)));
+		for (int j = 0; j < 4; ++j)
+		{
+			if (distances[j] < nearestDistanceSquared)
+			{
+				nearestDistanceSquared = distances[j];
+				nearest = pIds[j];
+			}
+		}
+	}
+#endif
+	for (; i < nrOfCandidates; ++i)
+	{
+		const int id{ candidates[i] };
+		if (!m_IsAlive[id] || m_Radii[id] <= minRadius || m_Radii[id] >= maxRadius)
+			continue;
+
+		const float distanceSquared{ DistanceSquared(GetPosition(id), pos) };
+		if (distanceSquared <= maxDistanceSquared && distanceSquared < nearestDistanceSquared)
+		{
+			nearestDistanceSquared = distanceSquared;
+			nearest = id;
+		}
+	}
+	return nearest;
+}
+
+void AgarioEntityStore::QueryRadius(const Elite::Vector2& center, float radius, std::vector<int>& ids) const
+{
+	std::vector<int>& candidates{ GetCandidates() };
+	m_pPartition->QueryRadius(center, radius, candidates);
+
+	for (int id : candidates)
+	{
+		if (m_IsAlive[id])
+			ids.push_back(id);
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+// AgarioEntityStore.h: positions, radii and alive flags of the Agario food or agents as SoA, with a spatial partition on
+// top. The decision making queries the store instead of the entities: the partition gives the candidates, their
+// distances and radii are then tested 4 at a time (SSE2) without touching the entities themselves.
+// The ids are the indices of the entities in the vector the store is synced with.
+#include <vector>
+#include "framework/EliteGeometry/ESpatialPartition.h"
+
+class AgarioEntityStore final
+{
+public:
+	AgarioEntityStore(Elite::SpatialPartitionType partitionType, const Elite::Vector2& worldMin, const Elite::Vector2& worldMax);
+	~AgarioEntityStore();
+
+	//Copies the state of the entities (index = id) and moves them in the partition, once a frame
+	template<class T_AgarioType>
+	void Sync(const std::vector<T_AgarioType*>& entities);
+
+	int GetNrOfEntities() const { return int(m_PositionsX.size()); }
+	Elite::Vector2 GetPosition(int id) const { return { m_PositionsX[id], m_PositionsY[id] }; }
+	float GetRadius(int id) const { return m_Radii[id]; }
+	bool IsAlive(int id) const { return m_IsAlive[id] != 0; }
+
+	//Closest alive entity within maxDistance (center to center) with a radius in (minRadius, maxRadius), InvalidId if none
+	int QueryNearest(const Elite::Vector2& pos, float maxDistance, float minRadius = -FLT_MAX, float maxRadius = FLT_MAX) const;
+	//Alive entities whose circle overlaps the query circle, appended to ids
+	void QueryRadius(const Elite::Vector2& center, float radius, std::vector<int>& ids) const;
+
+private:
+	std::vector<float> m_PositionsX{};
+	std::vector<float> m_PositionsY{};
+	std::vector<float> m_Radii{};
+	std::vector<int> m_IsAlive{}; //All bits set when alive, so it's a SIMD mask
+
+	Elite::ISpatialPartition* m_pPartition = nullptr;
+
+	void Resize(int nrOfEntities);
+	void UpdatePartition();
+
+	AgarioEntityStore(const AgarioEntityStore&) = delete;
+	AgarioEntityStore& operator=(const AgarioEntityStore&) = delete;
+};
+
+template<class T_AgarioType>
+inline void AgarioEntityStore::Sync(const std::vector<T_AgarioType*>& entities)
+{
+	const int nrOfEntities{ int(entities.size()) };
+	Resize(nrOfEntities);
+	for (int i = 0; i < nrOfEntities; ++i)
+	{
+		const Elite::Vector2 position{ entities[i]->GetPosition() };
+		m_PositionsX[i] = position.x;
+		m_PositionsY[i] = position.y;
+		m_Radii[i] = entities[i]->GetRadius();
+		m_IsAlive[i] = entities[i]->CanBeDestroyed() ? 0 : ~0;
+	}
+	UpdatePartition();
+}
@@ -47,3 +47,17 @@ bool AgarioFood::CanBeDestroyed()
 {
 	return m_ToDestroy;
 }
+
+void AgarioFood::Despawn()
+{
+	m_pRigidBody->SetActive(false);
+}
+
+void AgarioFood::Respawn(const Elite::Vector2& pos)
+{
+	m_Position = pos;
+	m_ToDestroy = false;
+	++m_Generation;
+	m_pRigidBody->SetPosition(pos);
+	m_pRigidBody->SetActive(true);
+}
@@ -17,7 +17,14 @@ public:
 
 	void MarkForDestroy();
 	bool CanBeDestroyed();
+
+	//-- Pooling (see AgarioPool.h) --
+	void Despawn();
+	void Respawn(const Elite::Vector2& pos);
+	//Changes every respawn, so a stored pointer can tell the food it pointed at was eaten even when the object is reused
+	int GetGeneration() const { return m_Generation; }
 	Elite::Vector2 GetPosition() { return m_Position; }
+	float GetRadius() const { return m_Radius; }
 
 private:
 	//--Datamemebers--
@@ -28,6 +35,7 @@ private:
 
 	RigidBody* m_pRigidBody = nullptr;
 	bool m_ToDestroy = false;
+	int m_Generation = 0;
 private:
 	//C++ make the class non-copyable
 	AgarioFood(const AgarioFood&) {};
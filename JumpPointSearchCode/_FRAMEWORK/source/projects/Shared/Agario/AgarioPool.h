@@ -0,0 +1,110 @@
+#pragma once
+// AgarioPool.h: recycles Agario food and agents instead of allocating them (and creating their Box2D body) mid-frame.
+// A destroyed entity only deactivates its body and goes back to the pool. Removals (the entities marked for destroy)
+// and spawns are applied at the end of the frame in one compacting pass over the active entities, so their indices
+// (the ids of the entity stores) only change there.
+// T_AgarioType needs a constructor taking a position, CanBeDestroyed, Despawn and Respawn.
+#include <vector>
+
+template<class T_AgarioType>
+class AgarioPool final
+{
+public:
+	AgarioPool() = default;
+	~AgarioPool();
+
+	//Creates inactive entities up front
+	void Preallocate(int count);
+	//Right away, to set up the world (e.g. the decision making of an agent), not while the entities are iterated
+	T_AgarioType* Acquire(std::vector<T_AgarioType*>& entities, const Elite::Vector2& pos);
+	//At the next Flush
+	void Spawn(const Elite::Vector2& pos) { m_SpawnPositions.push_back(pos); }
+
+	//Moves the entities marked for destroy to the pool (the others keep their order) and adds the spawns at the end
+	void Flush(std::vector<T_AgarioType*>& entities);
+	//Indices (before the flush, ascending) of the entities the last Flush removed, to keep parallel arrays in sync
+	const std::vector<int>& GetRemovedIndices() const { return m_RemovedIndices; }
+	int GetNrOfFree() const { return int(m_pFreeEntities.size()); }
+
+private:
+	std::vector<T_AgarioType*> m_pFreeEntities{};
+	std::vector<Elite::Vector2> m_SpawnPositions{};
+	std::vector<int> m_RemovedIndices{};
+
+	T_AgarioType* Take(const Elite::Vector2& pos);
+
+	AgarioPool(const AgarioPool&) = delete;
+	AgarioPool& operator=(const AgarioPool&) = delete;
+};
+
+template<class T_AgarioType>
+inline AgarioPool<T_AgarioType>::~AgarioPool()
+{
+	for (T_AgarioType* pEntity : m_pFreeEntities)
+	{
+		SAFE_DELETE(pEntity);
+	}
+	m_pFreeEntities.clear();
+}
+
+template<class T_AgarioType>
+inline void AgarioPool<T_AgarioType>::Preallocate(int count)
+{
+	m_pFreeEntities.reserve(m_pFreeEntities.size() + count);
+	for (int i = 0; i < count; ++i)
+	{
+		T_AgarioType* pEntity = new T_AgarioType(Elite::ZeroVector2);
+		pEntity->Despawn();
+		m_pFreeEntities.push_back(pEntity);
+	}
+}
+
+template<class T_AgarioType>
+inline T_AgarioType* AgarioPool<T_AgarioType>::Acquire(std::vector<T_AgarioType*>& entities, const Elite::Vector2& pos)
+{
+	T_AgarioType* pEntity = Take(pos);
+	entities.push_back(pEntity);
+	return pEntity;
+}
+
+template<class T_AgarioType>
+inline void AgarioPool<T_AgarioType>::Flush(std::vector<T_AgarioType*>& entities)
+{
+	m_RemovedIndices.clear();
+	const int nrOfEntities{ int(entities.size()) };
+	int nrOfKept{ 0 };
+	for (int i = 0; i < nrOfEntities; ++i)
+	{
+		T_AgarioType* pEntity = entities[i];
+		if (pEntity->CanBeDestroyed())
+		{
+			pEntity->Despawn();
+			m_pFreeEntities.push_back(pEntity);
+			m_RemovedIndices.push_back(i);
+		}
+		else
+		{
+			entities[nrOfKept++] = pEntity;
+		}
+	}
+	entities.resize(nrOfKept);
+
+	for (const Elite::Vector2& pos : m_SpawnPositions)
+	{
+		entities.push_back(Take(pos));
+	}
+	m_SpawnPositions.clear();
+}
+
+template<class T_AgarioType>
+inline T_AgarioType* AgarioPool<T_AgarioType>::Take(const Elite::Vector2& pos)
+{
+	//Only allocates when the pool is empty
+	if (m_pFreeEntities.empty())
+		return new T_AgarioType(pos);
+
+	T_AgarioType* pEntity = m_pFreeEntities.back();
+	m_pFreeEntities.pop_back();
+	pEntity->Respawn(pos);
+	return pEntity;
+}